@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "params.h"
+#include "context.h"
 
 #define CRYPTO_ALGNAME "SPHINCS+"
 
@@ -44,6 +45,13 @@ unsigned long long crypto_sign_seedbytes(void);
 int crypto_sign_seed_keypair(unsigned char *pk, unsigned char *sk,
                              const unsigned char *seed);
 
+/*
+ * Like crypto_sign_seed_keypair, and leaves ctx prepared for signing with the
+ * new secret key, as crypto_sign_ctx_init would.
+ */
+int crypto_sign_seed_keypair_ctx(unsigned char *pk, unsigned char *sk,
+                                 const unsigned char *seed, spx_ctx *ctx);
+
 /*
  * Generates a SPHINCS+ key pair.
  * Format sk: [SK_SEED || SK_PRF || PUB_SEED || root]
@@ -57,6 +65,20 @@ int crypto_sign_keypair(unsigned char *pk, unsigned char *sk);
 int crypto_sign_signature(uint8_t *sig, size_t *siglen,
                           const uint8_t *m, size_t mlen, const uint8_t *sk);
 
+/*
+ * Prepares ctx for signing with sk. The context holds the hash states that
+ * depend on the key pair; it is only read while signing, so it can be shared
+ * between threads. Returns 0.
+ */
+int crypto_sign_ctx_init(spx_ctx *ctx, const uint8_t *sk);
+
+/**
+ * Like crypto_sign_signature, with a context from crypto_sign_ctx_init(sk).
+ */
+int crypto_sign_signature_ctx(uint8_t *sig, size_t *siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *sk,
+                              const spx_ctx *ctx);
+
 /**
  * Verifies a detached signature and message under a given public key.
  */
@@ -71,6 +93,19 @@ int crypto_sign(unsigned char *sm, unsigned long long *smlen,
                 const unsigned char *sk);
 #endif
 
+/*
+ * Prepares ctx for verifying signatures under pk. The context is only read
+ * while verifying, so it can be shared between threads. Returns 0.
+ */
+int crypto_sign_ctx_init_pk(spx_ctx *ctx, const uint8_t *pk);
+
+/**
+ * Like crypto_sign_verify, with a context from crypto_sign_ctx_init_pk(pk).
+ */
+int crypto_sign_verify_ctx(const uint8_t *sig, size_t siglen,
+                           const uint8_t *m, size_t mlen, const uint8_t *pk,
+                           const spx_ctx *ctx);
+
 /**
  * Verifies a given signature-message pair under a given public key.
  */
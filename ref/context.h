@@ -0,0 +1,48 @@
+#ifndef SPX_CONTEXT_H
+#define SPX_CONTEXT_H
+
+#include <stdint.h>
+
+#include "params.h"
+#include "sha256.h"
+
+/*
+ * The hash state that depends on the key pair rather than on the address.
+ * initialize_hash_function fills it once per key; after that every function
+ * only reads it, so any number of threads may share one context, and
+ * contexts for different keys may be used side by side.
+ */
+typedef struct {
+    unsigned char pub_seed[SPX_N];
+
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using
+a SHA256 implementation with the OpenSSL API */
+    SHA256_CTX sha2ctx_seeded;  /* after absorbing pub_seed || 0-padding */
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+    uint8_t state_seeded[40];   /* after absorbing pub_seed || 0-padding */
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+    /* The chaining value of the seeded state as native words, from which the
+       fixed-length thash calls compress, with any SHA256 implementation. */
+    uint32_t seeded_words[8];
+
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
+    /* HMAC-SHA256 keyed with sk_prf, after absorbing the ipad and the opad
+       block respectively. Only set when a secret key was given. */
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using
+a SHA256 implementation with the OpenSSL API */
+    SHA256_CTX sha2ctx_ipad;
+    SHA256_CTX sha2ctx_opad;
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+    uint8_t state_ipad[40];
+    uint8_t state_opad[40];
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+#endif // #ifndef BUILD_SLIM_VERIFIER
+} spx_ctx;
+
+/**
+ * Absorb the constant pub_seed using one round of the compression function
+ * This initializes the seeded state of ctx, which can then be reused in thash
+ **/
+void seed_state(spx_ctx *ctx);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "esk.h"
+#include "params.h"
+#include "utils.h"
+
+static const unsigned char esk_magic[8] = "SPXESK01";
+
+#define SPX_ESK_NODES_BYTES (((1 << (SPX_TREE_HEIGHT + 1)) - 1) * SPX_N)
+#define SPX_ESK_WOTS_SIGS_BYTES ((1 << SPX_TREE_HEIGHT) * SPX_WOTS_BYTES)
+
+static uint64_t esk_trees(unsigned int layer)
+{
+    return 1ULL << (SPX_TREE_HEIGHT * (SPX_D - 1 - layer));
+}
+
+/* The bytes per subtree; the lowest layer stored has no WOTS signatures. */
+static size_t esk_record_bytes(unsigned int first_layer, unsigned int layer)
+{
+    return SPX_ESK_NODES_BYTES +
+           (layer > first_layer ? SPX_ESK_WOTS_SIGS_BYTES : 0);
+}
+
+size_t spx_esk_offset(unsigned int first_layer, unsigned int layer,
+                      uint64_t tree)
+{
+    size_t offset = SPX_ESK_HEADER_BYTES;
+    unsigned int i;
+
+    for (i = SPX_D - 1; i > layer; i--) {
+        offset += esk_trees(i) * esk_record_bytes(first_layer, i);
+    }
+    return offset + tree * esk_record_bytes(first_layer, layer);
+}
+
+size_t spx_esk_bytes(unsigned int layers)
+{
+    if (layers == 0 || layers > SPX_D) {
+        return 0;
+    }
+    return spx_esk_offset(SPX_D - layers, SPX_D - layers,
+                          esk_trees(SPX_D - layers));
+}
+
+unsigned int spx_esk_layers(size_t budget)
+{
+    unsigned int layers = 0;
+
+    while (layers < SPX_D && spx_esk_bytes(layers + 1) <= budget) {
+        layers++;
+    }
+    return layers;
+}
+
+void spx_esk_header(unsigned char *header, const uint8_t *pk,
+                    unsigned int layers)
+{
+    memset(header, 0, SPX_ESK_HEADER_BYTES);
+    memcpy(header, esk_magic, 8);
+    ull_to_bytes(header + 8, 4, SPX_N);
+    ull_to_bytes(header + 12, 4, SPX_D);
+    ull_to_bytes(header + 16, 4, SPX_TREE_HEIGHT);
+    ull_to_bytes(header + 20, 4, SPX_WOTS_LEN);
+    ull_to_bytes(header + 24, 4, layers);
+    memcpy(header + SPX_ESK_PK_OFFSET, pk, SPX_PK_BYTES);
+}
+
+int spx_esk_open(spx_esk *esk, const char *path, const uint8_t *pk)
+{
+    unsigned char header[SPX_ESK_HEADER_BYTES];
+    struct stat st;
+    unsigned int layers;
+    void *map;
+    unsigned int i;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+    if (fstat(fd, &st) || (size_t)st.st_size < SPX_ESK_HEADER_BYTES) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    layers = (unsigned int)bytes_to_ull((const unsigned char *)map + 24, 4);
+    spx_esk_header(header, pk, layers);
+    if (memcmp(map, header, SPX_ESK_HEADER_BYTES) ||
+        spx_esk_bytes(layers) != (size_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    esk->map = map;
+    esk->bytes = (size_t)st.st_size;
+    esk->first_layer = SPX_D - layers;
+    for (i = esk->first_layer; i < SPX_D; i++) {
+        esk->layer_offset[i] = spx_esk_offset(esk->first_layer, i, 0);
+    }
+    return 0;
+}
+
+void spx_esk_close(spx_esk *esk)
+{
+    munmap((void *)esk->map, esk->bytes);
+    esk->map = NULL;
+    esk->bytes = 0;
+}
+
+const unsigned char *spx_esk_nodes(const spx_esk *esk,
+                                   unsigned int layer, uint64_t tree)
+{
+    return esk->map + esk->layer_offset[layer] +
+           tree * esk_record_bytes(esk->first_layer, layer);
+}
+
+const unsigned char *spx_esk_wots_sig(const spx_esk *esk, unsigned int layer,
+                                      uint64_t tree, uint32_t idx_leaf)
+{
+    if (layer == esk->first_layer) {
+        return NULL;
+    }
+    return spx_esk_nodes(esk, layer, tree) + SPX_ESK_NODES_BYTES +
+           idx_leaf * SPX_WOTS_BYTES;
+}
@@ -0,0 +1,112 @@
+#ifndef SPX_ESK_H
+#define SPX_ESK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+#include "sigcache.h"
+
+/*
+ * An expanded secret key: a file holding the top layers of the hypertree of
+ * a key pair, so that a signer reads those layers of every signature rather
+ * than computing them, from the first signature on.
+ *
+ * For each of the top k layers, and each subtree in it, the file holds all
+ * nodes of the subtree (as computed by treehash_nodes). For the layers above
+ * the lowest of them, it also holds the WOTS signature by every leaf, as
+ * these sign the roots of the subtrees of the layer below. In the lowest
+ * stored layer the signer still computes the WOTS signature, which is a
+ * small part of the work for that layer. The file holds no secret seeds;
+ * all of it appears in signatures.
+ *
+ * Layout: a header of SPX_ESK_HEADER_BYTES (magic, parameters, k, the public
+ * key), then the layers from the top down, each as its subtrees in order.
+ * Integers are big-endian.
+ */
+
+#define SPX_ESK_HEADER_BYTES 96
+/* Where the public key starts in the header. */
+#define SPX_ESK_PK_OFFSET 32
+
+typedef struct {
+    const unsigned char *map;
+    size_t bytes;
+    unsigned int first_layer;        /* the lowest layer stored */
+    size_t layer_offset[SPX_D];
+} spx_esk;
+
+/**
+ * Returns the size of an expanded secret key file holding the top layers
+ * layers of the hypertree.
+ */
+size_t spx_esk_bytes(unsigned int layers);
+
+/**
+ * Returns the largest number of layers whose file fits in budget bytes.
+ */
+unsigned int spx_esk_layers(size_t budget);
+
+/**
+ * Writes the header of a file holding the top layers layers for pk.
+ */
+void spx_esk_header(unsigned char *header, const uint8_t *pk,
+                    unsigned int layers);
+
+/**
+ * Returns the offset in the file of the subtree at (layer, tree), in a file
+ * whose lowest stored layer is first_layer.
+ */
+size_t spx_esk_offset(unsigned int first_layer, unsigned int layer,
+                      uint64_t tree);
+
+/**
+ * Maps the file at path read-only. Returns -1 if it cannot be opened, does
+ * not match the parameters, or is not for public key pk.
+ */
+int spx_esk_open(spx_esk *esk, const char *path, const uint8_t *pk);
+
+void spx_esk_close(spx_esk *esk);
+
+/**
+ * Returns the nodes of the stored subtree at (layer, tree).
+ */
+const unsigned char *spx_esk_nodes(const spx_esk *esk,
+                                   unsigned int layer, uint64_t tree);
+
+/**
+ * Returns the stored WOTS signature by leaf idx_leaf of the subtree at
+ * (layer, tree), or NULL if the file does not hold it.
+ */
+const unsigned char *spx_esk_wots_sig(const spx_esk *esk, unsigned int layer,
+                                      uint64_t tree, uint32_t idx_leaf);
+
+/**
+ * Computes the top layers layers for secret key sk, and writes them to a
+ * new file at path. Returns -1 if the file cannot be written.
+ */
+int crypto_sign_esk_write(const char *path, const uint8_t *sk,
+                          const spx_ctx *ctx, unsigned int layers);
+
+/**
+ * Generates a key pair from seed, like crypto_sign_seed_keypair, and writes
+ * its expanded secret key, as many layers as fit in budget bytes, to path.
+ * Returns -1 if not even the top layer fits in budget, or if the file cannot
+ * be written; pk and sk are generated either way.
+ */
+int crypto_sign_seed_keypair_esk(unsigned char *pk, unsigned char *sk,
+                                 const unsigned char *seed,
+                                 const char *path, size_t budget);
+
+/**
+ * Like crypto_sign_signature_ctx, but reads the layers stored in esk, and
+ * takes the subtrees below them from cache, if cache is not NULL. If esk or
+ * cache is for a different key, it is not used.
+ */
+int crypto_sign_signature_esk(uint8_t *sig, size_t *siglen,
+                              const uint8_t *m, size_t mlen,
+                              const uint8_t *sk, const spx_ctx *ctx,
+                              const spx_esk *esk, spx_sigcache *cache);
+
+#endif
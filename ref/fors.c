@@ -18,15 +18,15 @@ static void fors_gen_sk(unsigned char *sk, const unsigned char *sk_seed,
 
 
 static void fors_sk_to_leaf(unsigned char *leaf, const unsigned char *sk,
-                            const unsigned char *pub_seed,
+                            const spx_ctx *ctx,
                             uint32_t fors_leaf_addr[8])
 {
-    thash(leaf, sk, 1, pub_seed, fors_leaf_addr);
+    thash(leaf, sk, 1, ctx, fors_leaf_addr);
 }
 
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
 static void fors_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
-                          const unsigned char *pub_seed,
+                          const spx_ctx *ctx,
                           uint32_t addr_idx, const uint32_t fors_tree_addr[8])
 {
     uint32_t fors_leaf_addr[8] = {0};
@@ -37,7 +37,7 @@ static void fors_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
     set_tree_index(fors_leaf_addr, addr_idx);
 
     fors_gen_sk(leaf, sk_seed, fors_leaf_addr);
-    fors_sk_to_leaf(leaf, leaf, pub_seed, fors_leaf_addr);
+    fors_sk_to_leaf(leaf, leaf, ctx, fors_leaf_addr);
 }
 #endif
 
@@ -67,7 +67,7 @@ static void message_to_indices(uint32_t *indices, const unsigned char *m)
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
 void fors_sign(unsigned char *sig, unsigned char *pk,
                const unsigned char *m,
-               const unsigned char *sk_seed, const unsigned char *pub_seed,
+               const unsigned char *sk_seed, const spx_ctx *ctx,
                const uint32_t fors_addr[8])
 {
     uint32_t indices[SPX_FORS_TREES];
@@ -96,14 +96,14 @@ void fors_sign(unsigned char *sig, unsigned char *pk,
         sig += SPX_N;
 
         /* Compute the authentication path for this leaf node. */
-        treehash(roots + i*SPX_N, sig, sk_seed, pub_seed,
+        treehash(roots + i*SPX_N, sig, sk_seed, ctx,
                  indices[i], idx_offset, SPX_FORS_HEIGHT, fors_gen_leaf,
                  fors_tree_addr);
         sig += SPX_N * SPX_FORS_HEIGHT;
     }
 
     /* Hash horizontally across all tree roots to derive the public key. */
-    thash(pk, roots, SPX_FORS_TREES, pub_seed, fors_pk_addr);
+    thash(pk, roots, SPX_FORS_TREES, ctx, fors_pk_addr);
 }
 #endif
 
@@ -116,15 +116,16 @@ void fors_sign(unsigned char *sig, unsigned char *pk,
  */
 void fors_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *m,
-                      const unsigned char *pub_seed,
+                      const spx_ctx *ctx,
                       const uint32_t fors_addr[8])
 {
     uint32_t indices[SPX_FORS_TREES];
-    unsigned char roots[SPX_FORS_TREES * SPX_N];
+    unsigned char root[SPX_N];
     unsigned char leaf[SPX_N];
     uint32_t fors_tree_addr[8] = {0};
     uint32_t fors_pk_addr[8] = {0};
     uint32_t idx_offset;
+    spx_hash_stream s;
     unsigned int i;
 
     copy_keypair_addr(fors_tree_addr, fors_addr);
@@ -133,6 +134,10 @@ void fors_pk_from_sig(unsigned char *pk,
     set_type(fors_tree_addr, SPX_ADDR_TYPE_FORSTREE);
     set_type(fors_pk_addr, SPX_ADDR_TYPE_FORSPK);
 
+    /* Hash horizontally across all tree roots to derive the public key,
+       absorbing each root as soon as it is known. */
+    thash_init(&s, ctx, fors_pk_addr);
+
     message_to_indices(indices, m);
     for (i = 0; i < SPX_FORS_TREES; i++) {
         idx_offset = i * (1 << SPX_FORS_HEIGHT);
@@ -140,14 +145,58 @@ void fors_pk_from_sig(unsigned char *pk,
         set_tree_height(fors_tree_addr, 0);
         set_tree_index(fors_tree_addr, indices[i] + idx_offset);
         /* Derive the leaf from the included secret key part. */
-        fors_sk_to_leaf(leaf, sig, pub_seed, fors_tree_addr);
+        fors_sk_to_leaf(leaf, sig, ctx, fors_tree_addr);
         sig += SPX_N;
 
         /* Derive the corresponding root node of this tree. */
-        compute_root(roots + i*SPX_N, leaf, indices[i], idx_offset,
-                     sig, SPX_FORS_HEIGHT, pub_seed, fors_tree_addr);
+        compute_root(root, leaf, indices[i], idx_offset,
+                     sig, SPX_FORS_HEIGHT, ctx, fors_tree_addr);
         sig += SPX_N * SPX_FORS_HEIGHT;
+        thash_absorb(&s, root);
     }
-    /* Hash horizontally across all tree roots to derive the public key. */
-    thash(pk, roots, SPX_FORS_TREES, pub_seed, fors_pk_addr);
+    thash_final(pk, &s);
+}
+
+int fors_pk_from_sig_read(unsigned char *pk,
+                          spx_read_fn read, void *arg, const unsigned char *m,
+                          const spx_ctx *ctx,
+                          const uint32_t fors_addr[8])
+{
+    uint32_t indices[SPX_FORS_TREES];
+    unsigned char root[SPX_N];
+    unsigned char leaf[SPX_N];
+    /* The signature of one tree: its secret key part and auth path. */
+    unsigned char sig[SPX_N * (1 + SPX_FORS_HEIGHT)];
+    uint32_t fors_tree_addr[8] = {0};
+    uint32_t fors_pk_addr[8] = {0};
+    uint32_t idx_offset;
+    spx_hash_stream s;
+    unsigned int i;
+
+    copy_keypair_addr(fors_tree_addr, fors_addr);
+    copy_keypair_addr(fors_pk_addr, fors_addr);
+
+    set_type(fors_tree_addr, SPX_ADDR_TYPE_FORSTREE);
+    set_type(fors_pk_addr, SPX_ADDR_TYPE_FORSPK);
+
+    thash_init(&s, ctx, fors_pk_addr);
+
+    message_to_indices(indices, m);
+    for (i = 0; i < SPX_FORS_TREES; i++) {
+        if (read(arg, sig, sizeof sig)) {
+            return -1;
+        }
+        idx_offset = i * (1 << SPX_FORS_HEIGHT);
+
+        set_tree_height(fors_tree_addr, 0);
+        set_tree_index(fors_tree_addr, indices[i] + idx_offset);
+        fors_sk_to_leaf(leaf, sig, ctx, fors_tree_addr);
+
+        compute_root(root, leaf, indices[i], idx_offset,
+                     sig + SPX_N, SPX_FORS_HEIGHT, ctx, fors_tree_addr);
+        thash_absorb(&s, root);
+    }
+    thash_final(pk, &s);
+
+    return 0;
 }
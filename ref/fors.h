@@ -4,6 +4,8 @@
 #include <stdint.h>
 
 #include "params.h"
+#include "context.h"
+#include "sigread.h"
 
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
 /**
@@ -12,7 +14,7 @@
  */
 void fors_sign(unsigned char *sig, unsigned char *pk,
                const unsigned char *m,
-               const unsigned char *sk_seed, const unsigned char *pub_seed,
+               const unsigned char *sk_seed, const spx_ctx *ctx,
                const uint32_t fors_addr[8]);
 #endif
 
@@ -25,8 +27,16 @@ void fors_sign(unsigned char *sig, unsigned char *pk,
  */
 void fors_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *m,
-                      const unsigned char *pub_seed,
+                      const spx_ctx *ctx,
                       const uint32_t fors_addr[8]);
 
+/**
+ * Like fors_pk_from_sig, but reads the signature with read(arg, ...) one or a
+ * few trees at a time. Returns -1 if it cannot be read.
+ */
+int fors_pk_from_sig_read(unsigned char *pk,
+                          spx_read_fn read, void *arg, const unsigned char *m,
+                          const spx_ctx *ctx,
+                          const uint32_t fors_addr[8]);
 
 #endif
@@ -2,19 +2,56 @@
 #define SPX_HASH_H
 
 #include <stdint.h>
+#include "context.h"
 
-void initialize_hash_function(const unsigned char *pub_seed,
-                              const unsigned char *sk_seed);
+/*
+ * A SHA-256 state for a message that arrives in pieces of any length, so
+ * that it never has to be in memory as a whole.
+ */
+typedef struct {
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using
+a SHA256 implementation with the OpenSSL API */
+    SHA256_CTX sha2ctx;
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+    uint8_t state[40];
+    unsigned char buf[SPX_SHA256_BLOCK_BYTES];  /* an unfinished block */
+    unsigned int buflen;
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+} spx_hash_stream;
+
+/**
+ * Prepares ctx for the key pair with the given pub_seed. sk_prf may be NULL
+ * when ctx is only used to verify.
+ */
+void initialize_hash_function(spx_ctx *ctx, const unsigned char *pub_seed,
+                              const unsigned char *sk_prf);
 
 void prf_addr(unsigned char *out, const unsigned char *key,
               const uint32_t addr[8]);
 
+void hash_stream_update(spx_hash_stream *s,
+                        const unsigned char *m, unsigned long long mlen);
+
+void hash_stream_final(unsigned char *out, spx_hash_stream *s);
+
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim  
-void gen_message_random(unsigned char *R, const unsigned char *sk_seed,
+void gen_message_random_init(spx_hash_stream *s, const spx_ctx *ctx,
+                             const unsigned char *optrand);
+
+void gen_message_random_final(unsigned char *R, spx_hash_stream *s,
+                              const spx_ctx *ctx);
+
+void gen_message_random(unsigned char *R, const spx_ctx *ctx,
                         const unsigned char *optrand,
                         const unsigned char *m, unsigned long long mlen);
 #endif
 
+void hash_message_init(spx_hash_stream *s,
+                       const unsigned char *R, const unsigned char *pk);
+
+void hash_message_final(unsigned char *digest, uint64_t *tree,
+                        uint32_t *leaf_idx, spx_hash_stream *s);
+
 void hash_message(unsigned char *digest, uint64_t *tree, uint32_t *leaf_idx,
                   const unsigned char *R, const unsigned char *pk,
                   const unsigned char *m, unsigned long long mlen);
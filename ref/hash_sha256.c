@@ -6,14 +6,67 @@
 #include "params.h"
 #include "hash.h"
 #include "sha256.h"
+#include "context.h"
 
-/* For SHA256, there is no immediate reason to initialize at the start,
-   so this function is an empty operation. */
-void initialize_hash_function(const unsigned char *pub_seed,
-                              const unsigned char *sk_seed)
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
+/**
+ * Absorbs the block sk_prf ^ pad, padded with pad, into a fresh state. This is
+ * the first step of HMAC-SHA256, with pad 0x36 for the inner and 0x5c for the
+ * outer hash.
+ */
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
+a SHA256 implementation with the OpenSSL API */
+static void hmac_key_state(SHA256_CTX *sha2ctx, const unsigned char *sk_prf,
+                           unsigned char pad)
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+static void hmac_key_state(uint8_t *state, const unsigned char *sk_prf,
+                           unsigned char pad)
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
 {
-    seed_state(pub_seed);
-    (void)sk_seed; /* Suppress an 'unused parameter' warning. */
+    unsigned char buf[SPX_SHA256_BLOCK_BYTES];
+    int i;
+
+#if SPX_N > SPX_SHA256_BLOCK_BYTES
+    #error "Currently only supports SPX_N of at most SPX_SHA256_BLOCK_BYTES"
+#endif
+
+    for (i = 0; i < SPX_N; i++) {
+        buf[i] = pad ^ sk_prf[i];
+    }
+    memset(buf + SPX_N, pad, SPX_SHA256_BLOCK_BYTES - SPX_N);
+
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
+a SHA256 implementation with the OpenSSL API */
+    SHA256_Init(sha2ctx);
+    SHA256_Update(sha2ctx, buf, SPX_SHA256_BLOCK_BYTES);
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+    sha256_inc_init(state);
+    sha256_inc_blocks(state, buf, 1);
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+}
+#endif // #ifndef BUILD_SLIM_VERIFIER
+
+/* For SHA256, precompute the states that have absorbed the first block of
+   every keyed hash: pub_seed for thash, and the HMAC pads for sk_prf. */
+void initialize_hash_function(spx_ctx *ctx, const unsigned char *pub_seed,
+                              const unsigned char *sk_prf)
+{
+    memcpy(ctx->pub_seed, pub_seed, SPX_N);
+    seed_state(ctx);
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
+    if (sk_prf) {
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
+a SHA256 implementation with the OpenSSL API */
+        hmac_key_state(&ctx->sha2ctx_ipad, sk_prf, 0x36);
+        hmac_key_state(&ctx->sha2ctx_opad, sk_prf, 0x5c);
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+        hmac_key_state(ctx->state_ipad, sk_prf, 0x36);
+        hmac_key_state(ctx->state_opad, sk_prf, 0x5c);
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+    }
+#else
+    (void)sk_prf; /* Suppress an 'unused parameter' warning. */
+#endif // #ifndef BUILD_SLIM_VERIFIER
 }
 
 /*
@@ -25,98 +78,126 @@ void prf_addr(unsigned char *out, const unsigned char *key,
 {
     unsigned char buf[SPX_N + SPX_SHA256_ADDR_BYTES];
     unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
+    uint32_t state[8];
 
     memcpy(buf, key, SPX_N);
     compress_address(buf + SPX_N, addr);
 
-    sha256(outbuf, buf, SPX_N + SPX_SHA256_ADDR_BYTES);
+    /* A single compression from the IV, as key and address fit into one
+       block together with the padding. */
+    memcpy(state, spx_sha256_iv, sizeof state);
+    spx_sha256_finalize(outbuf, state, buf, SPX_N + SPX_SHA256_ADDR_BYTES, 0);
     memcpy(out, outbuf, SPX_N);
 }
 #endif
 
-/**
- * Computes the message-dependent randomness R, using a secret seed as a key
- * for HMAC, and an optional randomization value prefixed to the message.
- * This requires m to have at least SPX_SHA256_BLOCK_BYTES + SPX_N space
- * available in front of the pointer, i.e. before the message to use for the
- * prefix. This is necessary to prevent having to move the message around (and
- * allocate memory for it).
+/*
+ * Absorbs mlen more bytes of a message into s. Whole blocks are compressed
+ * straight from m; only the bytes of an unfinished block are buffered.
  */
-
-#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim   
-void gen_message_random(unsigned char *R, const unsigned char *sk_prf,
-                        const unsigned char *optrand,
+void hash_stream_update(spx_hash_stream *s,
                         const unsigned char *m, unsigned long long mlen)
 {
-    unsigned char buf[SPX_SHA256_BLOCK_BYTES + SPX_SHA256_OUTPUT_BYTES];
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-    SHA256_CTX sha2ctx;
+    SHA256_Update(&s->sha2ctx, m, mlen);
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    uint8_t state[40];
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    int i;
-
-#if SPX_N > SPX_SHA256_BLOCK_BYTES
-    #error "Currently only supports SPX_N of at most SPX_SHA256_BLOCK_BYTES"
-#endif
+    unsigned long long n;
 
-    /* This implements HMAC-SHA256 */
-    for (i = 0; i < SPX_N; i++) {
-        buf[i] = 0x36 ^ sk_prf[i];
+    /* Top up a block that an earlier call started. */
+    if (s->buflen > 0) {
+        n = SPX_SHA256_BLOCK_BYTES - s->buflen;
+        if (n > mlen) {
+            n = mlen;
+        }
+        memcpy(s->buf + s->buflen, m, n);
+        s->buflen += n;
+        m += n;
+        mlen -= n;
+        if (s->buflen < SPX_SHA256_BLOCK_BYTES) {
+            return;
+        }
+        sha256_inc_blocks(s->state, s->buf, 1);
+        s->buflen = 0;
     }
-    memset(buf + SPX_N, 0x36, SPX_SHA256_BLOCK_BYTES - SPX_N);
 
+    n = mlen / SPX_SHA256_BLOCK_BYTES;
+    sha256_inc_blocks(s->state, m, n);
+    m += n * SPX_SHA256_BLOCK_BYTES;
+    mlen -= n * SPX_SHA256_BLOCK_BYTES;
+
+    memcpy(s->buf, m, mlen);
+    s->buflen = mlen;
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+}
+
+/* Pads the message absorbed into s and writes its SHA-256 digest to out. */
+void hash_stream_final(unsigned char *out, spx_hash_stream *s)
+{
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-    SHA256_Init(&sha2ctx);
-    SHA256_Update(&sha2ctx, buf, 64);
+    SHA256_Final(out, &s->sha2ctx);
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    sha256_inc_init(state);
-    sha256_inc_blocks(state, buf, 1);
+    sha256_inc_finalize(out, s->state, s->buf, s->buflen);
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    memcpy(buf, optrand, SPX_N);
+}
+
+/**
+ * Computes the message-dependent randomness R, using a secret seed as a key
+ * for HMAC, and an optional randomization value prefixed to the message.
+ * The message is taken in pieces: gen_message_random_init absorbs optrand,
+ * hash_stream_update the message, and gen_message_random_final outputs R.
+ */
 
-    /* If optrand + message cannot fill up an entire block */
-    if (SPX_N + mlen < SPX_SHA256_BLOCK_BYTES) {
-        memcpy(buf + SPX_N, m, mlen);
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim   
+void gen_message_random_init(spx_hash_stream *s, const spx_ctx *ctx,
+                             const unsigned char *optrand)
+{
+    /* This implements HMAC-SHA256, starting from the state that has already
+       absorbed sk_prf ^ ipad (see initialize_hash_function) */
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, buf, mlen + SPX_N);
-        SHA256_Final(buf + SPX_SHA256_BLOCK_BYTES, &sha2ctx);
+    s->sha2ctx = ctx->sha2ctx_ipad;
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_finalize(buf + SPX_SHA256_BLOCK_BYTES, state,
-                            buf, mlen + SPX_N);
+    memcpy(s->state, ctx->state_ipad, 40);
+    s->buflen = 0;
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    }
-    /* Otherwise first fill a block, so that finalize only uses the message */
-    else {
-        memcpy(buf + SPX_N, m, SPX_SHA256_BLOCK_BYTES - SPX_N);
+    hash_stream_update(s, optrand, SPX_N);
+}
+
+void gen_message_random_final(unsigned char *R, spx_hash_stream *s,
+                              const spx_ctx *ctx)
+{
+    unsigned char buf[SPX_SHA256_OUTPUT_BYTES];
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, buf, 64);
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_blocks(state, buf, 1);
+    SHA256_CTX sha2ctx;
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
 
-        m += SPX_SHA256_BLOCK_BYTES - SPX_N;
-        mlen -= SPX_SHA256_BLOCK_BYTES - SPX_N;
+    hash_stream_final(buf, s);
+
+    /* The outer hash continues from the state that absorbed sk_prf ^ opad */
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, m, mlen);
-        SHA256_Final(buf + SPX_SHA256_BLOCK_BYTES, &sha2ctx);
+    sha2ctx = ctx->sha2ctx_opad;
+    SHA256_Update(&sha2ctx, buf, SPX_SHA256_OUTPUT_BYTES);
+    SHA256_Final(buf, &sha2ctx);
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_finalize(buf + SPX_SHA256_BLOCK_BYTES, state, m, mlen);
+    sha256_inc_finalize_block(buf, ctx->state_opad,
+                              buf, SPX_SHA256_OUTPUT_BYTES);
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    }
+    memcpy(R, buf, SPX_N);
+}
 
-    for (i = 0; i < SPX_N; i++) {
-        buf[i] = 0x5c ^ sk_prf[i];
-    }
-    memset(buf + SPX_N, 0x5c, SPX_SHA256_BLOCK_BYTES - SPX_N);
+void gen_message_random(unsigned char *R, const spx_ctx *ctx,
+                        const unsigned char *optrand,
+                        const unsigned char *m, unsigned long long mlen)
+{
+    spx_hash_stream s;
 
-    sha256(buf, buf, SPX_SHA256_BLOCK_BYTES + SPX_SHA256_OUTPUT_BYTES);
-    memcpy(R, buf, SPX_N);
+    gen_message_random_init(&s, ctx, optrand);
+    hash_stream_update(&s, m, mlen);
+    gen_message_random_final(R, &s, ctx);
 }
 #endif // #ifndef BUILD_SLIM_VERIFIER
 
@@ -124,10 +205,25 @@ a SHA256 implementation with the OpenSSL API */
  * Computes the message hash using R, the public key, and the message.
  * Outputs the message digest and the index of the leaf. The index is split in
  * the tree index and the leaf index, for convenient copying to an address.
+ * As for R, hash_message_init, hash_stream_update and hash_message_final
+ * take the message in pieces.
  */
-void hash_message(unsigned char *digest, uint64_t *tree, uint32_t *leaf_idx,
-                  const unsigned char *R, const unsigned char *pk,
-                  const unsigned char *m, unsigned long long mlen)
+void hash_message_init(spx_hash_stream *s,
+                       const unsigned char *R, const unsigned char *pk)
+{
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
+a SHA256 implementation with the OpenSSL API */
+    SHA256_Init(&s->sha2ctx);
+#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
+    sha256_inc_init(s->state);
+    s->buflen = 0;
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+    hash_stream_update(s, R, SPX_N);
+    hash_stream_update(s, pk, SPX_PK_BYTES);
+}
+
+void hash_message_final(unsigned char *digest, uint64_t *tree,
+                        uint32_t *leaf_idx, spx_hash_stream *s)
 {
 #define SPX_TREE_BITS (SPX_TREE_HEIGHT * (SPX_D - 1))
 #define SPX_TREE_BYTES ((SPX_TREE_BITS + 7) / 8)
@@ -136,61 +232,10 @@ void hash_message(unsigned char *digest, uint64_t *tree, uint32_t *leaf_idx,
 #define SPX_DGST_BYTES (SPX_FORS_MSG_BYTES + SPX_TREE_BYTES + SPX_LEAF_BYTES)
 
     unsigned char seed[SPX_SHA256_OUTPUT_BYTES];
-
-    /* Round to nearest multiple of SPX_SHA256_BLOCK_BYTES */
-#if (SPX_SHA256_BLOCK_BYTES & (SPX_SHA256_BLOCK_BYTES-1)) != 0
-    #error "Assumes that SPX_SHA256_BLOCK_BYTES is a power of 2"
-#endif
-#define SPX_INBLOCKS (((SPX_N + SPX_PK_BYTES + SPX_SHA256_BLOCK_BYTES - 1) & \
-                        -SPX_SHA256_BLOCK_BYTES) / SPX_SHA256_BLOCK_BYTES)
-    unsigned char inbuf[SPX_INBLOCKS * SPX_SHA256_BLOCK_BYTES];
-
     unsigned char buf[SPX_DGST_BYTES];
     unsigned char *bufp = buf;
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-    SHA256_CTX sha2ctx;
-    SHA256_Init(&sha2ctx);
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    uint8_t state[40];
-    sha256_inc_init(state);
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-
-    memcpy(inbuf, R, SPX_N);
-    memcpy(inbuf + SPX_N, pk, SPX_PK_BYTES);
-
-    /* If R + pk + message cannot fill up an entire block */
-    if (SPX_N + SPX_PK_BYTES + mlen < SPX_INBLOCKS * SPX_SHA256_BLOCK_BYTES) {
-        memcpy(inbuf + SPX_N + SPX_PK_BYTES, m, mlen);
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, inbuf, SPX_N + SPX_PK_BYTES + mlen);
-        SHA256_Final(seed, &sha2ctx);
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_finalize(seed, state, inbuf, SPX_N + SPX_PK_BYTES + mlen);
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    }
-    /* Otherwise first fill a block, so that finalize only uses the message */
-    else {
-        memcpy(inbuf + SPX_N + SPX_PK_BYTES, m,
-               SPX_INBLOCKS * SPX_SHA256_BLOCK_BYTES - SPX_N - SPX_PK_BYTES);
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, inbuf, 64*SPX_INBLOCKS);
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_blocks(state, inbuf, SPX_INBLOCKS);
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
 
-        m += SPX_INBLOCKS * SPX_SHA256_BLOCK_BYTES - SPX_N - SPX_PK_BYTES;
-        mlen -= SPX_INBLOCKS * SPX_SHA256_BLOCK_BYTES - SPX_N - SPX_PK_BYTES;
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-        SHA256_Update(&sha2ctx, m, mlen);
-        SHA256_Final(seed, &sha2ctx);
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-        sha256_inc_finalize(seed, state, m, mlen);
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-    }
+    hash_stream_final(seed, s);
 
     /* By doing this in two steps, we prevent hashing the message twice;
        otherwise each iteration in MGF1 would hash the message again. */
@@ -210,3 +255,14 @@ a SHA256 implementation with the OpenSSL API */
     *leaf_idx = bytes_to_ull(bufp, SPX_LEAF_BYTES);
     *leaf_idx &= (~(uint32_t)0) >> (32 - SPX_LEAF_BITS);
 }
+
+void hash_message(unsigned char *digest, uint64_t *tree, uint32_t *leaf_idx,
+                  const unsigned char *R, const unsigned char *pk,
+                  const unsigned char *m, unsigned long long mlen)
+{
+    spx_hash_stream s;
+
+    hash_message_init(&s, R, pk);
+    hash_stream_update(&s, m, mlen);
+    hash_message_final(digest, tree, leaf_idx, &s);
+}
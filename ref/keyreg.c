@@ -0,0 +1,123 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "keyreg.h"
+#include "api.h"
+#include "params.h"
+#include "utils.h"
+
+void spx_keyreg_init(spx_keyreg *reg, spx_keyreg_entry *slots, size_t nslots)
+{
+    size_t i;
+
+    for (i = 0; i < nslots; i++) {
+        slots[i].state = SPX_KEYREG_EMPTY;
+    }
+    reg->slots = slots;
+    reg->nslots = nslots;
+}
+
+/* The root in the public key is a hash output, so any bits of it will do. */
+static size_t keyreg_first_slot(const spx_keyreg *reg, const uint8_t *pk)
+{
+    return (size_t)(bytes_to_ull(pk + SPX_N, 8) % reg->nslots);
+}
+
+/**
+ * Probes the slots for pk, starting at its first slot. Returns the entry
+ * holding pk, or NULL. If pk is not there, *free_slot is set to the first
+ * empty slot on the way (or to nslots if there is none), and *busy to whether
+ * a slot that was still being written was passed.
+ */
+static spx_keyreg_entry *keyreg_probe(const spx_keyreg *reg,
+                                      const uint8_t *pk,
+                                      size_t *free_slot, int *busy)
+{
+    size_t i, slot;
+    int state;
+
+    *free_slot = reg->nslots;
+    *busy = 0;
+    if (reg->nslots == 0) {
+        return NULL;
+    }
+
+    slot = keyreg_first_slot(reg, pk);
+    for (i = 0; i < reg->nslots; i++) {
+        state = __atomic_load_n(&reg->slots[slot].state, __ATOMIC_ACQUIRE);
+        if (state == SPX_KEYREG_EMPTY) {
+            *free_slot = slot;
+            return NULL;
+        }
+        if (state == SPX_KEYREG_WRITING) {
+            *busy = 1;
+        }
+        else if (!memcmp(reg->slots[slot].pk, pk, SPX_PK_BYTES)) {
+            return &reg->slots[slot];
+        }
+        slot = slot + 1 == reg->nslots ? 0 : slot + 1;
+    }
+    return NULL;
+}
+
+const spx_ctx *spx_keyreg_find(const spx_keyreg *reg, const uint8_t *pk)
+{
+    spx_keyreg_entry *entry;
+    size_t free_slot;
+    int busy;
+
+    entry = keyreg_probe(reg, pk, &free_slot, &busy);
+    return entry ? &entry->ctx : NULL;
+}
+
+const spx_ctx *spx_keyreg_get(spx_keyreg *reg, const uint8_t *pk)
+{
+    spx_keyreg_entry *entry;
+    size_t free_slot;
+    int busy;
+    int expected;
+
+    for (;;) {
+        entry = keyreg_probe(reg, pk, &free_slot, &busy);
+        if (entry) {
+            return &entry->ctx;
+        }
+        /* The slot being written may be pk's; rather than wait for it,
+           let the caller do without the registry this time. */
+        if (busy || free_slot == reg->nslots) {
+            return NULL;
+        }
+
+        entry = &reg->slots[free_slot];
+        expected = SPX_KEYREG_EMPTY;
+        if (__atomic_compare_exchange_n(&entry->state, &expected,
+                                        SPX_KEYREG_WRITING, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            memcpy(entry->pk, pk, SPX_PK_BYTES);
+            crypto_sign_ctx_init_pk(&entry->ctx, pk);
+            __atomic_store_n(&entry->state, SPX_KEYREG_READY,
+                             __ATOMIC_RELEASE);
+            return &entry->ctx;
+        }
+        /* Another thread took the slot first; look again. */
+    }
+}
+
+/**
+ * Verifies a detached signature and message under a given public key, taking
+ * the context for pk from reg.
+ */
+int crypto_sign_verify_keyreg(const uint8_t *sig, size_t siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *pk,
+                              spx_keyreg *reg)
+{
+    const spx_ctx *ctx = spx_keyreg_get(reg, pk);
+    spx_ctx local_ctx;
+
+    if (!ctx) {
+        crypto_sign_ctx_init_pk(&local_ctx, pk);
+        ctx = &local_ctx;
+    }
+    return crypto_sign_verify_ctx(sig, siglen, m, mlen, pk, ctx);
+}
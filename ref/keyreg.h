@@ -0,0 +1,63 @@
+#ifndef SPX_KEYREG_H
+#define SPX_KEYREG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+
+/*
+ * A registry of verification contexts, keyed by public key, so that
+ * verifying many signatures under a known set of keys seeds every key's hash
+ * state once rather than once per signature.
+ *
+ * The registry is an open-addressing hash table over caller-provided slots.
+ * Keys are only ever added; lookups never take a lock, and concurrent
+ * additions claim slots with an atomic compare-and-swap. Because entries are
+ * never removed, a context returned by the registry remains valid until the
+ * slots are freed by the caller.
+ */
+
+typedef struct {
+    int state;                           /* SPX_KEYREG_* below */
+    unsigned char pk[SPX_PK_BYTES];
+    spx_ctx ctx;
+} spx_keyreg_entry;
+
+#define SPX_KEYREG_EMPTY   0
+#define SPX_KEYREG_WRITING 1
+#define SPX_KEYREG_READY   2
+
+typedef struct {
+    spx_keyreg_entry *slots;
+    size_t nslots;
+} spx_keyreg;
+
+/**
+ * Sets up reg to use the nslots entries at slots, which must stay available
+ * for as long as reg is used. A table at most about half full keeps lookups
+ * short; once all slots are taken, new keys are simply not registered.
+ */
+void spx_keyreg_init(spx_keyreg *reg, spx_keyreg_entry *slots, size_t nslots);
+
+/**
+ * Returns the context registered for pk, or NULL if pk is not registered.
+ */
+const spx_ctx *spx_keyreg_find(const spx_keyreg *reg, const uint8_t *pk);
+
+/**
+ * Returns the context for pk, registering pk first if needed. Returns NULL if
+ * the table is full, or if another thread is still registering pk; the
+ * caller should then prepare a context of its own.
+ */
+const spx_ctx *spx_keyreg_get(spx_keyreg *reg, const uint8_t *pk);
+
+/**
+ * Like crypto_sign_verify, but takes the context for pk from reg.
+ */
+int crypto_sign_verify_keyreg(const uint8_t *sig, size_t siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *pk,
+                              spx_keyreg *reg);
+
+#endif
@@ -0,0 +1,65 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nodecache.h"
+#include "params.h"
+#include "utils.h"
+
+void spx_nodecache_init(spx_nodecache *cache, spx_nodecache_entry *slots,
+                        size_t nslots, const uint8_t *pk)
+{
+    size_t i;
+
+    for (i = 0; i < nslots; i++) {
+        slots[i].used = 0;
+    }
+    cache->slots = slots;
+    cache->nslots = nslots;
+    memcpy(cache->pk, pk, SPX_PK_BYTES);
+    cache->hits = 0;
+}
+
+/* The signed root is a hash output, so any bits of it will do. */
+static spx_nodecache_entry *nodecache_slot(const spx_nodecache *cache,
+                                           const unsigned char *root)
+{
+    return &cache->slots[bytes_to_ull(root, 8) % cache->nslots];
+}
+
+const unsigned char *spx_nodecache_lookup(const spx_nodecache *cache,
+                                          uint32_t layer, uint64_t tree,
+                                          uint32_t idx_leaf,
+                                          const unsigned char *root)
+{
+    const spx_nodecache_entry *entry;
+
+    if (cache->nslots == 0) {
+        return NULL;
+    }
+    entry = nodecache_slot(cache, root);
+    if (entry->used && entry->layer == layer && entry->tree == tree &&
+        entry->idx_leaf == idx_leaf && !memcmp(entry->root, root, SPX_N)) {
+        return entry->auth_root;
+    }
+    return NULL;
+}
+
+void spx_nodecache_insert(spx_nodecache *cache,
+                          uint32_t layer, uint64_t tree, uint32_t idx_leaf,
+                          const unsigned char *root,
+                          const unsigned char *auth_root)
+{
+    spx_nodecache_entry *entry;
+
+    if (cache->nslots == 0) {
+        return;
+    }
+    entry = nodecache_slot(cache, root);
+    entry->used = 1;
+    entry->layer = layer;
+    entry->tree = tree;
+    entry->idx_leaf = idx_leaf;
+    memcpy(entry->root, root, SPX_N);
+    memcpy(entry->auth_root, auth_root, SPX_N);
+}
@@ -0,0 +1,74 @@
+#ifndef SPX_NODECACHE_H
+#define SPX_NODECACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+
+/*
+ * A cache of hypertree nodes that a verifier has already authenticated under
+ * one public key. Signatures by the same key share their upper layers: the
+ * top layer is always tree 0, and the layer below it has only a few trees. An
+ * entry records that the WOTS key pair at (layer, tree, leaf) signed a given
+ * root, and the root of the subtree that this key pair is a leaf of; both were
+ * shown to chain up to the root in the public key. A verifier that reaches a
+ * cached (layer, tree, leaf, signed root) can stop there.
+ *
+ * Only layers 1 and up are cached, as layer 0 signs a FORS public key that
+ * differs for every message. The cache has a fixed number of caller-provided
+ * slots, each holding one entry; a new entry replaces whatever was in its
+ * slot. It is not safe to use one cache from several threads at once.
+ */
+
+typedef struct {
+    int used;
+    uint32_t layer;
+    uint32_t idx_leaf;
+    uint64_t tree;
+    unsigned char root[SPX_N];       /* signed by the WOTS key pair */
+    unsigned char auth_root[SPX_N];  /* root of the subtree of the leaf */
+} spx_nodecache_entry;
+
+typedef struct {
+    spx_nodecache_entry *slots;
+    size_t nslots;
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned long hits;               /* verifications that stopped early */
+} spx_nodecache;
+
+/**
+ * Sets up cache to hold nodes under public key pk in the nslots entries at
+ * slots, which must stay available for as long as cache is used.
+ */
+void spx_nodecache_init(spx_nodecache *cache, spx_nodecache_entry *slots,
+                        size_t nslots, const uint8_t *pk);
+
+/**
+ * Returns the authenticated subtree root for the given signed root at
+ * (layer, tree, idx_leaf), or NULL if that node is not in the cache.
+ */
+const unsigned char *spx_nodecache_lookup(const spx_nodecache *cache,
+                                          uint32_t layer, uint64_t tree,
+                                          uint32_t idx_leaf,
+                                          const unsigned char *root);
+
+/**
+ * Records a node that was shown to chain up to the public key.
+ */
+void spx_nodecache_insert(spx_nodecache *cache,
+                          uint32_t layer, uint64_t tree, uint32_t idx_leaf,
+                          const unsigned char *root,
+                          const unsigned char *auth_root);
+
+/**
+ * Like crypto_sign_verify_ctx, but stops at the first hypertree node found in
+ * cache, and adds the nodes it authenticates to cache. If cache was set up
+ * for a different public key, it is not used.
+ */
+int crypto_sign_verify_cached(const uint8_t *sig, size_t siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *pk,
+                              const spx_ctx *ctx, spx_nodecache *cache);
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
+/* Takes and runs tasks until the batch is used up; called with the lock. */
+static void pool_take_tasks(spx_pool *pool)
+{
+    unsigned int i;
+
+    while (pool->next < pool->ntasks) {
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->task(pool->arg, i);
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->finished == pool->ntasks) {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+static void *pool_worker(void *arg)
+{
+    spx_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->next >= pool->ntasks) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        pool_take_tasks(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int spx_pool_init(spx_pool *pool, unsigned int nthreads)
+{
+    pool->nthreads = 0;
+    pool->ntasks = 0;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->stop = 0;
+    pool->threads = malloc((nthreads ? nthreads : 1) * sizeof(pthread_t));
+    if (!pool->threads) {
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (; pool->nthreads < nthreads; pool->nthreads++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL,
+                           pool_worker, pool)) {
+            spx_pool_destroy(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void spx_pool_run(spx_pool *pool, void (*task)(void *arg, unsigned int i),
+                  void *arg, unsigned int ntasks)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->ntasks = ntasks;
+    pool->next = 0;
+    pool->finished = 0;
+    pthread_cond_broadcast(&pool->start);
+
+    pool_take_tasks(pool);
+    while (pool->finished < pool->ntasks) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void spx_pool_destroy(spx_pool *pool)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->nthreads = 0;
+}
+#endif
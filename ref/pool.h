@@ -0,0 +1,59 @@
+#ifndef SPX_POOL_H
+#define SPX_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "params.h"
+#include "context.h"
+
+/*
+ * A pool of worker threads for signing. The FORS signature and the D subtree
+ * treehashes of a signature only depend on the indices that hash_message
+ * derives, so they run side by side; after them, the D WOTS signatures, which
+ * only need the roots, do as well. The thread that signs takes tasks too.
+ */
+
+typedef struct {
+    pthread_t *threads;
+    unsigned int nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;           /* a batch of tasks was posted */
+    pthread_cond_t done;            /* the last task of a batch finished */
+    void (*task)(void *arg, unsigned int i);
+    void *arg;
+    unsigned int ntasks;
+    unsigned int next;              /* the next task to be taken */
+    unsigned int finished;
+    int stop;
+} spx_pool;
+
+/**
+ * Starts nthreads worker threads, in addition to the threads that will call
+ * spx_pool_run. Returns -1 if they cannot be started.
+ */
+int spx_pool_init(spx_pool *pool, unsigned int nthreads);
+
+/**
+ * Runs task(arg, i) for i in 0..ntasks-1 on the pool and the calling thread,
+ * and returns when all have finished. Tasks are taken in order of i. Only one
+ * thread at a time may run tasks on a pool.
+ */
+void spx_pool_run(spx_pool *pool, void (*task)(void *arg, unsigned int i),
+                  void *arg, unsigned int ntasks);
+
+/**
+ * Stops the worker threads.
+ */
+void spx_pool_destroy(spx_pool *pool);
+
+/**
+ * Like crypto_sign_signature_ctx, but spreads the work over pool.
+ */
+int crypto_sign_signature_pool(uint8_t *sig, size_t *siglen,
+                               const uint8_t *m, size_t mlen,
+                               const uint8_t *sk, const spx_ctx *ctx,
+                               spx_pool *pool);
+
+#endif
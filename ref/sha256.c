@@ -8,6 +8,11 @@
 
 #include "utils.h"
 #include "sha256.h"
+#include "sha256shani.h"
+#include "context.h"
+#ifdef SPX_RUNTIME_DISPATCH
+#include "dispatch.h"
+#endif
 
 #if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256) // If using a SHA256 implementation from crypto_hash/sha512/ref/
 static uint32_t load_bigendian_32(const uint8_t *x) {
@@ -50,6 +55,28 @@ static void store_bigendian_64(uint8_t *x, uint64_t u) {
     x[0] = (uint8_t) u;
 }
 
+#ifdef SPX_WITH_SHANI /* If the Intel SHA extensions may be used */
+static size_t crypto_hashblocks_sha256_shani(uint8_t *statebytes,
+                                             const uint8_t *in, size_t inlen) {
+    uint32_t state[8];
+    size_t i;
+
+    for (i = 0; i < 8; i++) {
+        state[i] = load_bigendian_32(statebytes + 4*i);
+    }
+
+    sha256_shani_compress(state, in, inlen / 64);
+
+    for (i = 0; i < 8; i++) {
+        store_bigendian_32(statebytes + 4*i, state[i]);
+    }
+
+    return inlen & 63;
+}
+#endif // #ifdef SPX_WITH_SHANI
+
+#ifndef USE_SHANI_SHA256 // djb's portable compression function
+
 #define SHR(x, c) ((x) >> (c))
 #define ROTR_32(x, c) (((x) >> (c)) | ((x) << (32 - (c))))
 #define ROTR_64(x, c) (((x) >> (c)) | ((x) << (64 - (c))))
@@ -95,8 +122,84 @@ static void store_bigendian_64(uint8_t *x, uint64_t u) {
     a = T1 + T2;
 
 
-static size_t crypto_hashblocks_sha256(uint8_t *statebytes,
-                                       const uint8_t *in, size_t inlen) {
+/* The 64 rounds of one block, on message words w0 .. w15. */
+#define ROUNDS_32          \
+    F_32(w0, 0x428a2f98)   \
+    F_32(w1, 0x71374491)   \
+    F_32(w2, 0xb5c0fbcf)   \
+    F_32(w3, 0xe9b5dba5)   \
+    F_32(w4, 0x3956c25b)   \
+    F_32(w5, 0x59f111f1)   \
+    F_32(w6, 0x923f82a4)   \
+    F_32(w7, 0xab1c5ed5)   \
+    F_32(w8, 0xd807aa98)   \
+    F_32(w9, 0x12835b01)   \
+    F_32(w10, 0x243185be)  \
+    F_32(w11, 0x550c7dc3)  \
+    F_32(w12, 0x72be5d74)  \
+    F_32(w13, 0x80deb1fe)  \
+    F_32(w14, 0x9bdc06a7)  \
+    F_32(w15, 0xc19bf174)  \
+                           \
+    EXPAND_32              \
+                           \
+    F_32(w0, 0xe49b69c1)   \
+    F_32(w1, 0xefbe4786)   \
+    F_32(w2, 0x0fc19dc6)   \
+    F_32(w3, 0x240ca1cc)   \
+    F_32(w4, 0x2de92c6f)   \
+    F_32(w5, 0x4a7484aa)   \
+    F_32(w6, 0x5cb0a9dc)   \
+    F_32(w7, 0x76f988da)   \
+    F_32(w8, 0x983e5152)   \
+    F_32(w9, 0xa831c66d)   \
+    F_32(w10, 0xb00327c8)  \
+    F_32(w11, 0xbf597fc7)  \
+    F_32(w12, 0xc6e00bf3)  \
+    F_32(w13, 0xd5a79147)  \
+    F_32(w14, 0x06ca6351)  \
+    F_32(w15, 0x14292967)  \
+                           \
+    EXPAND_32              \
+                           \
+    F_32(w0, 0x27b70a85)   \
+    F_32(w1, 0x2e1b2138)   \
+    F_32(w2, 0x4d2c6dfc)   \
+    F_32(w3, 0x53380d13)   \
+    F_32(w4, 0x650a7354)   \
+    F_32(w5, 0x766a0abb)   \
+    F_32(w6, 0x81c2c92e)   \
+    F_32(w7, 0x92722c85)   \
+    F_32(w8, 0xa2bfe8a1)   \
+    F_32(w9, 0xa81a664b)   \
+    F_32(w10, 0xc24b8b70)  \
+    F_32(w11, 0xc76c51a3)  \
+    F_32(w12, 0xd192e819)  \
+    F_32(w13, 0xd6990624)  \
+    F_32(w14, 0xf40e3585)  \
+    F_32(w15, 0x106aa070)  \
+                           \
+    EXPAND_32              \
+                           \
+    F_32(w0, 0x19a4c116)   \
+    F_32(w1, 0x1e376c08)   \
+    F_32(w2, 0x2748774c)   \
+    F_32(w3, 0x34b0bcb5)   \
+    F_32(w4, 0x391c0cb3)   \
+    F_32(w5, 0x4ed8aa4a)   \
+    F_32(w6, 0x5b9cca4f)   \
+    F_32(w7, 0x682e6ff3)   \
+    F_32(w8, 0x748f82ee)   \
+    F_32(w9, 0x78a5636f)   \
+    F_32(w10, 0x84c87814)  \
+    F_32(w11, 0x8cc70208)  \
+    F_32(w12, 0x90befffa)  \
+    F_32(w13, 0xa4506ceb)  \
+    F_32(w14, 0xbef9a3f7)  \
+    F_32(w15, 0xc67178f2)
+
+static size_t crypto_hashblocks_sha256_djb(uint8_t *statebytes,
+                                           const uint8_t *in, size_t inlen) {
     uint32_t state[8];
     uint32_t a;
     uint32_t b;
@@ -144,79 +247,7 @@ static size_t crypto_hashblocks_sha256(uint8_t *statebytes,
         uint32_t w14 = load_bigendian_32(in + 56);
         uint32_t w15 = load_bigendian_32(in + 60);
 
-        F_32(w0, 0x428a2f98)
-        F_32(w1, 0x71374491)
-        F_32(w2, 0xb5c0fbcf)
-        F_32(w3, 0xe9b5dba5)
-        F_32(w4, 0x3956c25b)
-        F_32(w5, 0x59f111f1)
-        F_32(w6, 0x923f82a4)
-        F_32(w7, 0xab1c5ed5)
-        F_32(w8, 0xd807aa98)
-        F_32(w9, 0x12835b01)
-        F_32(w10, 0x243185be)
-        F_32(w11, 0x550c7dc3)
-        F_32(w12, 0x72be5d74)
-        F_32(w13, 0x80deb1fe)
-        F_32(w14, 0x9bdc06a7)
-        F_32(w15, 0xc19bf174)
-
-        EXPAND_32
-
-        F_32(w0, 0xe49b69c1)
-        F_32(w1, 0xefbe4786)
-        F_32(w2, 0x0fc19dc6)
-        F_32(w3, 0x240ca1cc)
-        F_32(w4, 0x2de92c6f)
-        F_32(w5, 0x4a7484aa)
-        F_32(w6, 0x5cb0a9dc)
-        F_32(w7, 0x76f988da)
-        F_32(w8, 0x983e5152)
-        F_32(w9, 0xa831c66d)
-        F_32(w10, 0xb00327c8)
-        F_32(w11, 0xbf597fc7)
-        F_32(w12, 0xc6e00bf3)
-        F_32(w13, 0xd5a79147)
-        F_32(w14, 0x06ca6351)
-        F_32(w15, 0x14292967)
-
-        EXPAND_32
-
-        F_32(w0, 0x27b70a85)
-        F_32(w1, 0x2e1b2138)
-        F_32(w2, 0x4d2c6dfc)
-        F_32(w3, 0x53380d13)
-        F_32(w4, 0x650a7354)
-        F_32(w5, 0x766a0abb)
-        F_32(w6, 0x81c2c92e)
-        F_32(w7, 0x92722c85)
-        F_32(w8, 0xa2bfe8a1)
-        F_32(w9, 0xa81a664b)
-        F_32(w10, 0xc24b8b70)
-        F_32(w11, 0xc76c51a3)
-        F_32(w12, 0xd192e819)
-        F_32(w13, 0xd6990624)
-        F_32(w14, 0xf40e3585)
-        F_32(w15, 0x106aa070)
-
-        EXPAND_32
-
-        F_32(w0, 0x19a4c116)
-        F_32(w1, 0x1e376c08)
-        F_32(w2, 0x2748774c)
-        F_32(w3, 0x34b0bcb5)
-        F_32(w4, 0x391c0cb3)
-        F_32(w5, 0x4ed8aa4a)
-        F_32(w6, 0x5b9cca4f)
-        F_32(w7, 0x682e6ff3)
-        F_32(w8, 0x748f82ee)
-        F_32(w9, 0x78a5636f)
-        F_32(w10, 0x84c87814)
-        F_32(w11, 0x8cc70208)
-        F_32(w12, 0x90befffa)
-        F_32(w13, 0xa4506ceb)
-        F_32(w14, 0xbef9a3f7)
-        F_32(w15, 0xc67178f2)
+        ROUNDS_32
 
         a += state[0];
         b += state[1];
@@ -252,6 +283,127 @@ static size_t crypto_hashblocks_sha256(uint8_t *statebytes,
     return inlen;
 }
 
+static void sha256_compress_words_djb(uint32_t state[8], const uint32_t w[16]) {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+    uint32_t T1;
+    uint32_t T2;
+    uint32_t w0  = w[0];
+    uint32_t w1  = w[1];
+    uint32_t w2  = w[2];
+    uint32_t w3  = w[3];
+    uint32_t w4  = w[4];
+    uint32_t w5  = w[5];
+    uint32_t w6  = w[6];
+    uint32_t w7  = w[7];
+    uint32_t w8  = w[8];
+    uint32_t w9  = w[9];
+    uint32_t w10 = w[10];
+    uint32_t w11 = w[11];
+    uint32_t w12 = w[12];
+    uint32_t w13 = w[13];
+    uint32_t w14 = w[14];
+    uint32_t w15 = w[15];
+
+    ROUNDS_32
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+#endif // #ifndef USE_SHANI_SHA256
+
+static size_t crypto_hashblocks_sha256(uint8_t *statebytes,
+                                       const uint8_t *in, size_t inlen) {
+#if defined(USE_SHANI_SHA256)
+    return crypto_hashblocks_sha256_shani(statebytes, in, inlen);
+#elif defined(SPX_RUNTIME_DISPATCH)
+    if (spx_dispatch.thash == SPX_IMPL_SHANI) {
+        return crypto_hashblocks_sha256_shani(statebytes, in, inlen);
+    }
+    return crypto_hashblocks_sha256_djb(statebytes, in, inlen);
+#else
+    return crypto_hashblocks_sha256_djb(statebytes, in, inlen);
+#endif
+}
+
+void sha256_compress_words(uint32_t state[8], const uint32_t w[16]) {
+#if defined(USE_SHANI_SHA256)
+    sha256_shani_compress_words(state, w);
+#elif defined(SPX_RUNTIME_DISPATCH)
+    if (spx_dispatch.thash == SPX_IMPL_SHANI) {
+        sha256_shani_compress_words(state, w);
+        return;
+    }
+    sha256_compress_words_djb(state, w);
+#else
+    sha256_compress_words_djb(state, w);
+#endif
+}
+
+void spx_sha256_compress(uint32_t state[8], const uint8_t block[64]) {
+#if defined(USE_SHANI_SHA256)
+    sha256_shani_compress(state, block, 1);
+#else
+    uint32_t w[16];
+    size_t i;
+
+#ifdef SPX_RUNTIME_DISPATCH
+    if (spx_dispatch.thash == SPX_IMPL_SHANI) {
+        sha256_shani_compress(state, block, 1);
+        return;
+    }
+#endif
+    for (i = 0; i < 16; i++) {
+        w[i] = load_bigendian_32(block + 4*i);
+    }
+    sha256_compress_words_djb(state, w);
+#endif
+}
+
+void sha256_chain_words(uint32_t *value, unsigned int nvalue,
+                        const uint32_t seeded[8], const uint32_t block[16],
+                        uint32_t start, unsigned int steps) {
+    uint32_t w[16];
+    uint32_t state[8];
+    unsigned int i, k;
+
+#ifdef SPX_WITH_SHANI
+#ifdef SPX_RUNTIME_DISPATCH
+    if (spx_dispatch.thash == SPX_IMPL_SHANI && nvalue == 8) {
+#else
+    if (nvalue == 8) {
+#endif
+        sha256_shani_chain(value, seeded, block, start, steps);
+        return;
+    }
+#endif // #ifdef SPX_WITH_SHANI
+
+    memcpy(w, block, sizeof w);
+    for (k = 0; k < steps; k++) {
+        w[5] = ((start + k) << 16) | (value[0] >> 16);
+        for (i = 1; i < nvalue; i++) {
+            w[5 + i] = (value[i - 1] << 16) | (value[i] >> 16);
+        }
+        w[5 + i] = (value[i - 1] << 16) | 0x8000;
+
+        memcpy(state, seeded, sizeof state);
+        sha256_compress_words(state, w);
+        memcpy(value, state, nvalue * sizeof(uint32_t));
+    }
+}
+
 static const uint8_t iv_256[32] = {
     0x6a, 0x09, 0xe6, 0x67, 0xbb, 0x67, 0xae, 0x85,
     0x3c, 0x6e, 0xf3, 0x72, 0xa5, 0x4f, 0xf5, 0x3a,
@@ -277,6 +429,28 @@ void sha256_inc_blocks(uint8_t *state, const uint8_t *in, size_t inblocks) {
     store_bigendian_64(state + 32, bytes);
 }
 
+#ifdef SPX_RUNTIME_DISPATCH
+void sha256_inc_blocks_impl(int impl, uint8_t *state, const uint8_t *in,
+                            size_t inblocks) {
+    uint64_t bytes = load_bigendian_64(state + 32);
+
+#ifdef USE_SHANI_SHA256
+    (void)impl;
+    crypto_hashblocks_sha256(state, in, 64 * inblocks);
+#else
+    if (impl == SPX_IMPL_SHANI) {
+        crypto_hashblocks_sha256_shani(state, in, 64 * inblocks);
+    }
+    else {
+        crypto_hashblocks_sha256_djb(state, in, 64 * inblocks);
+    }
+#endif
+    bytes += 64 * inblocks;
+
+    store_bigendian_64(state + 32, bytes);
+}
+#endif
+
 void sha256_inc_finalize(uint8_t *out, uint8_t *state, const uint8_t *in, size_t inlen) {
     uint8_t padded[128];
     uint64_t bytes = load_bigendian_64(state + 32) + inlen;
@@ -323,6 +497,36 @@ void sha256_inc_finalize(uint8_t *out, uint8_t *state, const uint8_t *in, size_t
         out[i] = state[i];
     }
 }
+
+/**
+ * Like sha256_inc_finalize, but for inputs that fit into a single block
+ * together with the padding (inlen < 56), so that exactly one compression is
+ * performed. Leaves state untouched, so a precomputed midstate such as
+ * state_seeded can be used directly without copying it first.
+ * Always writes SPX_SHA256_OUTPUT_BYTES bytes to out.
+ */
+void sha256_inc_finalize_block(uint8_t *out, const uint8_t *state,
+                               const uint8_t *in, size_t inlen) {
+    uint8_t padded[64];
+    uint64_t bytes = load_bigendian_64(state + 32) + inlen;
+    size_t i;
+
+    for (i = 0; i < inlen; ++i) {
+        padded[i] = in[i];
+    }
+    padded[inlen] = 0x80;
+    for (i = inlen + 1; i < 56; ++i) {
+        padded[i] = 0;
+    }
+    store_bigendian_64(padded + 56, bytes << 3);
+
+    /* The first 32 bytes of the state are the big-endian chaining value,
+       which the compression turns into the digest in place. */
+    for (i = 0; i < 32; ++i) {
+        out[i] = state[i];
+    }
+    crypto_hashblocks_sha256(out, padded, 64);
+}
 #endif //#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
 
 void sha256(uint8_t *out, const uint8_t *in, size_t inlen) {
@@ -332,7 +536,12 @@ a SHA256 implementation with the OpenSSL API */
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
     uint8_t state[40];
     sha256_inc_init(state);
-    sha256_inc_finalize(out, state, in, inlen);
+    if (inlen < 56) { /* e.g. prf_addr and mgf1 */
+        sha256_inc_finalize_block(out, state, in, inlen);
+    }
+    else {
+        sha256_inc_finalize(out, state, in, inlen);
+    }
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
 }
 
@@ -535,6 +744,68 @@ void SHA256(const void *image, unsigned int len, unsigned char *result) {
 }
 #endif // #ifdef USE_OPENSSL_API_SHA256 
 
+#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
+a SHA256 implementation with the OpenSSL API */
+void spx_sha256_compress(uint32_t state[8], const uint8_t block[64]) {
+    SHA256_CTX sha2ctx;
+    size_t i;
+
+    for (i = 0; i < 8; i++) {
+        sha2ctx.h[i] = state[i];
+    }
+#ifdef USE_OPENSSL_SHA256
+    SHA256_Transform(&sha2ctx, block);
+#else
+    sha256_compress(&sha2ctx, block);
+#endif
+    for (i = 0; i < 8; i++) {
+        state[i] = (uint32_t)sha2ctx.h[i];
+    }
+}
+
+void sha256_compress_words(uint32_t state[8], const uint32_t w[16]) {
+    uint8_t block[SPX_SHA256_BLOCK_BYTES];
+    size_t i;
+
+    for (i = 0; i < 16; i++) {
+        ull_to_bytes(block + 4*i, 4, w[i]);
+    }
+    spx_sha256_compress(state, block);
+}
+#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+
+const uint32_t spx_sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+void spx_sha256_finalize(uint8_t *out, uint32_t state[8],
+                         const uint8_t *in, size_t inlen, size_t prefixlen) {
+    uint8_t padded[2*SPX_SHA256_BLOCK_BYTES];
+    uint64_t bytes = prefixlen + inlen;
+    size_t padlen;
+    size_t i;
+
+    for (; inlen >= SPX_SHA256_BLOCK_BYTES; inlen -= SPX_SHA256_BLOCK_BYTES) {
+        spx_sha256_compress(state, in);
+        in += SPX_SHA256_BLOCK_BYTES;
+    }
+
+    padlen = inlen < 56 ? SPX_SHA256_BLOCK_BYTES : 2*SPX_SHA256_BLOCK_BYTES;
+    memcpy(padded, in, inlen);
+    padded[inlen] = 0x80;
+    memset(padded + inlen + 1, 0, padlen - 8 - (inlen + 1));
+    ull_to_bytes(padded + padlen - 8, 8, bytes << 3);
+
+    spx_sha256_compress(state, padded);
+    if (padlen > SPX_SHA256_BLOCK_BYTES) {
+        spx_sha256_compress(state, padded + SPX_SHA256_BLOCK_BYTES);
+    }
+    for (i = 0; i < 8; i++) {
+        ull_to_bytes(out + 4*i, 4, state[i]);
+    }
+}
+
 /*
  * Compresses an address to a 22-byte sequence.
  * This reduces the number of required SHA256 compression calls, as the last
@@ -559,44 +830,50 @@ void compress_address(unsigned char *out, const uint32_t addr[8])
 void mgf1(unsigned char *out, unsigned long outlen,
           const unsigned char *in, unsigned long inlen)
 {
-    unsigned char inbuf[inlen + 4];
+    /* The whole blocks of in are the same for every counter, so they are
+       compressed once; each output block then costs the compressions of the
+       tail of in, the counter and the padding, i.e. one for a seed. */
+    const unsigned long prefixlen = inlen - inlen % SPX_SHA256_BLOCK_BYTES;
+    const unsigned long taillen = inlen - prefixlen;
+    unsigned char tail[SPX_SHA256_BLOCK_BYTES + 4];
     unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
+    uint32_t prefix[8];
+    uint32_t state[8];
     unsigned long i;
 
-    memcpy(inbuf, in, inlen);
+    memcpy(prefix, spx_sha256_iv, sizeof prefix);
+    for (i = 0; i < prefixlen; i += SPX_SHA256_BLOCK_BYTES) {
+        spx_sha256_compress(prefix, in + i);
+    }
+    memcpy(tail, in + prefixlen, taillen);
 
     /* While we can fit in at least another full block of SHA256 output.. */
     for (i = 0; (i+1)*SPX_SHA256_OUTPUT_BYTES <= outlen; i++) {
-        ull_to_bytes(inbuf + inlen, 4, i);
-        sha256(out, inbuf, inlen + 4);
+        ull_to_bytes(tail + taillen, 4, i);
+        memcpy(state, prefix, sizeof state);
+        spx_sha256_finalize(out, state, tail, taillen + 4, prefixlen);
         out += SPX_SHA256_OUTPUT_BYTES;
     }
     /* Until we cannot anymore, and we fill the remainder. */
     if (outlen > i*SPX_SHA256_OUTPUT_BYTES) {
-        ull_to_bytes(inbuf + inlen, 4, i);
-        sha256(outbuf, inbuf, inlen + 4);
+        ull_to_bytes(tail + taillen, 4, i);
+        memcpy(state, prefix, sizeof state);
+        spx_sha256_finalize(outbuf, state, tail, taillen + 4, prefixlen);
         memcpy(out, outbuf, outlen - i*SPX_SHA256_OUTPUT_BYTES);
     }
 }
 
 
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-SHA256_CTX sha2ctx_seeded; 
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-uint8_t state_seeded[40];
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-
 /**
  * Absorb the constant pub_seed using one round of the compression function
- * This initializes state_seeded, which can then be reused in thash
+ * This initializes the seeded state of ctx, which can then be reused in thash
  **/
-void seed_state(const unsigned char *pub_seed) {
+void seed_state(spx_ctx *ctx) {
     uint8_t block[SPX_SHA256_BLOCK_BYTES];
     size_t i;
 
     for (i = 0; i < SPX_N; ++i) {
-        block[i] = pub_seed[i];
+        block[i] = ctx->pub_seed[i];
     }
     for (i = SPX_N; i < SPX_SHA256_BLOCK_BYTES; ++i) {
         block[i] = 0;
@@ -604,11 +881,13 @@ void seed_state(const unsigned char *pub_seed) {
 
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-    SHA256_Init(&sha2ctx_seeded);
-    SHA256_Update(&sha2ctx_seeded, block, 64);
+    SHA256_Init(&ctx->sha2ctx_seeded);
+    SHA256_Update(&ctx->sha2ctx_seeded, block, 64);
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    sha256_inc_init(state_seeded);
-    sha256_inc_blocks(state_seeded, block, 1);
+    sha256_inc_init(ctx->state_seeded);
+    sha256_inc_blocks(ctx->state_seeded, block, 1);
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
-}
 
+    memcpy(ctx->seeded_words, spx_sha256_iv, sizeof ctx->seeded_words);
+    spx_sha256_compress(ctx->seeded_words, block);
+}
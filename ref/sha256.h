@@ -16,7 +16,6 @@
 #if defined(USE_OPENSSL_SHA256) // If you want to use the OpenSSL SHA256 implementation
 
 #include <openssl/sha.h>
-SHA256_CTX sha2ctx_seeded; 
 
 #elif defined(USE_OPENSSL_API_SHA256) /* If you want to use a local SHA256 implementation 
 with the same API as OpenSSL */
@@ -41,20 +40,58 @@ void SHA256_Final(unsigned char *,
 
 void SHA256(const void *image, unsigned int len, unsigned char *result);
 
-SHA256_CTX sha2ctx_seeded; 
-
 #else /* If you want to use a local SHA256 implementation from 
  * crypto_hash/sha512/ref/ in http://bench.cr.yp.to/supercop.html
- * by D. J. Bernstein */
+ * by D. J. Bernstein. Define USE_SHANI_SHA256 as well to replace its
+ * compression function with one that uses the Intel SHA extensions. */
 
 void sha256_inc_init(uint8_t *state);
 void sha256_inc_blocks(uint8_t *state, const uint8_t *in, size_t inblocks);
 void sha256_inc_finalize(uint8_t *out, uint8_t *state, const uint8_t *in, size_t inlen);
-
-uint8_t state_seeded[40];
+void sha256_inc_finalize_block(uint8_t *out, const uint8_t *state,
+                               const uint8_t *in, size_t inlen);
+
+/**
+ * The compressions of a WOTS chain, for thash_chain_seeded. Compresses block
+ * from seeded steps times, each time with words 5 .. 5+nvalue replaced by the
+ * hash address start + k in the top half of word 5, the nvalue value words
+ * shifted right by 16 bits, and the 0x80 padding byte; the first nvalue words
+ * of the output then become value. With SHA-NI and nvalue = 8 (n = 32), the
+ * value never leaves the vector registers in between.
+ */
+void sha256_chain_words(uint32_t *value, unsigned int nvalue,
+                        const uint32_t seeded[8], const uint32_t block[16],
+                        uint32_t start, unsigned int steps);
 
 #endif // #ifdef USE_OPENSSL_SHA256
 
+/**
+ * Applies the compression function to one 64-byte block, to a chaining value
+ * kept as eight native words. Every SHA256 implementation provides it: djb's
+ * code, or SHA-NI where enabled, and SHA256_Transform with the OpenSSL API.
+ * prf_addr, thash and mgf1 are built on it, so that each costs its
+ * compression calls and no incremental-state bookkeeping.
+ */
+void spx_sha256_compress(uint32_t state[8], const uint8_t block[64]);
+
+/**
+ * spx_sha256_compress for a block given as its sixteen big-endian message
+ * words. For callers that assemble fixed-length blocks directly.
+ */
+void sha256_compress_words(uint32_t state[8], const uint32_t w[16]);
+
+/**
+ * Like sha256_inc_finalize, for a state that has already absorbed the first
+ * prefixlen bytes, a multiple of the block size: compresses whole blocks of
+ * in straight from in, then the rest with the padding, and writes the
+ * SPX_SHA256_OUTPUT_BYTES-byte digest to out.
+ */
+void spx_sha256_finalize(uint8_t *out, uint32_t state[8],
+                         const uint8_t *in, size_t inlen, size_t prefixlen);
+
+/* The initial chaining value of SHA-256, as native words. */
+extern const uint32_t spx_sha256_iv[8];
+
 void sha256(uint8_t *out, const uint8_t *in, size_t inlen);
 
 void compress_address(unsigned char *out, const uint32_t addr[8]);
@@ -62,6 +99,4 @@ void compress_address(unsigned char *out, const uint32_t addr[8]);
 void mgf1(unsigned char *out, unsigned long outlen,
           const unsigned char *in, unsigned long inlen);
 
-void seed_state(const unsigned char *pub_seed);
-
 #endif
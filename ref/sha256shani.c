@@ -0,0 +1,208 @@
+/* SHA-256 compression using the Intel SHA extensions (SHA-NI).
+ * Only built when USE_SHANI_SHA256 is defined, which requires -msha -msse4.1
+ * or a -march that implies them, or with SPX_RUNTIME_DISPATCH, in which case
+ * the kernels are built for SHA-NI regardless of the flags and only called
+ * when cpuid reports it. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256shani.h"
+
+#ifdef SPX_WITH_SHANI
+#ifdef SPX_RUNTIME_DISPATCH
+#pragma GCC target("sha,sse4.1")
+#endif
+#include <immintrin.h>
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* The rnds2 instruction wants the state as (a, b, e, f), (c, d, g, h). */
+static void shani_load_state(__m128i *STATE0, __m128i *STATE1,
+                             const uint32_t state[8])
+{
+    __m128i TMP;
+
+    TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+    *STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);             /* CDAB */
+    *STATE1 = _mm_shuffle_epi32(*STATE1, 0x1B);     /* EFGH */
+    *STATE0 = _mm_alignr_epi8(TMP, *STATE1, 8);     /* ABEF */
+    *STATE1 = _mm_blend_epi16(*STATE1, TMP, 0xF0);  /* CDGH */
+}
+
+/* Turns (a, b, e, f), (c, d, g, h) back into (a, b, c, d), (e, f, g, h). */
+static inline void shani_unpack_state(__m128i *STATE0, __m128i *STATE1)
+{
+    __m128i TMP;
+
+    TMP = _mm_shuffle_epi32(*STATE0, 0x1B);         /* FEBA */
+    *STATE1 = _mm_shuffle_epi32(*STATE1, 0xB1);     /* DCHG */
+    *STATE0 = _mm_blend_epi16(TMP, *STATE1, 0xF0);  /* DCBA */
+    *STATE1 = _mm_alignr_epi8(*STATE1, TMP, 8);     /* ABEF */
+}
+
+static void shani_store_state(uint32_t state[8],
+                              __m128i STATE0, __m128i STATE1)
+{
+    shani_unpack_state(&STATE0, &STATE1);
+
+    _mm_storeu_si128((__m128i *)&state[0], STATE0);
+    _mm_storeu_si128((__m128i *)&state[4], STATE1);
+}
+
+#define SHANI_MASK _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL)
+
+/* Loads the k-th 16 bytes of a block as big-endian schedule words. */
+#define SHANI_LOAD(W, in, k)                                                 \
+    W = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)((in) + 16*(k))),  \
+                         SHANI_MASK)
+
+/* Loads the k-th four message words of a block given as words. */
+#define SHANI_LOADW(W, w, k)                                                 \
+    W = _mm_loadu_si128((const __m128i *)((w) + 4*(k)))
+
+/* Replaces Wa by the next four schedule words, given Wb, Wc, Wd. */
+#define SHANI_SCHED(Wa, Wb, Wc, Wd)                                          \
+    Wa = _mm_sha256msg2_epu32(                                               \
+        _mm_add_epi32(_mm_sha256msg1_epu32(Wa, Wb),                          \
+                      _mm_alignr_epi8(Wd, Wc, 4)), Wd)
+
+/* Rounds 4k .. 4k+3, using the schedule words in W. */
+#define SHANI_ROUNDS(S0, S1, W, k) do {                                      \
+    __m128i MSG_ = _mm_add_epi32(W,                                          \
+        _mm_loadu_si128((const __m128i *)&K256[4*(k)]));                     \
+    S1 = _mm_sha256rnds2_epu32(S1, S0, MSG_);                                \
+    MSG_ = _mm_shuffle_epi32(MSG_, 0x0E);                                    \
+    S0 = _mm_sha256rnds2_epu32(S0, S1, MSG_);                                \
+} while (0)
+
+#define SHANI_STEP(S0, S1, Wa, Wb, Wc, Wd, k) do {                           \
+    SHANI_SCHED(Wa, Wb, Wc, Wd);                                             \
+    SHANI_ROUNDS(S0, S1, Wa, k);                                             \
+} while (0)
+
+void sha256_shani_compress(uint32_t state[8],
+                           const uint8_t *in, size_t inblocks)
+{
+    __m128i A0, A1, SA0, SA1, WA0, WA1, WA2, WA3;
+    unsigned int k;
+
+    shani_load_state(&A0, &A1, state);
+
+    while (inblocks--) {
+        SA0 = A0; SA1 = A1;
+
+        SHANI_LOAD(WA0, in, 0); SHANI_ROUNDS(A0, A1, WA0, 0);
+        SHANI_LOAD(WA1, in, 1); SHANI_ROUNDS(A0, A1, WA1, 1);
+        SHANI_LOAD(WA2, in, 2); SHANI_ROUNDS(A0, A1, WA2, 2);
+        SHANI_LOAD(WA3, in, 3); SHANI_ROUNDS(A0, A1, WA3, 3);
+        for (k = 4; k < 16; k += 4) {
+            SHANI_STEP(A0, A1, WA0, WA1, WA2, WA3, k);
+            SHANI_STEP(A0, A1, WA1, WA2, WA3, WA0, k + 1);
+            SHANI_STEP(A0, A1, WA2, WA3, WA0, WA1, k + 2);
+            SHANI_STEP(A0, A1, WA3, WA0, WA1, WA2, k + 3);
+        }
+
+        A0 = _mm_add_epi32(A0, SA0); A1 = _mm_add_epi32(A1, SA1);
+        in += 64;
+    }
+
+    shani_store_state(state, A0, A1);
+}
+
+void sha256_shani_compress_words(uint32_t state[8], const uint32_t w[16])
+{
+    __m128i A0, A1, SA0, SA1, WA0, WA1, WA2, WA3;
+    unsigned int k;
+
+    shani_load_state(&A0, &A1, state);
+    SA0 = A0; SA1 = A1;
+
+    SHANI_LOADW(WA0, w, 0); SHANI_ROUNDS(A0, A1, WA0, 0);
+    SHANI_LOADW(WA1, w, 1); SHANI_ROUNDS(A0, A1, WA1, 1);
+    SHANI_LOADW(WA2, w, 2); SHANI_ROUNDS(A0, A1, WA2, 2);
+    SHANI_LOADW(WA3, w, 3); SHANI_ROUNDS(A0, A1, WA3, 3);
+    for (k = 4; k < 16; k += 4) {
+        SHANI_STEP(A0, A1, WA0, WA1, WA2, WA3, k);
+        SHANI_STEP(A0, A1, WA1, WA2, WA3, WA0, k + 1);
+        SHANI_STEP(A0, A1, WA2, WA3, WA0, WA1, k + 2);
+        SHANI_STEP(A0, A1, WA3, WA0, WA1, WA2, k + 3);
+    }
+
+    A0 = _mm_add_epi32(A0, SA0); A1 = _mm_add_epi32(A1, SA1);
+    shani_store_state(state, A0, A1);
+}
+
+void sha256_shani_chain(uint32_t value[8], const uint32_t seeded[8],
+                        const uint32_t block[16], uint32_t start,
+                        unsigned int steps)
+{
+    __m128i S0, S1, A0, A1, WA0, WA1, WA2, WA3;
+    __m128i LO, HI, PREV, W0, W4, TAIL, HASH, ONE;
+    unsigned int k, r;
+
+    shani_load_state(&S0, &S1, seeded);
+    LO = _mm_loadu_si128((const __m128i *)&value[0]);
+    HI = _mm_loadu_si128((const __m128i *)&value[4]);
+
+    /* Words 0 .. 3 are fixed. The others are assembled from lanes 3 of W4
+       and HASH, the value words in LO and HI, and words 14 and 15 in TAIL,
+       which also holds the padding byte in the bottom half of word 13. */
+    W0 = _mm_loadu_si128((const __m128i *)&block[0]);
+    W4 = _mm_set_epi32((int)block[4], 0, 0, 0);
+    HASH = _mm_set_epi32((int)start, 0, 0, 0);
+    ONE = _mm_set_epi32(1, 0, 0, 0);
+    TAIL = _mm_set_epi32(0, (int)block[15], (int)block[14], 0x8000);
+
+    for (k = 0; k < steps; k++) {
+        /* Words 5 .. 12 are (u[i] << 16) | (u[i + 1] >> 16) for the
+           sequence u = hash address, value[0], .., value[7]. */
+        PREV = _mm_alignr_epi8(LO, HASH, 12);
+        WA1 = _mm_or_si128(_mm_slli_epi32(PREV, 16), _mm_srli_epi32(LO, 16));
+        PREV = _mm_alignr_epi8(HI, LO, 12);
+        WA2 = _mm_or_si128(_mm_slli_epi32(PREV, 16), _mm_srli_epi32(HI, 16));
+        WA3 = _mm_or_si128(_mm_srli_si128(_mm_slli_epi32(HI, 16), 12), TAIL);
+        WA3 = _mm_alignr_epi8(WA3, WA2, 12);
+        WA2 = _mm_alignr_epi8(WA2, WA1, 12);
+        WA1 = _mm_alignr_epi8(WA1, W4, 12);
+        WA0 = W0;
+
+        A0 = S0; A1 = S1;
+        SHANI_ROUNDS(A0, A1, WA0, 0);
+        SHANI_ROUNDS(A0, A1, WA1, 1);
+        SHANI_ROUNDS(A0, A1, WA2, 2);
+        SHANI_ROUNDS(A0, A1, WA3, 3);
+        for (r = 4; r < 16; r += 4) {
+            SHANI_STEP(A0, A1, WA0, WA1, WA2, WA3, r);
+            SHANI_STEP(A0, A1, WA1, WA2, WA3, WA0, r + 1);
+            SHANI_STEP(A0, A1, WA2, WA3, WA0, WA1, r + 2);
+            SHANI_STEP(A0, A1, WA3, WA0, WA1, WA2, r + 3);
+        }
+        LO = _mm_add_epi32(A0, S0); HI = _mm_add_epi32(A1, S1);
+        shani_unpack_state(&LO, &HI);
+
+        HASH = _mm_add_epi32(HASH, ONE);
+    }
+
+    _mm_storeu_si128((__m128i *)&value[0], LO);
+    _mm_storeu_si128((__m128i *)&value[4], HI);
+}
+#endif // #ifdef SPX_WITH_SHANI
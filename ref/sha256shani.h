@@ -0,0 +1,35 @@
+#ifndef SPX_SHA256SHANI_H
+#define SPX_SHA256SHANI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The kernels are built into the library with USE_SHANI_SHA256, and for
+   runtime dispatch, where cpuid decides whether they are used. */
+#if defined(USE_SHANI_SHA256) || defined(SPX_RUNTIME_DISPATCH)
+#define SPX_WITH_SHANI
+#endif
+
+/**
+ * Applies the SHA-256 compression function to inblocks consecutive 64-byte
+ * blocks, using the Intel SHA extensions. The state is kept as eight native
+ * 32-bit words, in the usual order a, b, .., h.
+ */
+void sha256_shani_compress(uint32_t state[8],
+                           const uint8_t *in, size_t inblocks);
+
+/**
+ * Like sha256_shani_compress for a single block that is given as sixteen
+ * message words, i.e. already loaded big-endian.
+ */
+void sha256_shani_compress_words(uint32_t state[8], const uint32_t w[16]);
+
+/**
+ * sha256_chain_words for nvalue = 8, keeping the chain value and the seeded
+ * state in registers across all steps.
+ */
+void sha256_shani_chain(uint32_t value[8], const uint32_t seeded[8],
+                        const uint32_t block[16], uint32_t start,
+                        unsigned int steps);
+
+#endif
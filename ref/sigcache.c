@@ -0,0 +1,130 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sigcache.h"
+#include "params.h"
+
+void spx_sigcache_init(spx_sigcache *cache, void *mem, size_t bytes,
+                       const uint8_t *pk)
+{
+    size_t n = bytes / SPX_SIGCACHE_ENTRY_BYTES;
+    uint32_t i;
+
+    if (n > SPX_SIGCACHE_NONE - 1) {
+        n = SPX_SIGCACHE_NONE - 1;
+    }
+    /* The entries come first, so that they get the alignment of mem. */
+    cache->entries = mem;
+    cache->buckets = (uint32_t *)(cache->entries + n);
+    cache->nentries = (uint32_t)n;
+    cache->nused = 0;
+    cache->head = SPX_SIGCACHE_NONE;
+    cache->tail = SPX_SIGCACHE_NONE;
+    for (i = 0; i < cache->nentries; i++) {
+        cache->buckets[i] = SPX_SIGCACHE_NONE;
+    }
+    memcpy(cache->pk, pk, SPX_PK_BYTES);
+    cache->hits = 0;
+}
+
+static uint32_t sigcache_bucket(const spx_sigcache *cache, uint32_t layer,
+                                uint64_t tree)
+{
+    return (uint32_t)((tree * SPX_D + layer) % cache->nentries);
+}
+
+static void sigcache_unlink(spx_sigcache *cache, uint32_t i)
+{
+    spx_sigcache_entry *e = &cache->entries[i];
+
+    if (e->prev == SPX_SIGCACHE_NONE) {
+        cache->head = e->next;
+    }
+    else {
+        cache->entries[e->prev].next = e->next;
+    }
+    if (e->next == SPX_SIGCACHE_NONE) {
+        cache->tail = e->prev;
+    }
+    else {
+        cache->entries[e->next].prev = e->prev;
+    }
+}
+
+static void sigcache_push_front(spx_sigcache *cache, uint32_t i)
+{
+    spx_sigcache_entry *e = &cache->entries[i];
+
+    e->prev = SPX_SIGCACHE_NONE;
+    e->next = cache->head;
+    if (cache->head == SPX_SIGCACHE_NONE) {
+        cache->tail = i;
+    }
+    else {
+        cache->entries[cache->head].prev = i;
+    }
+    cache->head = i;
+}
+
+spx_sigcache_entry *spx_sigcache_lookup(spx_sigcache *cache,
+                                        uint32_t layer, uint64_t tree)
+{
+    spx_sigcache_entry *e;
+    uint32_t i;
+
+    if (cache->nentries == 0) {
+        return NULL;
+    }
+    i = cache->buckets[sigcache_bucket(cache, layer, tree)];
+    while (i != SPX_SIGCACHE_NONE) {
+        e = &cache->entries[i];
+        if (e->layer == layer && e->tree == tree) {
+            if (cache->head != i) {
+                sigcache_unlink(cache, i);
+                sigcache_push_front(cache, i);
+            }
+            return e;
+        }
+        i = e->chain;
+    }
+    return NULL;
+}
+
+spx_sigcache_entry *spx_sigcache_insert(spx_sigcache *cache,
+                                        uint32_t layer, uint64_t tree)
+{
+    spx_sigcache_entry *e;
+    uint32_t *link;
+    uint32_t i;
+
+    if (cache->nentries == 0) {
+        return NULL;
+    }
+    if (cache->nused < cache->nentries) {
+        i = cache->nused++;
+    }
+    else {
+        /* Evict the least recently used entry from its bucket and the list. */
+        i = cache->tail;
+        e = &cache->entries[i];
+        link = &cache->buckets[sigcache_bucket(cache, e->layer, e->tree)];
+        while (*link != i) {
+            link = &cache->entries[*link].chain;
+        }
+        *link = e->chain;
+        sigcache_unlink(cache, i);
+    }
+
+    e = &cache->entries[i];
+    e->layer = layer;
+    e->tree = tree;
+    e->wots_leaf = SPX_SIGCACHE_NONE;
+
+    link = &cache->buckets[sigcache_bucket(cache, layer, tree)];
+    e->chain = *link;
+    *link = i;
+    sigcache_push_front(cache, i);
+
+    return e;
+}
@@ -0,0 +1,90 @@
+#ifndef SPX_SIGCACHE_H
+#define SPX_SIGCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+
+/*
+ * A cache of the upper hypertree layers of signatures under one key. In
+ * layers 1 and up, every node of the subtree at (layer, tree), and the WOTS
+ * signature by each of its leaves, only depend on the position; the top layer
+ * is shared by all signatures. As the leaf used in a subtree changes from one
+ * signature to the next, the cache keeps all nodes of a subtree, from which
+ * the authentication path of any leaf is read off. It also keeps the WOTS
+ * signature by the last leaf used. All of this is public, as it appears in
+ * signatures.
+ *
+ * The cache keeps the most recently used subtrees within a memory budget, and
+ * drops the least recently used one when it needs room. It is not safe to
+ * use one cache from several threads at once.
+ */
+
+#define SPX_SIGCACHE_NONE 0xffffffffu
+
+/* The number of nodes in a subtree, leaves included. */
+#define SPX_SIGCACHE_NODES ((1 << (SPX_TREE_HEIGHT + 1)) - 1)
+
+typedef struct {
+    uint64_t tree;
+    uint32_t layer;
+    uint32_t wots_leaf;             /* leaf that made wots_sig, or NONE */
+    uint32_t prev;                  /* towards the most recently used */
+    uint32_t next;                  /* towards the least recently used */
+    uint32_t chain;                 /* next entry in the same bucket */
+    /* Level by level, starting with the leaves, so the root comes last. */
+    unsigned char nodes[SPX_SIGCACHE_NODES * SPX_N];
+    unsigned char wots_sig[SPX_WOTS_BYTES];
+} spx_sigcache_entry;
+
+typedef struct {
+    spx_sigcache_entry *entries;
+    uint32_t *buckets;
+    uint32_t nentries;
+    uint32_t nused;
+    uint32_t head;                  /* most recently used */
+    uint32_t tail;                  /* least recently used */
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned long hits;             /* subtrees found in the cache */
+} spx_sigcache;
+
+/* The memory used per cached subtree. */
+#define SPX_SIGCACHE_ENTRY_BYTES (sizeof(spx_sigcache_entry) + sizeof(uint32_t))
+
+/**
+ * Sets up cache to hold subtrees of signatures under public key pk in the
+ * given bytes at mem, which must be aligned as for malloc and stay available
+ * for as long as cache is used. The cache holds
+ * bytes / SPX_SIGCACHE_ENTRY_BYTES subtrees.
+ */
+void spx_sigcache_init(spx_sigcache *cache, void *mem, size_t bytes,
+                       const uint8_t *pk);
+
+/**
+ * Returns the cached subtree at (layer, tree) and marks it as most recently
+ * used, or returns NULL if it is not cached.
+ */
+spx_sigcache_entry *spx_sigcache_lookup(spx_sigcache *cache,
+                                        uint32_t layer, uint64_t tree);
+
+/**
+ * Returns an entry for the subtree at (layer, tree), for the caller to fill
+ * in the nodes, or NULL if the cache has no room at all. The entry replaces
+ * the least recently used one if the cache is full.
+ */
+spx_sigcache_entry *spx_sigcache_insert(spx_sigcache *cache,
+                                        uint32_t layer, uint64_t tree);
+
+/**
+ * Like crypto_sign_signature_ctx, but takes the subtrees found in cache from
+ * there, and adds the subtrees it computes to it. If cache was set up for a
+ * different key, it is not used.
+ */
+int crypto_sign_signature_cached(uint8_t *sig, size_t *siglen,
+                                 const uint8_t *m, size_t mlen,
+                                 const uint8_t *sk, const spx_ctx *ctx,
+                                 spx_sigcache *cache);
+
+#endif
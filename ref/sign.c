@@ -1,4 +1,6 @@
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
@@ -11,31 +13,14 @@
 #include "address.h"
 #include "randombytes.h"
 #include "utils.h"
+#include "nodecache.h"
+#include "sigcache.h"
+#include "esk.h"
+#include "pool.h"
+#include "stream.h"
+#include "sigread.h"
 
-/**
- * Computes the leaf at a given address. First generates the WOTS key pair,
- * then computes leaf by hashing horizontally.
- */
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim 
-static void wots_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
-                          const unsigned char *pub_seed,
-                          uint32_t addr_idx, const uint32_t tree_addr[8])
-{
-    unsigned char pk[SPX_WOTS_BYTES];
-    uint32_t wots_addr[8] = {0};
-    uint32_t wots_pk_addr[8] = {0};
-
-    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
-    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
-
-    copy_subtree_addr(wots_addr, tree_addr);
-    set_keypair_addr(wots_addr, addr_idx);
-    wots_gen_pk(pk, sk_seed, pub_seed, wots_addr);
-
-    copy_keypair_addr(wots_pk_addr, wots_addr);
-    thash(leaf, pk, SPX_WOTS_LEN, pub_seed, wots_pk_addr);
-}
-
 /*
  * Returns the length of a secret key, in bytes
  */
@@ -69,12 +54,25 @@ unsigned long long crypto_sign_seedbytes(void)
 }
 
 /*
- * Generates an SPX key pair given a seed of length
+ * Prepares ctx for signing with sk.
+ */
+int crypto_sign_ctx_init(spx_ctx *ctx, const uint8_t *sk)
+{
+    /* This hook allows the hash function instantiation to do whatever
+       preparation or computation it needs, based on the public seed. */
+    initialize_hash_function(ctx, sk + 2*SPX_N, sk + SPX_N);
+
+    return 0;
+}
+
+/*
+ * Generates an SPX key pair given a seed of length, and leaves ctx prepared
+ * for signing with the new secret key.
  * Format sk: [SK_SEED || SK_PRF || PUB_SEED || root]
  * Format pk: [PUB_SEED || root]
  */
-int crypto_sign_seed_keypair(unsigned char *pk, unsigned char *sk,
-                             const unsigned char *seed)
+int crypto_sign_seed_keypair_ctx(unsigned char *pk, unsigned char *sk,
+                                 const unsigned char *seed, spx_ctx *ctx)
 {
     /* We do not need the auth path in key generation, but it simplifies the
        code to have just one treehash routine that computes both root and path
@@ -90,19 +88,29 @@ int crypto_sign_seed_keypair(unsigned char *pk, unsigned char *sk,
 
     memcpy(pk, sk + 2*SPX_N, SPX_N);
 
-    /* This hook allows the hash function instantiation to do whatever
-       preparation or computation it needs, based on the public seed. */
-    initialize_hash_function(pk, sk);
+    crypto_sign_ctx_init(ctx, sk);
 
     /* Compute root node of the top-most subtree. */
-    treehash(sk + 3*SPX_N, auth_path, sk, sk + 2*SPX_N, 0, 0, SPX_TREE_HEIGHT,
-             wots_gen_leaf, top_tree_addr);
+    wots_treehash(sk + 3*SPX_N, auth_path, sk, ctx, 0, top_tree_addr);
 
     memcpy(pk + SPX_N, sk + 3*SPX_N, SPX_N);
 
     return 0;
 }
 
+/*
+ * Generates an SPX key pair given a seed of length
+ * Format sk: [SK_SEED || SK_PRF || PUB_SEED || root]
+ * Format pk: [PUB_SEED || root]
+ */
+int crypto_sign_seed_keypair(unsigned char *pk, unsigned char *sk,
+                             const unsigned char *seed)
+{
+    spx_ctx ctx;
+
+    return crypto_sign_seed_keypair_ctx(pk, sk, seed, &ctx);
+}
+
 /*
  * Generates an SPX key pair.
  * Format sk: [SK_SEED || SK_PRF || PUB_SEED || root]
@@ -118,48 +126,35 @@ int crypto_sign_keypair(unsigned char *pk, unsigned char *sk)
 }
 
 /**
- * Returns an array containing a detached signature.
+ * Writes the FORS signature of mhash and the hypertree signature above it to
+ * sig, for the indices that hash_message derived with mhash. Reads the layers
+ * stored in esk, if esk is not NULL. Below those, if cache is not NULL, takes
+ * the subtrees found in it rather than computing them, and adds the subtrees
+ * that were computed to it.
  */
-int crypto_sign_signature(uint8_t *sig, size_t *siglen,
-                          const uint8_t *m, size_t mlen, const uint8_t *sk)
+static void sign_digest(uint8_t *sig, const unsigned char *mhash,
+                        uint64_t tree, uint32_t idx_leaf,
+                        const uint8_t *sk, const spx_ctx *ctx,
+                        const spx_esk *esk, spx_sigcache *cache)
 {
     const unsigned char *sk_seed = sk;
-    const unsigned char *sk_prf = sk + SPX_N;
-    const unsigned char *pk = sk + 2*SPX_N;
-    const unsigned char *pub_seed = pk;
 
-    unsigned char optrand[SPX_N];
-    unsigned char mhash[SPX_FORS_MSG_BYTES];
     unsigned char root[SPX_N];
     unsigned long long i;
-    uint64_t tree;
-    uint32_t idx_leaf;
     uint32_t wots_addr[8] = {0};
     uint32_t tree_addr[8] = {0};
-
-    /* This hook allows the hash function instantiation to do whatever
-       preparation or computation it needs, based on the public seed. */
-    initialize_hash_function(pub_seed, sk_seed);
+    spx_sigcache_entry *entry;
+    const unsigned char *nodes;
+    const unsigned char *wots_sig;
 
     set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
     set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
 
-    /* Optionally, signing can be made non-deterministic using optrand.
-       This can help counter side-channel attacks that would benefit from
-       getting a large number of traces when the signer uses the same nodes. */
-    randombytes(optrand, SPX_N);
-    /* Compute the digest randomization value. */
-    gen_message_random(sig, sk_prf, optrand, m, mlen);
-
-    /* Derive the message digest and leaf index from R, PK and M. */
-    hash_message(mhash, &tree, &idx_leaf, sig, pk, m, mlen);
-    sig += SPX_N;
-
     set_tree_addr(wots_addr, tree);
     set_keypair_addr(wots_addr, idx_leaf);
 
     /* Sign the message hash using FORS. */
-    fors_sign(sig, root, mhash, sk_seed, pub_seed, wots_addr);
+    fors_sign(sig, root, mhash, sk_seed, ctx, wots_addr);
     sig += SPX_FORS_BYTES;
 
     for (i = 0; i < SPX_D; i++) {
@@ -169,90 +164,464 @@ int crypto_sign_signature(uint8_t *sig, size_t *siglen,
         copy_subtree_addr(wots_addr, tree_addr);
         set_keypair_addr(wots_addr, idx_leaf);
 
-        /* Compute a WOTS signature. */
-        wots_sign(sig, root, sk_seed, pub_seed, wots_addr);
-        sig += SPX_WOTS_BYTES;
-
-        /* Compute the authentication path for the used WOTS leaf. */
-        treehash(root, sig, sk_seed, pub_seed, idx_leaf, 0,
-                 SPX_TREE_HEIGHT, wots_gen_leaf, tree_addr);
-        sig += SPX_TREE_HEIGHT * SPX_N;
+        /* Above layer 0, the subtree only depends on its position. */
+        nodes = NULL;
+        wots_sig = NULL;
+        entry = NULL;
+        if (esk && i >= esk->first_layer) {
+            nodes = spx_esk_nodes(esk, i, tree);
+            wots_sig = spx_esk_wots_sig(esk, i, tree, idx_leaf);
+        }
+        else if (cache && i > 0) {
+            entry = spx_sigcache_lookup(cache, i, tree);
+            if (entry) {
+                cache->hits++;
+            }
+            else if ((entry = spx_sigcache_insert(cache, i, tree))) {
+                treehash_nodes(entry->nodes, sk_seed, ctx, SPX_TREE_HEIGHT,
+                               wots_gen_leaf, tree_addr);
+            }
+            if (entry) {
+                nodes = entry->nodes;
+                if (entry->wots_leaf == idx_leaf) {
+                    wots_sig = entry->wots_sig;
+                }
+            }
+        }
+
+        if (nodes) {
+            /* The root signed here is the same as when it was stored. */
+            if (wots_sig) {
+                memcpy(sig, wots_sig, SPX_WOTS_BYTES);
+            }
+            else {
+                wots_sign(sig, root, sk_seed, ctx, wots_addr);
+                if (entry) {
+                    memcpy(entry->wots_sig, sig, SPX_WOTS_BYTES);
+                    entry->wots_leaf = idx_leaf;
+                }
+            }
+            sig += SPX_WOTS_BYTES;
+
+            auth_path_from_nodes(sig, nodes, idx_leaf, SPX_TREE_HEIGHT);
+            memcpy(root, nodes + (SPX_SIGCACHE_NODES - 1)*SPX_N, SPX_N);
+            sig += SPX_TREE_HEIGHT * SPX_N;
+        }
+        else {
+            /* Compute a WOTS signature. */
+            wots_sign(sig, root, sk_seed, ctx, wots_addr);
+            sig += SPX_WOTS_BYTES;
+
+            /* Compute the authentication path for the used WOTS leaf. */
+            wots_treehash(root, sig, sk_seed, ctx, idx_leaf, tree_addr);
+            sig += SPX_TREE_HEIGHT * SPX_N;
+        }
 
         /* Update the indices for the next layer. */
         idx_leaf = (tree & ((1 << SPX_TREE_HEIGHT)-1));
         tree = tree >> SPX_TREE_HEIGHT;
     }
+}
 
-    *siglen = SPX_BYTES;
+/**
+ * Returns an array containing a detached signature, signed as sign_digest
+ * does with esk and cache.
+ */
+static int sign_layers(uint8_t *sig, const uint8_t *m, size_t mlen,
+                       const uint8_t *sk, const spx_ctx *ctx,
+                       const spx_esk *esk, spx_sigcache *cache)
+{
+    const unsigned char *pk = sk + 2*SPX_N;
+
+    unsigned char optrand[SPX_N];
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    uint64_t tree;
+    uint32_t idx_leaf;
+
+    /* Optionally, signing can be made non-deterministic using optrand.
+       This can help counter side-channel attacks that would benefit from
+       getting a large number of traces when the signer uses the same nodes. */
+    randombytes(optrand, SPX_N);
+    /* Compute the digest randomization value. */
+    gen_message_random(sig, ctx, optrand, m, mlen);
+
+    /* Derive the message digest and leaf index from R, PK and M. */
+    hash_message(mhash, &tree, &idx_leaf, sig, pk, m, mlen);
+
+    sign_digest(sig + SPX_N, mhash, tree, idx_leaf, sk, ctx, esk, cache);
 
     return 0;
 }
-#endif
 
 /**
- * Verifies a detached signature and message under a given public key.
+ * Returns an array containing a detached signature, using the context that
+ * crypto_sign_ctx_init prepared for sk.
  */
-int crypto_sign_verify(const uint8_t *sig, size_t siglen,
-                       const uint8_t *m, size_t mlen, const uint8_t *pk)
+int crypto_sign_signature_ctx(uint8_t *sig, size_t *siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *sk,
+                              const spx_ctx *ctx)
 {
-    const unsigned char *pub_seed = pk;
-    const unsigned char *pub_root = pk + SPX_N;
-    unsigned char mhash[SPX_FORS_MSG_BYTES];
-    unsigned char wots_pk[SPX_WOTS_BYTES];
-    unsigned char root[SPX_N];
-    unsigned char leaf[SPX_N];
-    unsigned int i;
+    *siglen = SPX_BYTES;
+
+    return sign_layers(sig, m, mlen, sk, ctx, NULL, NULL);
+}
+
+int crypto_sign_signature_cached(uint8_t *sig, size_t *siglen,
+                                 const uint8_t *m, size_t mlen,
+                                 const uint8_t *sk, const spx_ctx *ctx,
+                                 spx_sigcache *cache)
+{
+    if (memcmp(cache->pk, sk + 2*SPX_N, SPX_PK_BYTES)) {
+        cache = NULL;
+    }
+    *siglen = SPX_BYTES;
+
+    return sign_layers(sig, m, mlen, sk, ctx, NULL, cache);
+}
+
+int crypto_sign_signature_esk(uint8_t *sig, size_t *siglen,
+                              const uint8_t *m, size_t mlen,
+                              const uint8_t *sk, const spx_ctx *ctx,
+                              const spx_esk *esk, spx_sigcache *cache)
+{
+    if (esk && memcmp(esk->map + SPX_ESK_PK_OFFSET, sk + 2*SPX_N,
+                      SPX_PK_BYTES)) {
+        esk = NULL;
+    }
+    if (cache && memcmp(cache->pk, sk + 2*SPX_N, SPX_PK_BYTES)) {
+        cache = NULL;
+    }
+    *siglen = SPX_BYTES;
+
+    return sign_layers(sig, m, mlen, sk, ctx, esk, cache);
+}
+
+int crypto_sign_esk_write(const char *path, const uint8_t *sk,
+                          const spx_ctx *ctx, unsigned int layers)
+{
+    const unsigned char *sk_seed = sk;
+    unsigned char header[SPX_ESK_HEADER_BYTES];
+    unsigned char nodes[SPX_SIGCACHE_NODES * SPX_N];
+    unsigned char wots_sig[SPX_WOTS_BYTES];
+    unsigned char *roots = NULL;
+    unsigned char *roots_below = NULL;
+    uint32_t wots_addr[8] = {0};
+    uint32_t tree_addr[8] = {0};
+    unsigned int first_layer;
+    unsigned int layer;
     uint64_t tree;
+    uint64_t ntrees;
     uint32_t idx_leaf;
+    FILE *f;
+    int ret = -1;
+
+    if (layers == 0 || layers > SPX_D) {
+        return -1;
+    }
+    f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+    first_layer = SPX_D - layers;
+    spx_esk_header(header, sk + 2*SPX_N, layers);
+    if (fwrite(header, SPX_ESK_HEADER_BYTES, 1, f) != 1) {
+        goto done;
+    }
+
+    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+    set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
+
+    /* Bottom-up, as the WOTS signatures sign the roots of the layer below. */
+    for (layer = first_layer; layer < SPX_D; layer++) {
+        ntrees = 1ULL << (SPX_TREE_HEIGHT * (SPX_D - 1 - layer));
+        roots = malloc(ntrees * SPX_N);
+        if (!roots ||
+            fseek(f, (long)spx_esk_offset(first_layer, layer, 0), SEEK_SET)) {
+            goto done;
+        }
+        for (tree = 0; tree < ntrees; tree++) {
+            set_layer_addr(tree_addr, layer);
+            set_tree_addr(tree_addr, tree);
+            treehash_nodes(nodes, sk_seed, ctx, SPX_TREE_HEIGHT,
+                           wots_gen_leaf, tree_addr);
+            memcpy(roots + tree*SPX_N,
+                   nodes + (SPX_SIGCACHE_NODES - 1)*SPX_N, SPX_N);
+            if (fwrite(nodes, sizeof nodes, 1, f) != 1) {
+                goto done;
+            }
+            if (layer == first_layer) {
+                continue;
+            }
+            copy_subtree_addr(wots_addr, tree_addr);
+            for (idx_leaf = 0; idx_leaf < (1 << SPX_TREE_HEIGHT); idx_leaf++) {
+                set_keypair_addr(wots_addr, idx_leaf);
+                wots_sign(wots_sig, roots_below +
+                          ((tree << SPX_TREE_HEIGHT) + idx_leaf)*SPX_N,
+                          sk_seed, ctx, wots_addr);
+                if (fwrite(wots_sig, SPX_WOTS_BYTES, 1, f) != 1) {
+                    goto done;
+                }
+            }
+        }
+        free(roots_below);
+        roots_below = roots;
+        roots = NULL;
+    }
+    ret = 0;
+
+done:
+    free(roots);
+    free(roots_below);
+    if (fclose(f)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int crypto_sign_seed_keypair_esk(unsigned char *pk, unsigned char *sk,
+                                 const unsigned char *seed,
+                                 const char *path, size_t budget)
+{
+    spx_ctx ctx;
+    unsigned int layers = spx_esk_layers(budget);
+
+    crypto_sign_seed_keypair_ctx(pk, sk, seed, &ctx);
+    if (layers == 0) {
+        return -1;
+    }
+    return crypto_sign_esk_write(path, sk, &ctx, layers);
+}
+
+/* The independent parts of one signature, for the tasks on a pool. */
+struct sign_job {
+    unsigned char *sig;                 /* at the FORS signature */
+    const unsigned char *sk_seed;
+    const spx_ctx *ctx;
+    const unsigned char *mhash;
+    uint64_t trees[SPX_D];
+    uint32_t idx_leaves[SPX_D];
+    /* roots[0] is the FORS public key, roots[i + 1] the root of layer i. */
+    unsigned char roots[SPX_D + 1][SPX_N];
+};
+
+static unsigned char *sign_job_layer(struct sign_job *job, unsigned int i)
+{
+    return job->sig + SPX_FORS_BYTES +
+           i * (SPX_WOTS_BYTES + SPX_TREE_HEIGHT * SPX_N);
+}
+
+/* Task 0 is the FORS signature, task i + 1 the treehash of layer i. */
+static void sign_tree_task(void *arg, unsigned int task)
+{
+    struct sign_job *job = arg;
     uint32_t wots_addr[8] = {0};
     uint32_t tree_addr[8] = {0};
-    uint32_t wots_pk_addr[8] = {0};
+    unsigned int i = task - 1;
+
+    if (task == 0) {
+        set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+        set_tree_addr(wots_addr, job->trees[0]);
+        set_keypair_addr(wots_addr, job->idx_leaves[0]);
+        fors_sign(job->sig, job->roots[0], job->mhash, job->sk_seed,
+                  job->ctx, wots_addr);
+        return;
+    }
+    set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
+    set_layer_addr(tree_addr, i);
+    set_tree_addr(tree_addr, job->trees[i]);
+    wots_treehash(job->roots[i + 1], sign_job_layer(job, i) + SPX_WOTS_BYTES,
+                  job->sk_seed, job->ctx, job->idx_leaves[i], tree_addr);
+}
 
-    if (siglen != SPX_BYTES) {
+/* Task i is the WOTS signature of layer i, on the root of the layer below. */
+static void sign_wots_task(void *arg, unsigned int i)
+{
+    struct sign_job *job = arg;
+    uint32_t wots_addr[8] = {0};
+
+    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+    set_layer_addr(wots_addr, i);
+    set_tree_addr(wots_addr, job->trees[i]);
+    set_keypair_addr(wots_addr, job->idx_leaves[i]);
+    wots_sign(sign_job_layer(job, i), job->roots[i], job->sk_seed,
+              job->ctx, wots_addr);
+}
+
+int crypto_sign_signature_pool(uint8_t *sig, size_t *siglen,
+                               const uint8_t *m, size_t mlen,
+                               const uint8_t *sk, const spx_ctx *ctx,
+                               spx_pool *pool)
+{
+    const unsigned char *pk = sk + 2*SPX_N;
+    unsigned char optrand[SPX_N];
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    struct sign_job job;
+    uint64_t tree;
+    uint32_t idx_leaf;
+    unsigned int i;
+
+    randombytes(optrand, SPX_N);
+    gen_message_random(sig, ctx, optrand, m, mlen);
+    hash_message(mhash, &tree, &idx_leaf, sig, pk, m, mlen);
+
+    /* All indices are known up front. */
+    for (i = 0; i < SPX_D; i++) {
+        job.trees[i] = tree;
+        job.idx_leaves[i] = idx_leaf;
+        idx_leaf = (tree & ((1 << SPX_TREE_HEIGHT)-1));
+        tree = tree >> SPX_TREE_HEIGHT;
+    }
+    job.sig = sig + SPX_N;
+    job.sk_seed = sk;
+    job.ctx = ctx;
+    job.mhash = mhash;
+
+    spx_pool_run(pool, sign_tree_task, &job, SPX_D + 1);
+    spx_pool_run(pool, sign_wots_task, &job, SPX_D);
+
+    *siglen = SPX_BYTES;
+
+    return 0;
+}
+
+int spx_sign_init(spx_sign_state *st, const uint8_t *sk, const spx_ctx *ctx)
+{
+    unsigned char optrand[SPX_N];
+
+    st->sk = sk;
+    st->ctx = ctx;
+    st->pass = 1;
+
+    /* As in sign_layers, R is randomized by optrand. */
+    randombytes(optrand, SPX_N);
+    gen_message_random_init(&st->hash, ctx, optrand);
+
+    return 0;
+}
+
+void spx_sign_update(spx_sign_state *st, const uint8_t *m, size_t mlen)
+{
+    hash_stream_update(&st->hash, m, mlen);
+}
+
+int spx_sign_rewind(spx_sign_state *st)
+{
+    if (st->pass != 1) {
+        return -1;
+    }
+    gen_message_random_final(st->R, &st->hash, st->ctx);
+    hash_message_init(&st->hash, st->R, st->sk + 2*SPX_N);
+    st->pass = 2;
+
+    return 0;
+}
+
+int spx_sign_final(uint8_t *sig, size_t *siglen, spx_sign_state *st)
+{
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    uint64_t tree;
+    uint32_t idx_leaf;
+
+    if (st->pass != 2) {
         return -1;
     }
+    hash_message_final(mhash, &tree, &idx_leaf, &st->hash);
+
+    memcpy(sig, st->R, SPX_N);
+    sign_digest(sig + SPX_N, mhash, tree, idx_leaf, st->sk, st->ctx,
+                NULL, NULL);
+    *siglen = SPX_BYTES;
 
+    return 0;
+}
+
+/**
+ * Returns an array containing a detached signature.
+ */
+int crypto_sign_signature(uint8_t *sig, size_t *siglen,
+                          const uint8_t *m, size_t mlen, const uint8_t *sk)
+{
+    spx_ctx ctx;
+
+    crypto_sign_ctx_init(&ctx, sk);
+
+    return crypto_sign_signature_ctx(sig, siglen, m, mlen, sk, &ctx);
+}
+#endif
+
+/*
+ * Prepares ctx for verifying signatures under pk.
+ */
+int crypto_sign_ctx_init_pk(spx_ctx *ctx, const uint8_t *pk)
+{
     /* This hook allows the hash function instantiation to do whatever
        preparation or computation it needs, based on the public seed. */
-    initialize_hash_function(pub_seed, NULL);
+    initialize_hash_function(ctx, pk, NULL);
+
+    return 0;
+}
+
+/**
+ * Verifies the FORS signature of mhash and the hypertree signature above it
+ * in sig, for the indices that hash_message derived with mhash. If cache is
+ * not NULL, stops at the first hypertree node found in it, and adds the nodes
+ * that were authenticated to it.
+ */
+static int verify_digest(const uint8_t *sig, const unsigned char *mhash,
+                         uint64_t tree, uint32_t idx_leaf, const uint8_t *pk,
+                         const spx_ctx *ctx, spx_nodecache *cache)
+{
+    const unsigned char *pub_root = pk + SPX_N;
+    unsigned char root[SPX_N];
+    unsigned char leaf[SPX_N];
+    unsigned int i;
+    uint32_t wots_addr[8] = {0};
+    uint32_t tree_addr[8] = {0};
+    /* The nodes visited on the way up, for adding to the cache. */
+    uint64_t trees[SPX_D];
+    uint32_t idx_leaves[SPX_D];
+    unsigned char roots[SPX_D + 1][SPX_N];
+    unsigned int top = SPX_D;
 
     set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
     set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
-    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
-
-    /* Derive the message digest and leaf index from R || PK || M. */
-    /* The additional SPX_N is a result of the hash domain separator. */
-    hash_message(mhash, &tree, &idx_leaf, sig, pk, m, mlen);
-    sig += SPX_N;
 
     /* Layer correctly defaults to 0, so no need to set_layer_addr */
     set_tree_addr(wots_addr, tree);
     set_keypair_addr(wots_addr, idx_leaf);
-    fors_pk_from_sig(root, sig, mhash, pub_seed, wots_addr);
+    fors_pk_from_sig(root, sig, mhash, ctx, wots_addr);
     sig += SPX_FORS_BYTES;
 
     /* For each subtree.. */
     for (i = 0; i < SPX_D; i++) {
+        if (cache) {
+            /* Everything above a known node was verified before. */
+            if (i > 0 && spx_nodecache_lookup(cache, i, tree, idx_leaf, root)) {
+                cache->hits++;
+                top = i;
+                break;
+            }
+            trees[i] = tree;
+            idx_leaves[i] = idx_leaf;
+            memcpy(roots[i], root, SPX_N);
+        }
+
         set_layer_addr(tree_addr, i);
         set_tree_addr(tree_addr, tree);
 
         copy_subtree_addr(wots_addr, tree_addr);
         set_keypair_addr(wots_addr, idx_leaf);
 
-        copy_keypair_addr(wots_pk_addr, wots_addr);
-
         /* The WOTS public key is only correct if the signature was correct. */
         /* Initially, root is the FORS pk, but on subsequent iterations it is
            the root of the subtree below the currently processed subtree. */
-        wots_pk_from_sig(wots_pk, sig, root, pub_seed, wots_addr);
+        /* Compute the leaf node from the WOTS public key as it is derived. */
+        wots_leaf_from_sig(leaf, sig, root, ctx, wots_addr);
         sig += SPX_WOTS_BYTES;
 
-        /* Compute the leaf node using the WOTS public key. */
-        thash(leaf, wots_pk, SPX_WOTS_LEN, pub_seed, wots_pk_addr);
-
         /* Compute the root node of this subtree. */
         compute_root(root, leaf, idx_leaf, 0, sig, SPX_TREE_HEIGHT,
-                     pub_seed, tree_addr);
+                     ctx, tree_addr);
         sig += SPX_TREE_HEIGHT * SPX_N;
 
         /* Update the indices for the next layer. */
@@ -261,13 +630,177 @@ int crypto_sign_verify(const uint8_t *sig, size_t siglen,
     }
 
     /* Check if the root node equals the root node in the public key. */
-    if (memcmp(root, pub_root, SPX_N)) {
+    if (top == SPX_D && memcmp(root, pub_root, SPX_N)) {
         return -1;
     }
 
+    if (cache) {
+        memcpy(roots[top], root, SPX_N);
+        for (i = 1; i < top; i++) {
+            spx_nodecache_insert(cache, i, trees[i], idx_leaves[i],
+                                 roots[i], roots[i + 1]);
+        }
+    }
+
     return 0;
 }
 
+/**
+ * Verifies a detached signature and message under a given public key, as
+ * verify_digest does with cache.
+ */
+static int verify_nodecache(const uint8_t *sig, size_t siglen,
+                            const uint8_t *m, size_t mlen, const uint8_t *pk,
+                            const spx_ctx *ctx, spx_nodecache *cache)
+{
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    uint64_t tree;
+    uint32_t idx_leaf;
+
+    if (siglen != SPX_BYTES) {
+        return -1;
+    }
+
+    /* Derive the message digest and leaf index from R || PK || M. */
+    /* The additional SPX_N is a result of the hash domain separator. */
+    hash_message(mhash, &tree, &idx_leaf, sig, pk, m, mlen);
+
+    return verify_digest(sig + SPX_N, mhash, tree, idx_leaf, pk, ctx, cache);
+}
+
+/**
+ * Verifies a detached signature and message under a given public key, using
+ * the context that crypto_sign_ctx_init_pk prepared for pk.
+ */
+int crypto_sign_verify_ctx(const uint8_t *sig, size_t siglen,
+                           const uint8_t *m, size_t mlen, const uint8_t *pk,
+                           const spx_ctx *ctx)
+{
+    return verify_nodecache(sig, siglen, m, mlen, pk, ctx, NULL);
+}
+
+int crypto_sign_verify_cached(const uint8_t *sig, size_t siglen,
+                              const uint8_t *m, size_t mlen, const uint8_t *pk,
+                              const spx_ctx *ctx, spx_nodecache *cache)
+{
+    if (memcmp(cache->pk, pk, SPX_PK_BYTES)) {
+        cache = NULL;
+    }
+    return verify_nodecache(sig, siglen, m, mlen, pk, ctx, cache);
+}
+
+int spx_verify_init(spx_verify_state *st, const uint8_t *sig, size_t siglen,
+                    const uint8_t *pk, const spx_ctx *ctx)
+{
+    unsigned char R[SPX_N];
+
+    st->sig = sig;
+    st->siglen = siglen;
+    st->pk = pk;
+    st->ctx = ctx;
+
+    /* R is the start of the signature, so one pass over M is enough. */
+    if (siglen == SPX_BYTES) {
+        hash_message_init(&st->hash, sig, pk);
+        return 0;
+    }
+    /* Still set up the state, so that spx_verify_update can be called. */
+    memset(R, 0, SPX_N);
+    hash_message_init(&st->hash, R, pk);
+
+    return -1;
+}
+
+void spx_verify_update(spx_verify_state *st, const uint8_t *m, size_t mlen)
+{
+    hash_stream_update(&st->hash, m, mlen);
+}
+
+int spx_verify_final(spx_verify_state *st)
+{
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    uint64_t tree;
+    uint32_t idx_leaf;
+
+    if (st->siglen != SPX_BYTES) {
+        return -1;
+    }
+    hash_message_final(mhash, &tree, &idx_leaf, &st->hash);
+
+    return verify_digest(st->sig + SPX_N, mhash, tree, idx_leaf, st->pk,
+                         st->ctx, NULL);
+}
+
+int crypto_sign_verify_read(spx_read_fn read, void *arg,
+                            const uint8_t *m, size_t mlen, const uint8_t *pk,
+                            const spx_ctx *ctx)
+{
+    const unsigned char *pub_root = pk + SPX_N;
+    unsigned char R[SPX_N];
+    unsigned char mhash[SPX_FORS_MSG_BYTES];
+    unsigned char auth_path[SPX_TREE_HEIGHT * SPX_N];
+    unsigned char root[SPX_N];
+    unsigned char leaf[SPX_N];
+    unsigned int i;
+    uint64_t tree;
+    uint32_t idx_leaf;
+    uint32_t wots_addr[8] = {0};
+    uint32_t tree_addr[8] = {0};
+
+    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+    set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
+
+    if (read(arg, R, SPX_N)) {
+        return -1;
+    }
+    hash_message(mhash, &tree, &idx_leaf, R, pk, m, mlen);
+
+    set_tree_addr(wots_addr, tree);
+    set_keypair_addr(wots_addr, idx_leaf);
+    if (fors_pk_from_sig_read(root, read, arg, mhash, ctx, wots_addr)) {
+        return -1;
+    }
+
+    for (i = 0; i < SPX_D; i++) {
+        set_layer_addr(tree_addr, i);
+        set_tree_addr(tree_addr, tree);
+
+        copy_subtree_addr(wots_addr, tree_addr);
+        set_keypair_addr(wots_addr, idx_leaf);
+
+        if (wots_leaf_from_sig_read(leaf, read, arg, root, ctx, wots_addr)) {
+            return -1;
+        }
+
+        if (read(arg, auth_path, SPX_TREE_HEIGHT * SPX_N)) {
+            return -1;
+        }
+        compute_root(root, leaf, idx_leaf, 0, auth_path, SPX_TREE_HEIGHT,
+                     ctx, tree_addr);
+
+        idx_leaf = (tree & ((1 << SPX_TREE_HEIGHT)-1));
+        tree = tree >> SPX_TREE_HEIGHT;
+    }
+
+    if (memcmp(root, pub_root, SPX_N)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Verifies a detached signature and message under a given public key.
+ */
+int crypto_sign_verify(const uint8_t *sig, size_t siglen,
+                       const uint8_t *m, size_t mlen, const uint8_t *pk)
+{
+    spx_ctx ctx;
+
+    crypto_sign_ctx_init_pk(&ctx, pk);
+
+    return crypto_sign_verify_ctx(sig, siglen, m, mlen, pk, &ctx);
+}
+
 
 /**
  * Returns an array containing the signature followed by the message.
@@ -0,0 +1,35 @@
+#ifndef SPX_SIGREAD_H
+#define SPX_SIGREAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+
+/*
+ * Verification consumes a signature strictly front to back: R, the FORS
+ * signature, then a WOTS signature and an authentication path per layer. A
+ * verifier that takes the signature through a callback therefore never needs
+ * all of it in memory, e.g. to verify straight from flash on a small device.
+ */
+
+/**
+ * Reads the next len bytes of a signature into buf. Returns 0, or -1 if they
+ * cannot be read.
+ */
+typedef int (*spx_read_fn)(void *arg, unsigned char *buf, size_t len);
+
+/**
+ * Like crypto_sign_verify_ctx, but reads the SPX_BYTES bytes of the signature
+ * with read(arg, ...), one FORS tree, authentication path or group of eight
+ * WOTS chains at a time; sha256-avx2 reads eight FORS trees or a whole WOTS
+ * signature at a time. Besides the stack of the hash functions, it only keeps
+ * a buffer of that size.
+ * Returns -1 if the signature is invalid or cannot be read.
+ */
+int crypto_sign_verify_read(spx_read_fn read, void *arg,
+                            const uint8_t *m, size_t mlen, const uint8_t *pk,
+                            const spx_ctx *ctx);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SPX_STREAM_H
+#define SPX_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "context.h"
+#include "hash.h"
+
+/*
+ * Signing and verifying a message that arrives in pieces, such as a large
+ * file, without holding it in memory. Only one SHA-256 block of the message
+ * is ever buffered.
+ *
+ * The message enters a signature twice: R is an HMAC over it, and the digest
+ * is a hash over R and the message. A streaming signer therefore reads the
+ * message twice: spx_sign_update over all of it, spx_sign_rewind, and
+ * spx_sign_update over all of it again, in the same pieces or in others. A
+ * verifier already knows R from the signature and reads the message once.
+ *
+ * When the message cannot be read twice, sign a digest of it instead: hash it
+ * with SHA-256 in one pass and pass the 32-byte digest as the message to
+ * crypto_sign_signature, and verifiers do the same before
+ * crypto_sign_verify. This is a different signature than one on the message
+ * itself, and only as strong as the collision resistance of SHA-256, so both
+ * sides have to agree on it.
+ */
+
+#ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
+typedef struct {
+    spx_hash_stream hash;
+    const uint8_t *sk;
+    const spx_ctx *ctx;
+    unsigned char R[SPX_N];
+    int pass;                       /* 1 while absorbing for R, then 2 */
+} spx_sign_state;
+
+/**
+ * Starts a signature with sk, and a context from crypto_sign_ctx_init(sk).
+ * sk and ctx must stay in place until spx_sign_final. Returns 0.
+ */
+int spx_sign_init(spx_sign_state *st, const uint8_t *sk, const spx_ctx *ctx);
+
+/**
+ * Absorbs the next mlen bytes of the message.
+ */
+void spx_sign_update(spx_sign_state *st, const uint8_t *m, size_t mlen);
+
+/**
+ * Ends the first pass over the message; spx_sign_update then takes the
+ * message again from its start. Returns -1 if it was called before.
+ */
+int spx_sign_rewind(spx_sign_state *st);
+
+/**
+ * Ends the second pass over the message and writes the signature. Returns -1,
+ * writing nothing, if spx_sign_rewind was not called.
+ */
+int spx_sign_final(uint8_t *sig, size_t *siglen, spx_sign_state *st);
+#endif
+
+typedef struct {
+    spx_hash_stream hash;
+    const uint8_t *sig;
+    size_t siglen;
+    const uint8_t *pk;
+    const spx_ctx *ctx;
+} spx_verify_state;
+
+/**
+ * Starts verifying sig under pk, with a context from
+ * crypto_sign_ctx_init_pk(pk). sig, pk and ctx must stay in place until
+ * spx_verify_final. Returns 0, or -1 if siglen is not SPX_BYTES; the message
+ * can then still be absorbed, but spx_verify_final rejects it.
+ */
+int spx_verify_init(spx_verify_state *st, const uint8_t *sig, size_t siglen,
+                    const uint8_t *pk, const spx_ctx *ctx);
+
+/**
+ * Absorbs the next mlen bytes of the message.
+ */
+void spx_verify_update(spx_verify_state *st, const uint8_t *m, size_t mlen);
+
+/**
+ * Returns 0 if sig is a signature on the message that was absorbed, and -1
+ * otherwise.
+ */
+int spx_verify_final(spx_verify_state *st);
+
+#endif
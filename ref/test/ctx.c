@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../api.h"
+#include "../hash.h"
+#include "../sha256.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_THREADS 4
+#define SPX_VERIFICATIONS 4
+
+struct job {
+    const spx_ctx *ctx;
+    const unsigned char *pk;
+    const unsigned char *sig;
+    const unsigned char *other_sig;
+    const unsigned char *m;
+    int ret;
+};
+
+/* Verifies with a context that other threads use at the same time. */
+static void *verify_job(void *arg)
+{
+    struct job *job = arg;
+    int i;
+
+    job->ret = 0;
+    for (i = 0; i < SPX_VERIFICATIONS; i++) {
+        if (crypto_sign_verify_ctx(job->sig, SPX_BYTES, job->m, SPX_MLEN,
+                                   job->pk, job->ctx)) {
+            job->ret = -1;
+        }
+        if (!crypto_sign_verify_ctx(job->other_sig, SPX_BYTES, job->m,
+                                    SPX_MLEN, job->pk, job->ctx)) {
+            job->ret = -1;
+        }
+    }
+    return NULL;
+}
+
+/* HMAC-SHA256(sk_prf, optrand || m), computed without the precomputed pads */
+static void hmac_reference(unsigned char *R, const unsigned char *sk_prf,
+                           const unsigned char *optrand,
+                           const unsigned char *m, size_t mlen)
+{
+    unsigned char buf[SPX_SHA256_BLOCK_BYTES + SPX_N + 128];
+    unsigned char inner[SPX_SHA256_OUTPUT_BYTES];
+    unsigned char outer[SPX_SHA256_BLOCK_BYTES + SPX_SHA256_OUTPUT_BYTES];
+    int i;
+
+    memset(buf, 0x36, SPX_SHA256_BLOCK_BYTES);
+    memset(outer, 0x5c, SPX_SHA256_BLOCK_BYTES);
+    for (i = 0; i < SPX_N; i++) {
+        buf[i] ^= sk_prf[i];
+        outer[i] ^= sk_prf[i];
+    }
+    memcpy(buf + SPX_SHA256_BLOCK_BYTES, optrand, SPX_N);
+    memcpy(buf + SPX_SHA256_BLOCK_BYTES + SPX_N, m, mlen);
+    sha256(inner, buf, SPX_SHA256_BLOCK_BYTES + SPX_N + mlen);
+
+    memcpy(outer + SPX_SHA256_BLOCK_BYTES, inner, SPX_SHA256_OUTPUT_BYTES);
+    sha256(outer, outer, sizeof outer);
+    memcpy(R, outer, SPX_N);
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[2][SPX_PK_BYTES];
+    unsigned char sk[2][SPX_SK_BYTES];
+    unsigned char sig[2][SPX_BYTES];
+    unsigned char m[SPX_MLEN + 128];
+    unsigned char optrand[SPX_N];
+    unsigned char R1[SPX_N];
+    unsigned char R2[SPX_N];
+    static const size_t mlens[] = {0, 1, 31, 32, 33, 100, 128};
+    spx_ctx ctx[2];
+    pthread_t threads[SPX_THREADS];
+    struct job jobs[SPX_THREADS];
+    size_t siglen;
+    unsigned int i;
+    int ret = 0;
+
+    randombytes(m, sizeof m);
+    randombytes(optrand, SPX_N);
+
+    printf("Generating 2 keypairs into their contexts.. ");
+    for (i = 0; i < 2; i++) {
+        unsigned char seed[CRYPTO_SEEDBYTES];
+
+        randombytes(seed, CRYPTO_SEEDBYTES);
+        crypto_sign_seed_keypair_ctx(pk[i], sk[i], seed, &ctx[i]);
+    }
+    printf("successful.\n");
+
+    printf("Testing the precomputed HMAC pads.. ");
+    for (i = 0; i < sizeof mlens / sizeof mlens[0]; i++) {
+        gen_message_random(R1, &ctx[1], optrand, m, mlens[i]);
+        hmac_reference(R2, sk[1] + SPX_N, optrand, m, mlens[i]);
+        if (memcmp(R1, R2, SPX_N)) {
+            printf("failed for mlen %u!\n", (unsigned int)mlens[i]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    /* Sign alternately, so each signature is made after the other key's
+       context was set up. */
+    printf("Signing with interleaved contexts.. ");
+    for (i = 0; i < 2; i++) {
+        crypto_sign_signature_ctx(sig[i], &siglen, m, SPX_MLEN, sk[i], &ctx[i]);
+        if (crypto_sign_verify(sig[i], siglen, m, SPX_MLEN, pk[i])) {
+            printf("failed!\n");
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Verifying in %d threads sharing 2 contexts.. ", SPX_THREADS);
+    for (i = 0; i < SPX_THREADS; i++) {
+        jobs[i].ctx = &ctx[i & 1];
+        jobs[i].pk = pk[i & 1];
+        jobs[i].sig = sig[i & 1];
+        jobs[i].other_sig = sig[(i & 1) ^ 1];
+        jobs[i].m = m;
+        pthread_create(&threads[i], NULL, verify_job, &jobs[i]);
+    }
+    for (i = 0; i < SPX_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        ret |= jobs[i].ret;
+    }
+    if (ret) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
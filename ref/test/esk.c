@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../esk.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_SIGNATURES 2
+#define SPX_ESK_PATH "test/esk.bin"
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char seed[CRYPTO_SEEDBYTES];
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    unsigned char other_pk[SPX_PK_BYTES];
+    unsigned char m[SPX_MLEN];
+    unsigned char sig[SPX_BYTES];
+    spx_esk esk;
+    spx_ctx ctx;
+    size_t siglen;
+    int i;
+
+    printf("Testing the layers chosen by disk budget.. ");
+    if (spx_esk_layers(0) != 0 ||
+        spx_esk_layers(spx_esk_bytes(1)) != 1 ||
+        spx_esk_layers(spx_esk_bytes(2) - 1) != 1 ||
+        spx_esk_layers(spx_esk_bytes(2)) != 2) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Generating a keypair with the top layer expanded.. ");
+    randombytes(seed, CRYPTO_SEEDBYTES);
+    if (crypto_sign_seed_keypair_esk(pk, sk, seed, SPX_ESK_PATH,
+                                     spx_esk_bytes(1))) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that the file only opens for its key.. ");
+    memcpy(other_pk, pk, SPX_PK_BYTES);
+    other_pk[SPX_PK_BYTES - 1] ^= 1;
+    if (!spx_esk_open(&esk, SPX_ESK_PATH, other_pk) ||
+        spx_esk_open(&esk, SPX_ESK_PATH, pk) ||
+        esk.first_layer != SPX_D - 1) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing signing with the expanded secret key.. ");
+    crypto_sign_ctx_init(&ctx, sk);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        randombytes(m, SPX_MLEN);
+        crypto_sign_signature_esk(sig, &siglen, m, SPX_MLEN, sk, &ctx,
+                                  &esk, NULL);
+        if (crypto_sign_verify(sig, siglen, m, SPX_MLEN, pk)) {
+            printf("failed for signature %d!\n", i);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    spx_esk_close(&esk);
+    remove(SPX_ESK_PATH);
+
+    return 0;
+}
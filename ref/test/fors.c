@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "../fors.h"
+#include "../hash.h"
 #include "../randombytes.h"
 #include "../params.h"
 
@@ -12,6 +13,7 @@ int main()
 
     unsigned char sk_seed[SPX_N];
     unsigned char pub_seed[SPX_N];
+    spx_ctx ctx;
     unsigned char pk1[SPX_FORS_PK_BYTES];
     unsigned char pk2[SPX_FORS_PK_BYTES];
     unsigned char sig[SPX_FORS_BYTES];
@@ -23,10 +25,13 @@ int main()
     randombytes(m, SPX_FORS_MSG_BYTES);
     randombytes((unsigned char *)addr, 8 * sizeof(uint32_t));
 
+    /* thash reads the state seeded with pub_seed from ctx, so set it up first. */
+    initialize_hash_function(&ctx, pub_seed, NULL);
+
     printf("Testing FORS signature and PK derivation.. ");
 
-    fors_sign(sig, pk1, m, sk_seed, pub_seed, addr);
-    fors_pk_from_sig(pk2, sig, m, pub_seed, addr);
+    fors_sign(sig, pk1, m, sk_seed, &ctx, addr);
+    fors_pk_from_sig(pk2, sig, m, &ctx, addr);
 
     if (memcmp(pk1, pk2, SPX_FORS_PK_BYTES)) {
         printf("failed!\n");
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../api.h"
+#include "../keyreg.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_KEYS 5
+#define SPX_SLOTS 4
+#define SPX_THREADS 4
+
+static unsigned char pk[SPX_KEYS][SPX_PK_BYTES];
+static unsigned char sig[SPX_KEYS][SPX_BYTES];
+static unsigned char m[SPX_MLEN];
+static spx_keyreg reg;
+
+/* Registers and verifies under all keys, racing the other threads. */
+static void *verify_job(void *arg)
+{
+    int *ret = arg;
+    int i;
+
+    *ret = 0;
+    for (i = 0; i < SPX_KEYS; i++) {
+        if (crypto_sign_verify_keyreg(sig[i], SPX_BYTES, m, SPX_MLEN, pk[i],
+                                      &reg)) {
+            *ret = -1;
+        }
+        if (!crypto_sign_verify_keyreg(sig[(i + 1) % SPX_KEYS], SPX_BYTES,
+                                       m, SPX_MLEN, pk[i], &reg)) {
+            *ret = -1;
+        }
+    }
+    return NULL;
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char sk[SPX_SK_BYTES];
+    spx_keyreg_entry slots[SPX_SLOTS];
+    const spx_ctx *ctx;
+    pthread_t threads[SPX_THREADS];
+    int thread_ret[SPX_THREADS];
+    size_t siglen;
+    int registered = 0;
+    int ret = 0;
+    int i;
+
+    randombytes(m, SPX_MLEN);
+
+    printf("Signing under %d keys.. ", SPX_KEYS);
+    for (i = 0; i < SPX_KEYS; i++) {
+        crypto_sign_keypair(pk[i], sk);
+        crypto_sign_signature(sig[i], &siglen, m, SPX_MLEN, sk);
+    }
+    printf("done.\n");
+
+    printf("Testing verification through a registry of %d slots.. ",
+           SPX_SLOTS);
+    spx_keyreg_init(&reg, slots, SPX_SLOTS);
+    for (i = 0; i < SPX_KEYS; i++) {
+        if (crypto_sign_verify_keyreg(sig[i], SPX_BYTES, m, SPX_MLEN, pk[i],
+                                      &reg)) {
+            printf("failed for key %d!\n", i);
+            return -1;
+        }
+        ctx = spx_keyreg_find(&reg, pk[i]);
+        if (ctx) {
+            registered++;
+            if (ctx != spx_keyreg_get(&reg, pk[i]) ||
+                memcmp(ctx->pub_seed, pk[i], SPX_N)) {
+                printf("failed: wrong context for key %d!\n", i);
+                return -1;
+            }
+        }
+    }
+    /* The keys beyond the number of slots are verified without registry. */
+    if (registered != SPX_SLOTS) {
+        printf("failed: %d keys registered!\n", registered);
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing %d threads registering the same keys.. ", SPX_THREADS);
+    spx_keyreg_init(&reg, slots, SPX_SLOTS);
+    for (i = 0; i < SPX_THREADS; i++) {
+        pthread_create(&threads[i], NULL, verify_job, &thread_ret[i]);
+    }
+    for (i = 0; i < SPX_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        ret |= thread_ret[i];
+    }
+    if (ret) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../nodecache.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_SIGNATURES 4
+#define SPX_SLOTS 64
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[2][SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    unsigned char m[SPX_SIGNATURES][SPX_MLEN];
+    unsigned char sig[SPX_SIGNATURES][SPX_BYTES];
+    spx_nodecache_entry slots[SPX_SLOTS];
+    spx_nodecache cache;
+    spx_ctx ctx[2];
+    size_t siglen;
+    unsigned long hits;
+    int i;
+
+    randombytes(m[0], sizeof m);
+
+    printf("Signing %d messages.. ", SPX_SIGNATURES);
+    crypto_sign_keypair(pk[1], sk);
+    crypto_sign_keypair(pk[0], sk);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        crypto_sign_signature(sig[i], &siglen, m[i], SPX_MLEN, sk);
+    }
+    crypto_sign_ctx_init_pk(&ctx[0], pk[0]);
+    crypto_sign_ctx_init_pk(&ctx[1], pk[1]);
+    printf("done.\n");
+
+    printf("Testing verification with a node cache.. ");
+    spx_nodecache_init(&cache, slots, SPX_SLOTS, pk[0]);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        if (crypto_sign_verify_cached(sig[i], SPX_BYTES, m[i], SPX_MLEN,
+                                      pk[0], &ctx[0], &cache)) {
+            printf("failed for signature %d!\n", i);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing that a repeated signature stops at a cached node.. ");
+    hits = cache.hits;
+    if (crypto_sign_verify_cached(sig[0], SPX_BYTES, m[0], SPX_MLEN,
+                                  pk[0], &ctx[0], &cache) ||
+        cache.hits != hits + 1) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that a warm cache still rejects forgeries.. ");
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        m[i][0] ^= 1;
+        if (!crypto_sign_verify_cached(sig[i], SPX_BYTES, m[i], SPX_MLEN,
+                                       pk[0], &ctx[0], &cache)) {
+            printf("failed for signature %d!\n", i);
+            return -1;
+        }
+        m[i][0] ^= 1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that the cache is not used for another key.. ");
+    hits = cache.hits;
+    if (!crypto_sign_verify_cached(sig[0], SPX_BYTES, m[0], SPX_MLEN,
+                                   pk[1], &ctx[1], &cache) ||
+        cache.hits != hits) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
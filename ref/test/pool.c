@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../pool.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_THREADS 4
+#define SPX_TASKS 100
+
+static void count_task(void *arg, unsigned int i)
+{
+    unsigned char *counts = arg;
+
+    counts[i]++;
+}
+
+/* Signs with a pool of nthreads workers, and verifies the signature. */
+static int sign_and_verify(unsigned int nthreads, const unsigned char *pk,
+                           const unsigned char *sk, const spx_ctx *ctx)
+{
+    unsigned char m[SPX_MLEN];
+    unsigned char sig[SPX_BYTES];
+    spx_pool pool;
+    size_t siglen;
+    int ret;
+
+    if (spx_pool_init(&pool, nthreads)) {
+        return -1;
+    }
+    randombytes(m, SPX_MLEN);
+    crypto_sign_signature_pool(sig, &siglen, m, SPX_MLEN, sk, ctx, &pool);
+    ret = crypto_sign_verify(sig, siglen, m, SPX_MLEN, pk);
+    spx_pool_destroy(&pool);
+
+    return ret;
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    unsigned char counts[SPX_TASKS] = {0};
+    spx_pool pool;
+    spx_ctx ctx;
+    int i;
+
+    printf("Testing that every task runs exactly once.. ");
+    if (spx_pool_init(&pool, SPX_THREADS)) {
+        printf("failed to start threads!\n");
+        return -1;
+    }
+    spx_pool_run(&pool, count_task, counts, SPX_TASKS);
+    spx_pool_run(&pool, count_task, counts, SPX_TASKS / 2);
+    spx_pool_destroy(&pool);
+    for (i = 0; i < SPX_TASKS; i++) {
+        if (counts[i] != (i < SPX_TASKS / 2 ? 2 : 1)) {
+            printf("failed for task %d!\n", i);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    crypto_sign_keypair(pk, sk);
+    crypto_sign_ctx_init(&ctx, sk);
+
+    printf("Testing signing without workers.. ");
+    if (sign_and_verify(0, pk, sk, &ctx)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing signing with %d workers.. ", SPX_THREADS);
+    if (sign_and_verify(SPX_THREADS, pk, sk, &ctx)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../sha256.h"
+#include "../randombytes.h"
+#include "../utils.h"
+
+#define MAX_INLEN (3*SPX_SHA256_BLOCK_BYTES)
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char in[MAX_INLEN + 4];
+    unsigned char digest[SPX_SHA256_OUTPUT_BYTES];
+    unsigned char output[SPX_SHA256_OUTPUT_BYTES];
+    unsigned char mask[3*SPX_SHA256_OUTPUT_BYTES + 5];
+    unsigned char expected[sizeof mask];
+    uint32_t state[8];
+    size_t inlen, prefixlen;
+    unsigned long outlen, i;
+
+    randombytes(in, sizeof in);
+
+    printf("Testing spx_sha256_compress and spx_sha256_finalize against "
+           "SHA-256.. ");
+
+    /* Every tail length, on the IV and after absorbing whole blocks. */
+    for (inlen = 0; inlen <= MAX_INLEN; inlen++) {
+        sha256(digest, in, inlen);
+        for (prefixlen = 0; prefixlen <= inlen;
+             prefixlen += SPX_SHA256_BLOCK_BYTES) {
+            memcpy(state, spx_sha256_iv, sizeof state);
+            for (i = 0; i < prefixlen; i += SPX_SHA256_BLOCK_BYTES) {
+                spx_sha256_compress(state, in + i);
+            }
+            spx_sha256_finalize(output, state, in + prefixlen,
+                                inlen - prefixlen, prefixlen);
+            if (memcmp(digest, output, SPX_SHA256_OUTPUT_BYTES)) {
+                printf("failed for %zu bytes after %zu!\n", inlen, prefixlen);
+                return -1;
+            }
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing mgf1 against SHA-256 of the input and a counter.. ");
+
+    for (inlen = 0; inlen <= MAX_INLEN; inlen += 29) {
+        for (i = 0; i*SPX_SHA256_OUTPUT_BYTES < sizeof expected; i++) {
+            memcpy(output, in + inlen, 4);
+            ull_to_bytes(in + inlen, 4, i);
+            sha256(digest, in, inlen + 4);
+            memcpy(in + inlen, output, 4);
+            outlen = sizeof expected - i*SPX_SHA256_OUTPUT_BYTES;
+            if (outlen > SPX_SHA256_OUTPUT_BYTES) {
+                outlen = SPX_SHA256_OUTPUT_BYTES;
+            }
+            memcpy(expected + i*SPX_SHA256_OUTPUT_BYTES, digest, outlen);
+        }
+        mgf1(mask, sizeof mask, in, inlen);
+        if (memcmp(expected, mask, sizeof mask)) {
+            printf("failed for %zu bytes!\n", inlen);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../sigcache.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_SIGNATURES 4
+/* Too small for all layers of a signature, so that subtrees get evicted. */
+#define SPX_SMALL_ENTRIES (SPX_D > 2 ? SPX_D - 2 : 1)
+
+static int sign_and_verify(spx_sigcache *cache, const unsigned char *pk,
+                           const unsigned char *sk, const spx_ctx *ctx)
+{
+    unsigned char m[SPX_MLEN];
+    unsigned char sig[SPX_BYTES];
+    size_t siglen;
+
+    randombytes(m, SPX_MLEN);
+    crypto_sign_signature_cached(sig, &siglen, m, SPX_MLEN, sk, ctx, cache);
+    if (siglen != SPX_BYTES ||
+        crypto_sign_verify(sig, siglen, m, SPX_MLEN, pk)) {
+        return -1;
+    }
+    return 0;
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[2][SPX_PK_BYTES];
+    unsigned char sk[2][SPX_SK_BYTES];
+    spx_ctx ctx[2];
+    spx_sigcache cache;
+    size_t bytes = (SPX_D - 1) * SPX_SIGCACHE_ENTRY_BYTES;
+    void *mem = malloc(bytes);
+    unsigned long hits;
+    int i;
+
+    printf("Generating 2 keypairs.. ");
+    for (i = 0; i < 2; i++) {
+        crypto_sign_keypair(pk[i], sk[i]);
+        crypto_sign_ctx_init(&ctx[i], sk[i]);
+    }
+    printf("done.\n");
+
+    printf("Testing signing with a cache of %d subtrees.. ", SPX_D - 1);
+    spx_sigcache_init(&cache, mem, bytes, pk[0]);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        if (sign_and_verify(&cache, pk[0], sk[0], &ctx[0])) {
+            printf("failed for signature %d!\n", i);
+            return -1;
+        }
+    }
+    /* The top subtree is shared by all signatures. */
+    if (cache.hits < SPX_SIGNATURES - 1) {
+        printf("failed: only %lu cache hits!\n", cache.hits);
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that a full cache evicts the least recently used.. ");
+    spx_sigcache_init(&cache, mem, SPX_SMALL_ENTRIES * SPX_SIGCACHE_ENTRY_BYTES,
+                      pk[0]);
+    for (i = 0; i <= SPX_SMALL_ENTRIES; i++) {
+        spx_sigcache_insert(&cache, 1, (uint64_t)i);
+    }
+    if (spx_sigcache_lookup(&cache, 1, 0) != NULL) {
+        printf("failed: the oldest subtree is still cached!\n");
+        return -1;
+    }
+    for (i = 1; i <= SPX_SMALL_ENTRIES; i++) {
+        if (spx_sigcache_lookup(&cache, 1, (uint64_t)i) == NULL) {
+            printf("failed: subtree %d was evicted!\n", i);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing signing with a cache of %d subtrees.. ",
+           SPX_SMALL_ENTRIES);
+    spx_sigcache_init(&cache, mem, SPX_SMALL_ENTRIES * SPX_SIGCACHE_ENTRY_BYTES,
+                      pk[0]);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        if (sign_and_verify(&cache, pk[0], sk[0], &ctx[0])) {
+            printf("failed for signature %d!\n", i);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing that the cache is not used for another key.. ");
+    hits = cache.hits;
+    if (sign_and_verify(&cache, pk[1], sk[1], &ctx[1]) || cache.hits != hits) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    free(mem);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../sigread.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+/* fors_pk_from_sig_read reads this many FORS trees at once, and
+   wots_leaf_from_sig_read this many WOTS chains; the sha256-avx2 Makefile
+   sets them to eight trees and a whole WOTS signature. */
+#ifndef SPX_FORS_READ_TREES
+#define SPX_FORS_READ_TREES 1
+#endif
+#ifndef SPX_WOTS_READ_CHAINS
+#define SPX_WOTS_READ_CHAINS 8
+#endif
+#define SPX_MAX(a, b) ((a) > (b) ? (a) : (b))
+/* The largest piece: those FORS trees or WOTS chains, or an authentication
+   path. */
+#define SPX_MAX_PIECE \
+    SPX_MAX(SPX_FORS_READ_TREES * SPX_N * (1 + SPX_FORS_HEIGHT), \
+            SPX_MAX(SPX_WOTS_READ_CHAINS * SPX_N, SPX_TREE_HEIGHT * SPX_N))
+
+/* A signature in memory, handed out piece by piece as if read from flash. */
+struct sig_reader {
+    const unsigned char *sig;
+    size_t siglen;
+    size_t pos;
+    size_t max_piece;
+};
+
+static int read_sig(void *arg, unsigned char *buf, size_t len)
+{
+    struct sig_reader *r = arg;
+
+    if (len > r->siglen - r->pos) {
+        return -1;
+    }
+    memcpy(buf, r->sig + r->pos, len);
+    r->pos += len;
+    if (len > r->max_piece) {
+        r->max_piece = len;
+    }
+    return 0;
+}
+
+static int verify_read(struct sig_reader *r, const unsigned char *sig,
+                       size_t siglen, const unsigned char *m,
+                       const unsigned char *pk, const spx_ctx *ctx)
+{
+    r->sig = sig;
+    r->siglen = siglen;
+    r->pos = 0;
+    r->max_piece = 0;
+
+    return crypto_sign_verify_read(read_sig, r, m, SPX_MLEN, pk, ctx);
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    unsigned char m[SPX_MLEN];
+    unsigned char sig[SPX_BYTES];
+    struct sig_reader r;
+    spx_ctx ctx;
+    size_t siglen;
+
+    crypto_sign_keypair(pk, sk);
+    crypto_sign_ctx_init_pk(&ctx, pk);
+    randombytes(m, SPX_MLEN);
+    crypto_sign_signature(sig, &siglen, m, SPX_MLEN, sk);
+
+    printf("Testing verification that reads the signature in pieces.. ");
+    if (verify_read(&r, sig, siglen, m, pk, &ctx) || r.pos != SPX_BYTES) {
+        printf("failed!\n");
+        return -1;
+    }
+    if (r.max_piece > SPX_MAX_PIECE) {
+        printf("failed: read %zu bytes at once, more than %zu!\n",
+               r.max_piece, (size_t)SPX_MAX_PIECE);
+        return -1;
+    }
+    printf("successful, in pieces of at most %zu bytes.\n", r.max_piece);
+
+    printf("Testing that a truncated signature is rejected.. ");
+    if (!verify_read(&r, sig, siglen - 1, m, pk, &ctx)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that a changed signature is rejected.. ");
+    sig[SPX_BYTES - 1] ^= 1;
+    if (!verify_read(&r, sig, siglen, m, pk, &ctx)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
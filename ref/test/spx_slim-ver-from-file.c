@@ -4,6 +4,7 @@
 
 #include "../api.h"
 #include "../params.h"
+#include "../sigread.h"
 
 #define MAX_MSG_SIZE 32 // We only sign 256-bit hashes for image signing 
 #define MAX_PK_SIZE 64 /* SPHINCS+ PK size for SPHINCS+ image 
@@ -13,6 +14,8 @@
 //#define TEST_MSG_RECOVERY // Only if we want to check the recovered 
 			// is the same as the one stored in the file.
 #define PRINT_STACK_SIZE_USED // If you also want to print the stack used. 
+//#define READ_SIG_IN_CHUNKS // Only if we want to verify while reading the
+			// signature file in small pieces instead of loading it.
 
 #ifdef PRINT_STACK_SIZE_USED
 #define BIGGEST_STACK_SIZE_EXPECTED 20000
@@ -60,6 +63,12 @@ static int read_file(const char *filename, void *mem, unsigned max_len,
 }
 
 
+#ifdef READ_SIG_IN_CHUNKS
+/* Reads the next len bytes of the signature from the file f. */
+static int read_sig_chunk(void *f, unsigned char *buf, size_t len) {
+    return fread(buf, 1, len, (FILE *)f) == len ? 0 : -1;
+}
+#endif
 
 /* Verify the SPHINCS+ signatures from the message, public key and 
    signature files provided as input arguments. */
@@ -75,11 +84,13 @@ int main(int argc, char **argv)
 
     static unsigned char pk[MAX_PK_SIZE]; // Statics so they don't count against the stack. 
     static unsigned char m[MAX_MSG_SIZE]; // Statics
+#ifndef READ_SIG_IN_CHUNKS
     static unsigned char sm[MAX_SIG_SIZE]; // Statics
+    static unsigned long long smlen; // Statics
+#endif
 #ifdef TEST_MSG_RECOVERY
     static unsigned char *mout = malloc(MAX_SIG_SIZE); // Statics
 #endif
-    static unsigned long long smlen; // Statics
     static unsigned long long mlen; // Statics
     static unsigned long long pklen; // Statics 
     /* Test if signature is valid. */
@@ -90,6 +101,31 @@ int main(int argc, char **argv)
     // Read public key from file. 
     if (read_file(argv[2], pk, MAX_PK_SIZE, &pklen)==-1) 
        return -1; 
+#ifdef READ_SIG_IN_CHUNKS
+    printf("Successful.\n");
+    // Verify the signature while reading it from its file.
+    static spx_ctx ctx; // Statics
+    FILE *f = fopen(argv[3], "r");
+    if (!f) {
+        fprintf( stderr, "Unable to open file %s for reading.\n", argv[3] );
+        return -1;
+    }
+#ifdef PRINT_STACK_SIZE_USED
+    clear_stack();
+#endif // #ifdef PRINT_STACK_SIZE_USED
+    crypto_sign_ctx_init_pk(&ctx, pk);
+    if (crypto_sign_verify_read(read_sig_chunk, f, m, mlen, pk, &ctx)) {
+        printf("   Chunked verification failed!\n");
+    }
+    else {
+        printf("   Chunked verification succeeded.\n");
+    }
+#ifdef PRINT_STACK_SIZE_USED
+    int tmp = get_stack();
+    printf( "Stack used = %d bytes\n", tmp);
+#endif // #ifdef PRINT_STACK_SIZE_USED
+    fclose(f);
+#else
     // Read signature from file. 
     if (read_file(argv[3], sm, MAX_SIG_SIZE, &smlen)==-1) 
        return -1;
@@ -124,5 +160,6 @@ int main(int argc, char **argv)
     printf( "Stack used = %d bytes\n", tmp);
 #endif // #ifdef PRINT_STACK_SIZE_USED
 #endif // #ifdef TEST_MSG_RECOVERY
+#endif // #ifdef READ_SIG_IN_CHUNKS
     return 0;
 }
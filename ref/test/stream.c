@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../api.h"
+#include "../stream.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 1000
+
+/* Verifies with spx_verify_*, passing the message in pieces of chunk bytes. */
+static int verify_in_pieces(const unsigned char *sig, size_t siglen,
+                            const unsigned char *m, size_t chunk,
+                            const unsigned char *pk, const spx_ctx *ctx)
+{
+    spx_verify_state st;
+    size_t i;
+    size_t n;
+
+    spx_verify_init(&st, sig, siglen, pk, ctx);
+    for (i = 0; i < SPX_MLEN; i += n) {
+        n = SPX_MLEN - i < chunk ? SPX_MLEN - i : chunk;
+        spx_verify_update(&st, m + i, n);
+    }
+    return spx_verify_final(&st);
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    unsigned char m[SPX_MLEN];
+    unsigned char sig[SPX_BYTES];
+    /* Pieces around the SHA-256 block size, and the message as a whole. */
+    const size_t chunks[] = {1, 63, 64, 65, SPX_MLEN};
+    spx_sign_state st;
+    spx_ctx ctx;
+    spx_ctx ctx_pk;
+    size_t siglen;
+    size_t i;
+
+    crypto_sign_keypair(pk, sk);
+    crypto_sign_ctx_init(&ctx, sk);
+    crypto_sign_ctx_init_pk(&ctx_pk, pk);
+    randombytes(m, SPX_MLEN);
+
+    printf("Testing that a signature needs two passes.. ");
+    spx_sign_init(&st, sk, &ctx);
+    spx_sign_update(&st, m, SPX_MLEN);
+    if (spx_sign_final(sig, &siglen, &st) != -1) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing signing in pieces of different sizes per pass.. ");
+    spx_sign_rewind(&st);
+    spx_sign_update(&st, m, 100);
+    spx_sign_update(&st, m + 100, SPX_MLEN - 100);
+    if (spx_sign_rewind(&st) != -1 ||
+        spx_sign_final(sig, &siglen, &st) ||
+        crypto_sign_verify(sig, siglen, m, SPX_MLEN, pk)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing verifying in pieces.. ");
+    for (i = 0; i < sizeof chunks / sizeof chunks[0]; i++) {
+        if (verify_in_pieces(sig, siglen, m, chunks[i], pk, &ctx_pk)) {
+            printf("failed for pieces of %zu bytes!\n", chunks[i]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing verifying a signature from crypto_sign_signature.. ");
+    crypto_sign_signature(sig, &siglen, m, SPX_MLEN, sk);
+    if (verify_in_pieces(sig, siglen, m, 64, pk, &ctx_pk)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing that a changed message is rejected.. ");
+    m[SPX_MLEN - 1] ^= 1;
+    if (!verify_in_pieces(sig, siglen, m, 65, pk, &ctx_pk) ||
+        !verify_in_pieces(sig, siglen - 1, m, 65, pk, &ctx_pk)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    return 0;
+}
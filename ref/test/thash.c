@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../thash.h"
+#include "../hash.h"
+#include "../randombytes.h"
+#include "../params.h"
+#include "../sha256.h"
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char input[4*2*SPX_N];
+    unsigned char seed[SPX_N];
+    spx_ctx ctx;
+    unsigned char output[SPX_N];
+    uint32_t addr[4*8] = {0};
+    unsigned char buf[SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES + 2*SPX_N];
+    unsigned char digest[SPX_SHA256_OUTPUT_BYTES];
+    unsigned int inblocks, j;
+
+    randombytes(seed, SPX_N);
+    randombytes(input, 4*2*SPX_N);
+    randombytes((unsigned char *)addr, 4 * 8 * sizeof(uint32_t));
+
+    /* thash reads the state seeded with pub_seed from ctx, so set it up first. */
+    initialize_hash_function(&ctx, seed, NULL);
+
+    printf("Testing thash against SHA-256 over its padded input.. ");
+
+    /* SHA-256(pub_seed || 0-padding || compressed address || input) */
+    memset(buf, 0, SPX_SHA256_BLOCK_BYTES);
+    memcpy(buf, seed, SPX_N);
+    for (inblocks = 1; inblocks <= 2; inblocks++) {
+        for (j = 0; j < 4; j++) {
+            compress_address(buf + SPX_SHA256_BLOCK_BYTES, addr + j*8);
+            memcpy(buf + SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES,
+                   input + j * 2*SPX_N, inblocks*SPX_N);
+            sha256(digest, buf, SPX_SHA256_BLOCK_BYTES
+                                + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
+
+            thash(output, input + j * 2*SPX_N, inblocks, &ctx, addr + j*8);
+
+            if (memcmp(digest, output, SPX_N)) {
+                printf("failed for %u blocks!\n", inblocks);
+                return -1;
+            }
+        }
+    }
+    printf("successful.\n");
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "../wots.h"
+#include "../hash.h"
 #include "../randombytes.h"
 #include "../params.h"
 
@@ -12,6 +13,7 @@ int main()
 
     unsigned char seed[SPX_N];
     unsigned char pub_seed[SPX_N];
+    spx_ctx ctx;
     unsigned char pk1[SPX_WOTS_PK_BYTES];
     unsigned char pk2[SPX_WOTS_PK_BYTES];
     unsigned char sig[SPX_WOTS_BYTES];
@@ -23,11 +25,14 @@ int main()
     randombytes(m, SPX_N);
     randombytes((unsigned char *)addr, 8 * sizeof(uint32_t));
 
+    /* thash reads the state seeded with pub_seed from ctx, so set it up first. */
+    initialize_hash_function(&ctx, pub_seed, NULL);
+
     printf("Testing WOTS signature and PK derivation.. ");
 
-    wots_gen_pk(pk1, seed, pub_seed, addr);
-    wots_sign(sig, m, seed, pub_seed, addr);
-    wots_pk_from_sig(pk2, sig, m, pub_seed, addr);
+    wots_gen_pk(pk1, seed, &ctx, addr);
+    wots_sign(sig, m, seed, &ctx, addr);
+    wots_pk_from_sig(pk2, sig, m, &ctx, addr);
 
     if (memcmp(pk1, pk2, SPX_WOTS_PK_BYTES)) {
         printf("failed!\n");
@@ -3,7 +3,43 @@
 
 #include <stdint.h>
 
+#include "context.h"
+#include "hash.h"
+
 void thash(unsigned char *out, const unsigned char *in, unsigned int inblocks,
-           const unsigned char *pub_seed, uint32_t addr[8]);
+           const spx_ctx *ctx, uint32_t addr[8]);
+
+/*
+ * The same hash as thash, for inputs that are produced one SPX_N-byte block
+ * at a time: thash_init, thash_absorb for each block, and thash_final. The
+ * blocks never have to be stored side by side, which saves the caller an
+ * array of inblocks*SPX_N bytes and thash a copy of it.
+ */
+void thash_init(spx_hash_stream *s, const spx_ctx *ctx,
+                const uint32_t addr[8]);
+
+void thash_absorb(spx_hash_stream *s, const unsigned char *in);
+
+void thash_final(unsigned char *out, spx_hash_stream *s);
+
+/**
+ * Applies thash with one input block steps times to the n-byte value in, as
+ * the WOTS chain at addr does from hash address start on, and writes the
+ * result to out, which may equal in. addr is left untouched. Since only the
+ * hash address changes from one step to the next, the chain value stays in
+ * the message words and is written to out only at the end.
+ */
+void thash_chain(unsigned char *out, const unsigned char *in,
+                 unsigned int start, unsigned int steps,
+                 const spx_ctx *ctx, const uint32_t addr[8]);
+
+#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+/**
+ * thash_chain from a seeded state of its own, as in thashx8_seeded.
+ */
+void thash_chain_seeded(unsigned char *out, const unsigned char *in,
+                        unsigned int start, unsigned int steps,
+                        const uint8_t *state_seeded, const uint32_t addr[8]);
+#endif
 
 #endif
@@ -2,44 +2,191 @@
 #include <string.h>
 
 #include "thash.h"
+#include "hash.h"
 #include "address.h"
 #include "params.h"
 #include "sha256.h"
 
+static inline uint32_t load_bigendian_32(const unsigned char *x)
+{
+    return ((uint32_t)x[0] << 24) | ((uint32_t)x[1] << 16)
+         | ((uint32_t)x[2] << 8) | (uint32_t)x[3];
+}
+
+static inline uint32_t load_bigendian_16(const unsigned char *x)
+{
+    return ((uint32_t)x[0] << 8) | (uint32_t)x[1];
+}
+
+static inline void store_bigendian_32(unsigned char *x, uint32_t u)
+{
+    x[0] = (unsigned char)(u >> 24);
+    x[1] = (unsigned char)(u >> 16);
+    x[2] = (unsigned char)(u >> 8);
+    x[3] = (unsigned char)u;
+}
+
+/**
+ * thash for F and H, i.e. one or two input blocks. Their length is fixed, so
+ * the message words that follow the pub_seed block are built straight from
+ * the address words and the input, with constant padding and length, and
+ * compressed from the seeded midstate. This replaces compress_address, the
+ * copy into buf and the buffering of sha256_inc_finalize, with any SHA256
+ * implementation.
+ */
+static inline void thash_fixed(unsigned char *out, const unsigned char *in,
+                               const unsigned int inblocks,
+                               const spx_ctx *ctx, const uint32_t addr[8])
+{
+    const unsigned int inlen = SPX_SHA256_ADDR_BYTES + inblocks*SPX_N;
+    const unsigned int nblocks = (inlen + 9 + SPX_SHA256_BLOCK_BYTES - 1)
+                                 / SPX_SHA256_BLOCK_BYTES;
+    uint32_t state[8];
+    uint32_t w[2*16] = {0};
+    unsigned int i;
+
+    /* The 22-byte compressed address, and the first two bytes of input. */
+    w[0] = (addr[0] << 24) | (addr[2] >> 8);
+    w[1] = (addr[2] << 24) | (addr[3] >> 8);
+    w[2] = (addr[3] << 24) | ((addr[4] & 0xff) << 16) | (addr[5] >> 16);
+    w[3] = (addr[5] << 16) | (addr[6] >> 16);
+    w[4] = (addr[6] << 16) | (addr[7] >> 16);
+    w[5] = (addr[7] << 16) | load_bigendian_16(in);
+    for (i = 1; i < inblocks*SPX_N / 4; i++) {
+        w[5 + i] = load_bigendian_32(in + 4*i - 2);
+    }
+    /* The last two bytes of input, followed by the 0x80 padding byte. */
+    w[5 + i] = (load_bigendian_16(in + 4*i - 2) << 16) | 0x8000;
+    w[16*nblocks - 1] = (SPX_SHA256_BLOCK_BYTES + inlen) << 3;
+
+    memcpy(state, ctx->seeded_words, sizeof state);
+    for (i = 0; i < nblocks; i++) {
+        sha256_compress_words(state, w + 16*i);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        store_bigendian_32(out + 4*i, state[i]);
+    }
+}
+
+#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256) // If using a SHA256 implementation from crypto_hash/sha512/ref/
+void thash_chain_seeded(unsigned char *out, const unsigned char *in,
+                        unsigned int start, unsigned int steps,
+                        const uint8_t *state_seeded, const uint32_t addr[8])
+{
+    uint32_t seeded[8];
+    uint32_t value[SPX_N / 4];
+    uint32_t w[16] = {0};
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        seeded[i] = load_bigendian_32(state_seeded + 4*i);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        value[i] = load_bigendian_32(in + 4*i);
+    }
+
+    /* As in thash_fixed; words 5 and on are filled in by sha256_chain_words,
+       as of the address only the hash address varies. */
+    w[0] = (addr[0] << 24) | (addr[2] >> 8);
+    w[1] = (addr[2] << 24) | (addr[3] >> 8);
+    w[2] = (addr[3] << 24) | ((addr[4] & 0xff) << 16) | (addr[5] >> 16);
+    w[3] = (addr[5] << 16) | (addr[6] >> 16);
+    w[4] = (addr[6] << 16);
+    w[15] = (SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES + SPX_N) << 3;
+
+    sha256_chain_words(value, SPX_N / 4, seeded, w, start, steps);
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        store_bigendian_32(out + 4*i, value[i]);
+    }
+}
+#endif //#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+
+void thash_chain(unsigned char *out, const unsigned char *in,
+                 unsigned int start, unsigned int steps,
+                 const spx_ctx *ctx, const uint32_t addr[8])
+{
+#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+    thash_chain_seeded(out, in, start, steps, ctx->state_seeded, addr);
+#else
+    uint32_t chain_addr[8];
+    unsigned int k;
+
+    memcpy(chain_addr, addr, sizeof chain_addr);
+    memmove(out, in, SPX_N);
+    for (k = 0; k < steps; k++) {
+        set_hash_addr(chain_addr, start + k);
+        thash(out, out, 1, ctx, chain_addr);
+    }
+#endif
+}
+
 /**
  * Takes an array of inblocks concatenated arrays of SPX_N bytes.
  */
-void thash(unsigned char *out, const unsigned char *in, unsigned int inblocks,
-           const unsigned char *pub_seed, uint32_t addr[8])
+static void thash_any(unsigned char *out, const unsigned char *in,
+                      unsigned int inblocks,
+                      const spx_ctx *ctx, uint32_t addr[8])
 {
     unsigned char buf[SPX_SHA256_ADDR_BYTES + inblocks*SPX_N];
     unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-    SHA256_CTX sha2ctx;
-    SHA256_Init(&sha2ctx); // Initialize (to prevent segmentation fault).
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    uint8_t sha2_state[40];
-    // sha256_inc_init(sha2_state); // Initialize the state 
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+    uint32_t state[8];
 
-    (void)pub_seed; /* Suppress an 'unused parameter' warning. */
-    /* Retrieve precomputed state containing pub_seed */
-#if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
-a SHA256 implementation with the OpenSSL API */
-    memcpy(&sha2ctx, &sha2ctx_seeded, 10*sizeof(unsigned long)+sizeof(unsigned));
-#else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    memcpy(sha2_state, state_seeded, 40 * sizeof(uint8_t));
-#endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+    /* Continue from the precomputed state containing pub_seed */
+    memcpy(state, ctx->seeded_words, sizeof state);
 
     compress_address(buf, addr);
     memcpy(buf + SPX_SHA256_ADDR_BYTES, in, inblocks * SPX_N);
+    spx_sha256_finalize(outbuf, state, buf,
+                        SPX_SHA256_ADDR_BYTES + inblocks*SPX_N,
+                        SPX_SHA256_BLOCK_BYTES);
+    memcpy(out, outbuf, SPX_N);
+}
+
+/**
+ * Takes an array of inblocks concatenated arrays of SPX_N bytes.
+ */
+void thash(unsigned char *out, const unsigned char *in, unsigned int inblocks,
+           const spx_ctx *ctx, uint32_t addr[8])
+{
+    if (inblocks == 1) {
+        thash_fixed(out, in, 1, ctx, addr);
+        return;
+    }
+    if (inblocks == 2) {
+        thash_fixed(out, in, 2, ctx, addr);
+        return;
+    }
+    thash_any(out, in, inblocks, ctx, addr);
+}
+
+void thash_init(spx_hash_stream *s, const spx_ctx *ctx,
+                const uint32_t addr[8])
+{
+    unsigned char buf[SPX_SHA256_ADDR_BYTES];
+
+    /* Continue from the precomputed state containing pub_seed */
 #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256) /* If using 
 a SHA256 implementation with the OpenSSL API */
-    SHA256_Update(&sha2ctx, buf, SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
-    SHA256_Final(outbuf, &sha2ctx);
+    s->sha2ctx = ctx->sha2ctx_seeded;
 #else // Or if using a SHA256 implementation from crypto_hash/sha512/ref/
-    sha256_inc_finalize(outbuf, sha2_state, buf, SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
+    memcpy(s->state, ctx->state_seeded, 40 * sizeof(uint8_t));
+    s->buflen = 0;
 #endif // #if defined(USE_OPENSSL_SHA256) || defined(USE_OPENSSL_API_SHA256)
+
+    compress_address(buf, addr);
+    hash_stream_update(s, buf, SPX_SHA256_ADDR_BYTES);
+}
+
+void thash_absorb(spx_hash_stream *s, const unsigned char *in)
+{
+    hash_stream_update(s, in, SPX_N);
+}
+
+void thash_final(unsigned char *out, spx_hash_stream *s)
+{
+    unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
+
+    hash_stream_final(outbuf, s);
     memcpy(out, outbuf, SPX_N);
 }
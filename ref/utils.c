@@ -42,7 +42,7 @@ unsigned long long bytes_to_ull(const unsigned char *in, unsigned int inlen)
 void compute_root(unsigned char *root, const unsigned char *leaf,
                   uint32_t leaf_idx, uint32_t idx_offset,
                   const unsigned char *auth_path, uint32_t tree_height,
-                  const unsigned char *pub_seed, uint32_t addr[8])
+                  const spx_ctx *ctx, uint32_t addr[8])
 {
     uint32_t i;
     unsigned char buffer[2 * SPX_N];
@@ -67,11 +67,11 @@ void compute_root(unsigned char *root, const unsigned char *leaf,
 
         /* Pick the right or left neighbor, depending on parity of the node. */
         if (leaf_idx & 1) {
-            thash(buffer + SPX_N, buffer, 2, pub_seed, addr);
+            thash(buffer + SPX_N, buffer, 2, ctx, addr);
             memcpy(buffer, auth_path, SPX_N);
         }
         else {
-            thash(buffer, buffer, 2, pub_seed, addr);
+            thash(buffer, buffer, 2, ctx, addr);
             memcpy(buffer + SPX_N, auth_path, SPX_N);
         }
         auth_path += SPX_N;
@@ -82,7 +82,7 @@ void compute_root(unsigned char *root, const unsigned char *leaf,
     idx_offset >>= 1;
     set_tree_height(addr, tree_height);
     set_tree_index(addr, leaf_idx + idx_offset);
-    thash(root, buffer, 2, pub_seed, addr);
+    thash(root, buffer, 2, ctx, addr);
 }
 
 /**
@@ -95,12 +95,12 @@ void compute_root(unsigned char *root, const unsigned char *leaf,
  */
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
 void treehash(unsigned char *root, unsigned char *auth_path,
-              const unsigned char *sk_seed, const unsigned char *pub_seed,
+              const unsigned char *sk_seed, const spx_ctx *ctx,
               uint32_t leaf_idx, uint32_t idx_offset, uint32_t tree_height,
               void (*gen_leaf)(
                  unsigned char* /* leaf */,
                  const unsigned char* /* sk_seed */,
-                 const unsigned char* /* pub_seed */,
+                 const spx_ctx* /* ctx */,
                  uint32_t /* addr_idx */, const uint32_t[8] /* tree_addr */),
               uint32_t tree_addr[8])
 {
@@ -113,7 +113,7 @@ void treehash(unsigned char *root, unsigned char *auth_path,
     for (idx = 0; idx < (uint32_t)(1 << tree_height); idx++) {
         /* Add the next leaf node to the stack. */
         gen_leaf(stack + offset*SPX_N,
-                 sk_seed, pub_seed, idx + idx_offset, tree_addr);
+                 sk_seed, ctx, idx + idx_offset, tree_addr);
         offset++;
         heights[offset - 1] = 0;
 
@@ -133,7 +133,7 @@ void treehash(unsigned char *root, unsigned char *auth_path,
                            tree_idx + (idx_offset >> (heights[offset-1] + 1)));
             /* Hash the top-most nodes from the stack together. */
             thash(stack + (offset - 2)*SPX_N,
-                  stack + (offset - 2)*SPX_N, 2, pub_seed, tree_addr);
+                  stack + (offset - 2)*SPX_N, 2, ctx, tree_addr);
             offset--;
             /* Note that the top-most node is now one layer higher. */
             heights[offset - 1]++;
@@ -147,4 +147,45 @@ void treehash(unsigned char *root, unsigned char *auth_path,
     }
     memcpy(root, stack, SPX_N);
 }
-#endif
+
+void treehash_nodes(unsigned char *nodes,
+                    const unsigned char *sk_seed, const spx_ctx *ctx,
+                    uint32_t tree_height,
+                    void (*gen_leaf)(
+                       unsigned char* /* leaf */,
+                       const unsigned char* /* sk_seed */,
+                       const spx_ctx* /* ctx */,
+                       uint32_t /* addr_idx */, const uint32_t[8] /* tree_addr */),
+                    uint32_t tree_addr[8])
+{
+    unsigned char *in = nodes;
+    unsigned char *out;
+    uint32_t idx;
+    uint32_t h;
+
+    for (idx = 0; idx < (uint32_t)(1 << tree_height); idx++) {
+        gen_leaf(nodes + idx*SPX_N, sk_seed, ctx, idx, tree_addr);
+    }
+    for (h = 1; h <= tree_height; h++) {
+        out = in + (1 << (tree_height - h + 1))*SPX_N;
+        set_tree_height(tree_addr, h);
+        for (idx = 0; idx < (uint32_t)(1 << (tree_height - h)); idx++) {
+            set_tree_index(tree_addr, idx);
+            thash(out + idx*SPX_N, in + 2*idx*SPX_N, 2, ctx, tree_addr);
+        }
+        in = out;
+    }
+}
+
+void auth_path_from_nodes(unsigned char *auth_path, const unsigned char *nodes,
+                          uint32_t leaf_idx, uint32_t tree_height)
+{
+    uint32_t h;
+
+    for (h = 0; h < tree_height; h++) {
+        memcpy(auth_path + h*SPX_N, nodes + (leaf_idx ^ 1)*SPX_N, SPX_N);
+        nodes += (1 << (tree_height - h))*SPX_N;
+        leaf_idx >>= 1;
+    }
+}
+#endif // #ifndef BUILD_SLIM_VERIFIER
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "params.h"
+#include "context.h"
 
 /**
  * Converts the value of 'in' to 'outlen' bytes in big-endian byte order.
@@ -22,7 +23,7 @@ unsigned long long bytes_to_ull(const unsigned char *in, unsigned int inlen);
 void compute_root(unsigned char *root, const unsigned char *leaf,
                   uint32_t leaf_idx, uint32_t idx_offset,
                   const unsigned char *auth_path, uint32_t tree_height,
-                  const unsigned char *pub_seed, uint32_t addr[8]);
+                  const spx_ctx *ctx, uint32_t addr[8]);
 
 /**
  * For a given leaf index, computes the authentication path and the resulting
@@ -33,13 +34,36 @@ void compute_root(unsigned char *root, const unsigned char *leaf,
  * it is possible to continue counting indices across trees.
  */
 void treehash(unsigned char *root, unsigned char *auth_path,
-              const unsigned char *sk_seed, const unsigned char *pub_seed,
+              const unsigned char *sk_seed, const spx_ctx *ctx,
               uint32_t leaf_idx, uint32_t idx_offset, uint32_t tree_height,
               void (*gen_leaf)(
                  unsigned char* /* leaf */,
                  const unsigned char* /* sk_seed */,
-                 const unsigned char* /* pub_seed */,
+                 const spx_ctx* /* ctx */,
                  uint32_t /* addr_idx */, const uint32_t[8] /* tree_addr */),
               uint32_t tree_addr[8]);
 
+
+/**
+ * Computes all nodes of a tree of height tree_height, level by level starting
+ * with the leaves, so that the root comes last; (2^(tree_height+1) - 1) * N
+ * bytes in total. Uses the same addresses as treehash with idx_offset 0.
+ */
+void treehash_nodes(unsigned char *nodes,
+                    const unsigned char *sk_seed, const spx_ctx *ctx,
+                    uint32_t tree_height,
+                    void (*gen_leaf)(
+                       unsigned char* /* leaf */,
+                       const unsigned char* /* sk_seed */,
+                       const spx_ctx* /* ctx */,
+                       uint32_t /* addr_idx */, const uint32_t[8] /* tree_addr */),
+                    uint32_t tree_addr[8]);
+
+/**
+ * Reads the authentication path of leaf leaf_idx off the nodes of a tree,
+ * as computed by treehash_nodes.
+ */
+void auth_path_from_nodes(unsigned char *auth_path, const unsigned char *nodes,
+                          uint32_t leaf_idx, uint32_t tree_height);
+
 #endif
@@ -8,6 +8,10 @@
 #include "address.h"
 #include "params.h"
 
+/* The chains that wots_leaf_from_sig completes together; it only holds that
+   many chain ends at a time. */
+#define SPX_WOTS_LEAF_CHAINS 8
+
 // TODO clarify address expectations, and make them more uniform.
 // TODO i.e. do we expect types to be set already?
 // TODO and do we expect modifications or copies?
@@ -29,25 +33,28 @@ static void wots_gen_sk(unsigned char *sk, const unsigned char *sk_seed,
 #endif
 
 /**
- * Computes the chaining function.
- * out and in have to be n-byte arrays.
+ * Computes the chaining function for the nchains chains of a key starting at
+ * chain first. out and in have to be nchains*n-byte arrays, and may be equal.
  *
- * Interprets in as start-th value of the chain.
- * addr has to contain the address of the chain.
+ * Interprets in[i] as start[i]-th value of chain first + i and advances it by
+ * steps[i], one chain at a time with thash_chain.
+ * addr has to contain the address of the WOTS key pair.
  */
-static void gen_chain(unsigned char *out, const unsigned char *in,
-                      unsigned int start, unsigned int steps,
-                      const unsigned char *pub_seed, uint32_t addr[8])
+static void gen_chains(unsigned char *out, const unsigned char *in,
+                       const int *start, const int *steps,
+                       unsigned int first, unsigned int nchains,
+                       const spx_ctx *ctx, uint32_t addr[8])
 {
-    uint32_t i;
-
-    /* Initialize out with the value at position 'start'. */
-    memcpy(out, in, SPX_N);
+    unsigned int i;
+    int left;
 
-    /* Iterate 'steps' calls to the hash function. */
-    for (i = start; i < (start+steps) && i < SPX_WOTS_W; i++) {
-        set_hash_addr(addr, i);
-        thash(out, out, 1, pub_seed, addr);
+    for (i = 0; i < nchains; i++) {
+        left = steps[i];
+        if (start[i] + left > SPX_WOTS_W) {
+            left = SPX_WOTS_W - start[i];
+        }
+        set_chain_addr(addr, first + i);
+        thash_chain(out + i*SPX_N, in + i*SPX_N, start[i], left, ctx, addr);
     }
 }
 
@@ -105,33 +112,36 @@ static void chain_lengths(int *lengths, const unsigned char *msg)
 /**
  * WOTS key generation. Takes a 32 byte sk_seed, expands it to WOTS private key
  * elements and computes the corresponding public key.
- * It requires the seed pub_seed (used to generate bitmasks and hash keys)
- * and the address of this WOTS key pair.
+ * It requires the context ctx (holding pub_seed, used to generate bitmasks
+ * and hash keys) and the address of this WOTS key pair.
  *
  * Writes the computed public key to 'pk'.
  */
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim 
 void wots_gen_pk(unsigned char *pk, const unsigned char *sk_seed,
-                 const unsigned char *pub_seed, uint32_t addr[8])
+                 const spx_ctx *ctx, uint32_t addr[8])
 {
+    int start[SPX_WOTS_LEN], steps[SPX_WOTS_LEN];
     uint32_t i;
 
     for (i = 0; i < SPX_WOTS_LEN; i++) {
         set_chain_addr(addr, i);
         wots_gen_sk(pk + i*SPX_N, sk_seed, addr);
-        gen_chain(pk + i*SPX_N, pk + i*SPX_N,
-                  0, SPX_WOTS_W - 1, pub_seed, addr);
+        start[i] = 0;
+        steps[i] = SPX_WOTS_W - 1;
     }
+    gen_chains(pk, pk, start, steps, 0, SPX_WOTS_LEN, ctx, addr);
 }
 
 /**
  * Takes a n-byte message and the 32-byte sk_see to compute a signature 'sig'.
  */
 void wots_sign(unsigned char *sig, const unsigned char *msg,
-               const unsigned char *sk_seed, const unsigned char *pub_seed,
+               const unsigned char *sk_seed, const spx_ctx *ctx,
                uint32_t addr[8])
 {
     int lengths[SPX_WOTS_LEN];
+    int start[SPX_WOTS_LEN];
     uint32_t i;
 
     chain_lengths(lengths, msg);
@@ -139,8 +149,40 @@ void wots_sign(unsigned char *sig, const unsigned char *msg,
     for (i = 0; i < SPX_WOTS_LEN; i++) {
         set_chain_addr(addr, i);
         wots_gen_sk(sig + i*SPX_N, sk_seed, addr);
-        gen_chain(sig + i*SPX_N, sig + i*SPX_N, 0, lengths[i], pub_seed, addr);
+        start[i] = 0;
     }
+    gen_chains(sig, sig, start, lengths, 0, SPX_WOTS_LEN, ctx, addr);
+}
+
+/**
+ * Computes the leaf at a given address. First generates the WOTS key pair,
+ * then computes leaf by hashing horizontally.
+ */
+void wots_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
+                   const spx_ctx *ctx,
+                   uint32_t addr_idx, const uint32_t tree_addr[8])
+{
+    unsigned char pk[SPX_WOTS_BYTES];
+    uint32_t wots_addr[8] = {0};
+    uint32_t wots_pk_addr[8] = {0};
+
+    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
+
+    copy_subtree_addr(wots_addr, tree_addr);
+    set_keypair_addr(wots_addr, addr_idx);
+    wots_gen_pk(pk, sk_seed, ctx, wots_addr);
+
+    copy_keypair_addr(wots_pk_addr, wots_addr);
+    thash(leaf, pk, SPX_WOTS_LEN, ctx, wots_pk_addr);
+}
+
+void wots_treehash(unsigned char *root, unsigned char *auth_path,
+                   const unsigned char *sk_seed, const spx_ctx *ctx,
+                   uint32_t leaf_idx, uint32_t tree_addr[8])
+{
+    treehash(root, auth_path, sk_seed, ctx, leaf_idx, 0, SPX_TREE_HEIGHT,
+             wots_gen_leaf, tree_addr);
 }
 #endif
 
@@ -151,16 +193,81 @@ void wots_sign(unsigned char *sig, const unsigned char *msg,
  */
 void wots_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *msg,
-                      const unsigned char *pub_seed, uint32_t addr[8])
+                      const spx_ctx *ctx, uint32_t addr[8])
 {
     int lengths[SPX_WOTS_LEN];
+    int steps[SPX_WOTS_LEN];
     uint32_t i;
 
     chain_lengths(lengths, msg);
 
     for (i = 0; i < SPX_WOTS_LEN; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(pk + i*SPX_N, sig + i*SPX_N,
-                  lengths[i], SPX_WOTS_W - 1 - lengths[i], pub_seed, addr);
+        steps[i] = SPX_WOTS_W - 1 - lengths[i];
+    }
+    gen_chains(pk, sig, lengths, steps, 0, SPX_WOTS_LEN, ctx, addr);
+}
+
+/**
+ * Takes a WOTS signature and an n-byte message, and computes the leaf that
+ * the WOTS public key hashes to, as thash over the output of
+ * wots_pk_from_sig would. The chains are completed SPX_WOTS_LEAF_CHAINS at a
+ * time and absorbed right away, so the public key is never stored whole.
+ * Reads the signature from sig, or with read(arg, ...) if sig is NULL.
+ */
+static int leaf_from_sig(unsigned char *leaf, const unsigned char *sig,
+                         spx_read_fn read, void *arg,
+                         const unsigned char *msg,
+                         const spx_ctx *ctx, uint32_t addr[8])
+{
+    int lengths[SPX_WOTS_LEN];
+    int steps[SPX_WOTS_LEAF_CHAINS];
+    unsigned char ends[SPX_WOTS_LEAF_CHAINS * SPX_N];
+    uint32_t wots_pk_addr[8] = {0};
+    spx_hash_stream s;
+    unsigned int nchains;
+    unsigned int i, j;
+
+    chain_lengths(lengths, msg);
+
+    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
+    copy_keypair_addr(wots_pk_addr, addr);
+    thash_init(&s, ctx, wots_pk_addr);
+
+    for (i = 0; i < SPX_WOTS_LEN; i += nchains) {
+        nchains = SPX_WOTS_LEN - i;
+        if (nchains > SPX_WOTS_LEAF_CHAINS) {
+            nchains = SPX_WOTS_LEAF_CHAINS;
+        }
+        if (sig) {
+            memcpy(ends, sig + i*SPX_N, nchains * SPX_N);
+        }
+        else if (read(arg, ends, nchains * SPX_N)) {
+            return -1;
+        }
+        for (j = 0; j < nchains; j++) {
+            steps[j] = SPX_WOTS_W - 1 - lengths[i + j];
+        }
+        gen_chains(ends, ends, lengths + i, steps, i, nchains, ctx, addr);
+        for (j = 0; j < nchains; j++) {
+            thash_absorb(&s, ends + j*SPX_N);
+        }
     }
+    thash_final(leaf, &s);
+
+    return 0;
+}
+
+void wots_leaf_from_sig(unsigned char *leaf,
+                        const unsigned char *sig, const unsigned char *msg,
+                        const spx_ctx *ctx, uint32_t addr[8])
+{
+    leaf_from_sig(leaf, sig, NULL, NULL, msg, ctx, addr);
+}
+
+int wots_leaf_from_sig_read(unsigned char *leaf,
+                            spx_read_fn read, void *arg,
+                            const unsigned char *msg,
+                            const spx_ctx *ctx, uint32_t addr[8])
+{
+    return leaf_from_sig(leaf, NULL, read, arg, msg, ctx, addr);
 }
@@ -3,36 +3,75 @@
 
 #include <stdint.h>
 #include "params.h"
+#include "context.h"
+#include "sigread.h"
 
 
 #ifndef BUILD_SLIM_VERIFIER // Don't use in verifier to keep it slim
 /**
  * WOTS key generation. Takes a 32 byte seed for the private key, expands it to
  * a full WOTS private key and computes the corresponding public key.
- * It requires the seed pub_seed (used to generate bitmasks and hash keys)
- * and the address of this WOTS key pair.
+ * It requires the context ctx (holding pub_seed, used to generate bitmasks
+ * and hash keys) and the address of this WOTS key pair.
  *
  * Writes the computed public key to 'pk'.
  */
 void wots_gen_pk(unsigned char *pk, const unsigned char *seed,
-                 const unsigned char *pub_seed, uint32_t addr[8]);
+                 const spx_ctx *ctx, uint32_t addr[8]);
 
 /**
  * Takes a n-byte message and the 32-byte seed for the private key to compute a
  * signature that is placed at 'sig'.
  */
 void wots_sign(unsigned char *sig, const unsigned char *msg,
-               const unsigned char *seed, const unsigned char *pub_seed,
+               const unsigned char *seed, const spx_ctx *ctx,
                uint32_t addr[8]);
+
+/**
+ * Computes the leaf at a given address. First generates the WOTS key pair,
+ * then computes leaf by hashing horizontally.
+ */
+void wots_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
+                   const spx_ctx *ctx,
+                   uint32_t addr_idx, const uint32_t tree_addr[8]);
+
+/**
+ * Computes the root of the hypertree subtree at tree_addr and the
+ * authentication path of leaf leaf_idx; the same as treehash over
+ * wots_gen_leaf, but each implementation generates the leaves its own way.
+ * Expects the layer and tree parts of tree_addr to be set, as well as the
+ * tree type (SPX_ADDR_TYPE_HASHTREE).
+ */
+void wots_treehash(unsigned char *root, unsigned char *auth_path,
+                   const unsigned char *sk_seed, const spx_ctx *ctx,
+                   uint32_t leaf_idx, uint32_t tree_addr[8]);
 #endif // #ifndef BUILD_SLIM_VERIFIER
 
 /**
  * Takes a WOTS signature and an n-byte message, computes a WOTS public key.
  *
- * Writes the computed public key to 'pk'.
+ * Writes the computed public key to 'pk', which may be the same as 'sig'.
  */
 void wots_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *msg,
-                      const unsigned char *pub_seed, uint32_t addr[8]);
+                      const spx_ctx *ctx, uint32_t addr[8]);
+
+/**
+ * Takes a WOTS signature and an n-byte message, computes the leaf of the WOTS
+ * public key, i.e. its thash under the WOTS_PK address of the key pair.
+ * Needs less memory than wots_pk_from_sig followed by thash.
+ */
+void wots_leaf_from_sig(unsigned char *leaf,
+                        const unsigned char *sig, const unsigned char *msg,
+                        const spx_ctx *ctx, uint32_t addr[8]);
+
+/**
+ * Like wots_leaf_from_sig, but reads the signature with read(arg, ...) a few
+ * chains at a time. Returns -1 if it cannot be read.
+ */
+int wots_leaf_from_sig_read(unsigned char *leaf,
+                            spx_read_fn read, void *arg,
+                            const unsigned char *msg,
+                            const spx_ctx *ctx, uint32_t addr[8]);
 
 #endif
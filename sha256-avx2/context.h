@@ -0,0 +1 @@
+../ref/context.h
\ No newline at end of file
@@ -0,0 +1,476 @@
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "dispatch.h"
+#include "params.h"
+#include "hash.h"
+#include "hashx8.h"
+#include "thash.h"
+#include "thashx4.h"
+#include "thashx8.h"
+#include "thashx16.h"
+#include "sha256.h"
+#include "sha256shani.h"
+#include "sha256sse2.h"
+#include "sha256x8.h"
+
+/* Until spx_dispatch_init has run, only use code that runs everywhere. */
+struct spx_dispatch spx_dispatch = {
+    SPX_IMPL_PORTABLE, SPX_IMPL_PORTABLE, SPX_IMPL_PORTABLE, SPX_IMPL_PORTABLE,
+    SPX_IMPL_PORTABLE
+};
+
+static unsigned int cpu_features;
+static int cpu_features_known = 0;
+
+static unsigned int detect_cpu_features(void)
+{
+    unsigned int features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_lo = 0, xcr0_hi = 0;
+    int sse41;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    sse41 = (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+    /* The OS has to save the AVX (and AVX-512) registers on context switch. */
+    if (ecx & bit_OSXSAVE) {
+        __asm__ __volatile__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi)
+                                       : "c" (0));
+    }
+    (void)xcr0_hi;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+#ifdef SPX_WITH_SHANI
+    /* Without SPX_RUNTIME_DISPATCH or USE_SHANI_SHA256, the SHA-NI kernels
+       are not built at all. */
+    if ((ebx & bit_SHA) && sse41) {
+        features |= SPX_CPU_SHANI;
+    }
+#else
+    (void)sse41;
+#endif
+    if ((ebx & bit_AVX2) && (xcr0_lo & 0x6) == 0x6) {
+        features |= SPX_CPU_AVX2;
+    }
+    if ((ebx & bit_AVX512F) && (xcr0_lo & 0xe6) == 0xe6) {
+        features |= SPX_CPU_AVX512F;
+    }
+#endif
+    return features;
+}
+
+unsigned int spx_cpu_features(void)
+{
+    if (!cpu_features_known) {
+        cpu_features = detect_cpu_features();
+        cpu_features_known = 1;
+    }
+    return cpu_features;
+}
+
+void spx_dispatch_init(void)
+{
+    unsigned int features = spx_cpu_features();
+    int x8;
+
+    if (features & SPX_CPU_AVX2) {
+        x8 = SPX_IMPL_AVX2;
+    }
+    else if (features & SPX_CPU_SHANI) {
+        x8 = SPX_IMPL_SHANI;
+    }
+    else {
+#ifdef SPX_WITH_SSE2
+        x8 = SPX_IMPL_SSE2;
+#else
+        x8 = SPX_IMPL_PORTABLE;
+#endif
+    }
+    spx_dispatch.thashx8 = x8;
+    spx_dispatch.treehash = x8;
+    spx_dispatch.chains = x8;
+    spx_dispatch.fors = x8 == SPX_IMPL_AVX2 ? SPX_IMPL_AVX2
+                                            : SPX_IMPL_PORTABLE;
+    /* The 16-lane kernels only pay off where there are enough independent
+       hashes to fill them: long runs of chains, and the bottom of the FORS
+       trees. The tree nodes stay on eight lanes. */
+    if ((features & SPX_CPU_AVX512F) && (features & SPX_CPU_AVX2)) {
+        spx_dispatch.chains = SPX_IMPL_AVX512;
+        spx_dispatch.fors = SPX_IMPL_AVX512;
+    }
+
+    /* The SHA instructions only have legacy SSE encodings, which can be very
+       slow next to the AVX2 kernels. Keep djb's code there unless the
+       benchmark finds otherwise. */
+    spx_dispatch.thash = (features & SPX_CPU_SHANI) && x8 != SPX_IMPL_AVX2
+                         ? SPX_IMPL_SHANI : SPX_IMPL_PORTABLE;
+
+#ifdef SPX_DISPATCH_BENCHMARK
+    spx_dispatch_benchmark();
+#endif
+}
+
+/* Select the kernels before main runs. */
+static void __attribute__((constructor)) dispatch_startup(void)
+{
+    spx_dispatch_init();
+}
+
+void thashx8_impl(int impl,
+                  unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  unsigned char *out4,
+                  unsigned char *out5,
+                  unsigned char *out6,
+                  unsigned char *out7,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3,
+                  const unsigned char *in4,
+                  const unsigned char *in5,
+                  const unsigned char *in6,
+                  const unsigned char *in7, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx8[8*8])
+{
+    if (impl == SPX_IMPL_AVX2) {
+        thashx8_avx2(out0, out1, out2, out3, out4, out5, out6, out7,
+                     in0, in1, in2, in3, in4, in5, in6, in7,
+                     inblocks, ctx, addrx8);
+        return;
+    }
+    /* Two passes of four lanes, with SHA-NI or SSE2. */
+    thashx4_impl(impl, out0, out1, out2, out3, in0, in1, in2, in3,
+                 inblocks, ctx, addrx8);
+    thashx4_impl(impl, out4, out5, out6, out7, in4, in5, in6, in7,
+                 inblocks, ctx, addrx8 + 4*8);
+}
+
+void thashx8_seeded_impl(int impl,
+                         unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         unsigned char *out4,
+                         unsigned char *out5,
+                         unsigned char *out6,
+                         unsigned char *out7,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3,
+                         const unsigned char *in4,
+                         const unsigned char *in5,
+                         const unsigned char *in6,
+                         const unsigned char *in7, unsigned int inblocks,
+                         const uint8_t *state_seededx8, uint32_t addrx8[8*8])
+{
+    if (impl == SPX_IMPL_AVX2) {
+        thashx8_seeded_avx2(out0, out1, out2, out3, out4, out5, out6, out7,
+                            in0, in1, in2, in3, in4, in5, in6, in7,
+                            inblocks, state_seededx8, addrx8);
+        return;
+    }
+    thashx4_seeded_impl(impl, out0, out1, out2, out3, in0, in1, in2, in3,
+                        inblocks, state_seededx8, addrx8);
+    thashx4_seeded_impl(impl, out4, out5, out6, out7, in4, in5, in6, in7,
+                        inblocks, state_seededx8 + 4*40, addrx8 + 4*8);
+}
+
+void thashx8(unsigned char *out0,
+             unsigned char *out1,
+             unsigned char *out2,
+             unsigned char *out3,
+             unsigned char *out4,
+             unsigned char *out5,
+             unsigned char *out6,
+             unsigned char *out7,
+             const unsigned char *in0,
+             const unsigned char *in1,
+             const unsigned char *in2,
+             const unsigned char *in3,
+             const unsigned char *in4,
+             const unsigned char *in5,
+             const unsigned char *in6,
+             const unsigned char *in7, unsigned int inblocks,
+             const spx_ctx *ctx, uint32_t addrx8[8*8])
+{
+    thashx8_impl(spx_dispatch.thashx8,
+                 out0, out1, out2, out3, out4, out5, out6, out7,
+                 in0, in1, in2, in3, in4, in5, in6, in7,
+                 inblocks, ctx, addrx8);
+}
+
+void thashx8_seeded(unsigned char *out0,
+                    unsigned char *out1,
+                    unsigned char *out2,
+                    unsigned char *out3,
+                    unsigned char *out4,
+                    unsigned char *out5,
+                    unsigned char *out6,
+                    unsigned char *out7,
+                    const unsigned char *in0,
+                    const unsigned char *in1,
+                    const unsigned char *in2,
+                    const unsigned char *in3,
+                    const unsigned char *in4,
+                    const unsigned char *in5,
+                    const unsigned char *in6,
+                    const unsigned char *in7, unsigned int inblocks,
+                    const uint8_t *state_seededx8, uint32_t addrx8[8*8])
+{
+    thashx8_seeded_impl(spx_dispatch.thashx8,
+                        out0, out1, out2, out3, out4, out5, out6, out7,
+                        in0, in1, in2, in3, in4, in5, in6, in7,
+                        inblocks, state_seededx8, addrx8);
+}
+
+void prf_addrx8(unsigned char *out0,
+                unsigned char *out1,
+                unsigned char *out2,
+                unsigned char *out3,
+                unsigned char *out4,
+                unsigned char *out5,
+                unsigned char *out6,
+                unsigned char *out7,
+                const unsigned char *key,
+                const uint32_t addrx8[8*8])
+{
+    if (spx_dispatch.thashx8 == SPX_IMPL_AVX2) {
+        prf_addrx8_avx2(out0, out1, out2, out3, out4, out5, out6, out7,
+                        key, addrx8);
+        return;
+    }
+    prf_addr(out0, key, addrx8 + 0*8);
+    prf_addr(out1, key, addrx8 + 1*8);
+    prf_addr(out2, key, addrx8 + 2*8);
+    prf_addr(out3, key, addrx8 + 3*8);
+    prf_addr(out4, key, addrx8 + 4*8);
+    prf_addr(out5, key, addrx8 + 5*8);
+    prf_addr(out6, key, addrx8 + 6*8);
+    prf_addr(out7, key, addrx8 + 7*8);
+}
+
+void seed_statex8(uint8_t *state_seededx8,
+                  const unsigned char *pub_seed0,
+                  const unsigned char *pub_seed1,
+                  const unsigned char *pub_seed2,
+                  const unsigned char *pub_seed3,
+                  const unsigned char *pub_seed4,
+                  const unsigned char *pub_seed5,
+                  const unsigned char *pub_seed6,
+                  const unsigned char *pub_seed7)
+{
+    const unsigned char *pub_seed[8] = {pub_seed0, pub_seed1, pub_seed2,
+                                        pub_seed3, pub_seed4, pub_seed5,
+                                        pub_seed6, pub_seed7};
+    uint8_t block[SPX_SHA256_BLOCK_BYTES] = {0};
+    unsigned int j;
+
+    if (spx_dispatch.thashx8 == SPX_IMPL_AVX2) {
+        seed_statex8_avx2(state_seededx8, pub_seed0, pub_seed1, pub_seed2,
+                          pub_seed3, pub_seed4, pub_seed5, pub_seed6,
+                          pub_seed7);
+        return;
+    }
+    for (j = 0; j < 8; j++) {
+        memcpy(block, pub_seed[j], SPX_N);
+        sha256_inc_init(state_seededx8 + 40*j);
+        sha256_inc_blocks(state_seededx8 + 40*j, block, 1);
+    }
+}
+
+/* Returns the processor time of 'calls' scalar compressions. */
+static clock_t time_thash(int impl, unsigned int calls)
+{
+    uint8_t state[40];
+    uint8_t block[SPX_SHA256_BLOCK_BYTES] = {0};
+    unsigned int i;
+    clock_t start;
+
+    sha256_inc_init(state);
+    start = clock();
+    for (i = 0; i < calls; i++) {
+        block[0] = (uint8_t)i;
+        sha256_inc_blocks_impl(impl, state, block, 1);
+    }
+    return clock() - start;
+}
+
+/* Returns the processor time of 'calls' 8-way calls with inblocks blocks. */
+static clock_t time_thashx8(int impl, unsigned int inblocks,
+                            unsigned int calls, const spx_ctx *ctx)
+{
+    unsigned char bufx8[8 * SPX_WOTS_LEN * SPX_N] = {0};
+    uint8_t state_seededx8[8 * 40];
+    uint32_t addrx8[8*8] = {0};
+    const unsigned int stride = SPX_WOTS_LEN * SPX_N;
+    unsigned int i, j;
+    clock_t start;
+
+    for (j = 0; j < 8; j++) {
+        memcpy(state_seededx8 + 40*j, ctx->state_seeded, 40);
+    }
+
+    start = clock();
+    for (i = 0; i < calls; i++) {
+        for (j = 0; j < 8; j++) {
+            addrx8[j*8 + 7] = i;
+        }
+        thashx8_seeded_impl(impl,
+                            bufx8 + 0*stride, bufx8 + 1*stride,
+                            bufx8 + 2*stride, bufx8 + 3*stride,
+                            bufx8 + 4*stride, bufx8 + 5*stride,
+                            bufx8 + 6*stride, bufx8 + 7*stride,
+                            bufx8 + 0*stride, bufx8 + 1*stride,
+                            bufx8 + 2*stride, bufx8 + 3*stride,
+                            bufx8 + 4*stride, bufx8 + 5*stride,
+                            bufx8 + 6*stride, bufx8 + 7*stride,
+                            inblocks, state_seededx8, addrx8);
+    }
+    return clock() - start;
+}
+
+/* Returns whichever of the two kernels computes thashx8 faster. */
+static int pick_thashx8(int impl0, int impl1, unsigned int inblocks,
+                        unsigned int calls, const spx_ctx *ctx)
+{
+    if (impl0 == impl1) {
+        return impl0;
+    }
+    return time_thashx8(impl1, inblocks, calls, ctx)
+           < time_thashx8(impl0, inblocks, calls, ctx) ? impl1 : impl0;
+}
+
+/* Returns the processor time of 'calls' runs of the chain kernel over a
+   full set of WOTS chains. */
+static clock_t time_chains(int impl, unsigned int calls, const spx_ctx *ctx)
+{
+    unsigned char chains[SPX_WOTS_LEN * SPX_N] = {0};
+    unsigned int start[SPX_WOTS_LEN] = {0};
+    unsigned int steps[SPX_WOTS_LEN];
+    uint32_t addr[8] = {0};
+    unsigned int i;
+    clock_t t;
+
+    /* Uneven lengths, as in a signature, so that refills are timed too. */
+    for (i = 0; i < SPX_WOTS_LEN; i++) {
+        steps[i] = (37*i) % SPX_WOTS_W;
+    }
+
+    t = clock();
+    for (i = 0; i < calls; i++) {
+        addr[5] = i;
+        wots_chains_impl(impl, chains, start, steps, SPX_WOTS_LEN,
+                         SPX_WOTS_LEN, ctx->state_seeded, addr);
+    }
+    return clock() - t;
+}
+
+/* Returns the processor time of 'calls' runs of the fused FORS kernel over
+   128 leaves. */
+static clock_t time_fors(int impl, unsigned int calls, const spx_ctx *ctx)
+{
+    unsigned char auth_path[4 * SPX_N];
+    uint32_t nodew[8 * SPX_N / 4];
+    const unsigned char sk_seed[SPX_N] = {0};
+    uint32_t tree_addr[8] = {0};
+    unsigned int i;
+    clock_t t;
+
+    t = clock();
+    for (i = 0; i < calls; i++) {
+        if (impl == SPX_IMPL_AVX512) {
+            fors_blockx16_avx512(nodew, auth_path, sk_seed, ctx, i & 127,
+                                 128*i, 0, tree_addr);
+        }
+        else {
+            fors_blockx8_avx2(nodew, auth_path, sk_seed, ctx, i & 127,
+                              128*i, 0, tree_addr);
+            fors_blockx8_avx2(nodew, auth_path, sk_seed, ctx, i & 127,
+                              128*i + 64, 0, tree_addr);
+        }
+    }
+    return clock() - t;
+}
+
+void spx_dispatch_benchmark(void)
+{
+    unsigned int features = spx_cpu_features();
+    struct spx_dispatch d = spx_dispatch;
+    unsigned char pub_seed[SPX_N] = {0};
+    spx_ctx ctx;
+#ifdef SPX_WITH_SSE2
+    int x4 = SPX_IMPL_SSE2;
+#else
+    int x4 = SPX_IMPL_PORTABLE;
+#endif
+    int x8;
+    int chain_impls[3];
+    unsigned int nchain_impls = 0;
+    clock_t t, best;
+    unsigned int i;
+
+    /* Timed on their own, the legacy-encoded SHA instructions win races that
+       they lose by far once the AVX2 kernels run around them, so they only
+       enter those where there is no AVX2, as in spx_dispatch_init. */
+    if ((features & SPX_CPU_SHANI) && !(features & SPX_CPU_AVX2)) {
+        x4 = SPX_IMPL_SHANI;
+    }
+    x8 = (features & SPX_CPU_AVX2) ? SPX_IMPL_AVX2 : x4;
+
+    d.thash = SPX_IMPL_PORTABLE;
+    if (x4 == SPX_IMPL_SHANI &&
+        time_thash(SPX_IMPL_SHANI, 4096)
+        < time_thash(SPX_IMPL_PORTABLE, 4096)) {
+        d.thash = SPX_IMPL_SHANI;
+    }
+
+    initialize_hash_function(&ctx, pub_seed, NULL);
+
+    /* Leaves compress a whole WOTS public key, tree nodes hash two nodes. */
+    d.thashx8 = pick_thashx8(x4, x8, SPX_WOTS_LEN, 64, &ctx);
+    d.treehash = pick_thashx8(x4, x8, 2, 512, &ctx);
+
+    /* The chains one at a time, on the scalar kernel that spx_dispatch
+       already holds, against every chain kernel. */
+#ifdef SPX_WITH_SSE2
+    chain_impls[nchain_impls++] = SPX_IMPL_SSE2;
+#endif
+    if (features & SPX_CPU_AVX2) {
+        chain_impls[nchain_impls++] = SPX_IMPL_AVX2;
+        if (features & SPX_CPU_AVX512F) {
+            chain_impls[nchain_impls++] = SPX_IMPL_AVX512;
+        }
+    }
+    d.chains = SPX_IMPL_PORTABLE;
+    best = time_chains(SPX_IMPL_PORTABLE, 16, &ctx);
+    for (i = 0; i < nchain_impls; i++) {
+        t = time_chains(chain_impls[i], 16, &ctx);
+        if (t < best) {
+            d.chains = chain_impls[i];
+            best = t;
+        }
+    }
+
+    /* The fused FORS kernels build on the AVX2 tree nodes. */
+    d.fors = d.treehash == SPX_IMPL_AVX2 ? SPX_IMPL_AVX2 : SPX_IMPL_PORTABLE;
+    if (d.treehash == SPX_IMPL_AVX2 && (features & SPX_CPU_AVX512F) &&
+        time_fors(SPX_IMPL_AVX512, 64, &ctx)
+        < time_fors(SPX_IMPL_AVX2, 64, &ctx)) {
+        d.fors = SPX_IMPL_AVX512;
+    }
+
+    spx_dispatch = d;
+}
@@ -0,0 +1,135 @@
+#ifndef SPX_DISPATCH_H
+#define SPX_DISPATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+
+/*
+ * Runtime selection of the SHA-256 kernels. The library is built so that all
+ * kernels are present regardless of the compiler flags; cpuid decides at
+ * startup which of them may run, and which one each operation uses.
+ */
+
+/* Bits of spx_cpu_features() */
+#define SPX_CPU_AVX2    0x1
+#define SPX_CPU_SHANI   0x2
+#define SPX_CPU_AVX512F 0x4
+
+/* Kernels an operation can be dispatched to */
+#define SPX_IMPL_PORTABLE 0  /* djb's code, one hash at a time */
+#define SPX_IMPL_SHANI    1  /* Intel SHA extensions, one hash at a time */
+#define SPX_IMPL_AVX2     2  /* 8 lanes in the AVX2 registers */
+#define SPX_IMPL_AVX512   3  /* 16 lanes in the AVX-512 registers */
+#define SPX_IMPL_SSE2     4  /* 4 lanes in the SSE2 registers, x86 baseline */
+
+struct spx_dispatch {
+    int thash;     /* scalar compression: thash, prf_addr, mgf1, H_msg */
+    int thashx8;   /* 8-way leaf compression, prf_addrx8, seed_statex8 */
+    int treehash;  /* 8-way tree nodes in treehashx8 and compute_rootx8 */
+    int chains;    /* WOTS chains: AVX-512, AVX2 or SSE2 kernel, or one at a
+                      time */
+    int fors;      /* fused FORS leaves: AVX-512 or AVX2 kernel, or none */
+};
+
+extern struct spx_dispatch spx_dispatch;
+
+/* Returns the SPX_CPU_* features that the CPU and the OS support, and that
+   the build has kernels for. */
+unsigned int spx_cpu_features(void);
+
+/**
+ * Picks the kernel for every operation from the CPU features. Runs once at
+ * startup; with SPX_DISPATCH_BENCHMARK defined, spx_dispatch_benchmark()
+ * runs right after it.
+ */
+void spx_dispatch_init(void);
+
+/**
+ * Times every available kernel for every operation and keeps the fastest,
+ * overriding the choice of spx_dispatch_init. The timing leaves spx_dispatch
+ * alone; the choice is written to it once at the end, and every kernel in
+ * it, old or new, computes the same hashes.
+ */
+void spx_dispatch_benchmark(void);
+
+/* sha256_inc_blocks on the given kernel rather than spx_dispatch.thash. */
+void sha256_inc_blocks_impl(int impl, uint8_t *state, const uint8_t *in,
+                            size_t inblocks);
+
+/* thashx4 and thashx4_seeded on the SHA-NI or SSE2 kernel, or one lane at a
+   time for any other impl. Defined with or without SPX_RUNTIME_DISPATCH, as
+   thashx8_impl needs them either way. */
+void thashx4_impl(int impl,
+                  unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx4[4*8]);
+
+void thashx4_seeded_impl(int impl,
+                         unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3, unsigned int inblocks,
+                         const uint8_t *state_seededx4, uint32_t addrx4[4*8]);
+
+void thashx8_impl(int impl,
+                  unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  unsigned char *out4,
+                  unsigned char *out5,
+                  unsigned char *out6,
+                  unsigned char *out7,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3,
+                  const unsigned char *in4,
+                  const unsigned char *in5,
+                  const unsigned char *in6,
+                  const unsigned char *in7, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx8[8*8]);
+
+void thashx8_seeded_impl(int impl,
+                         unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         unsigned char *out4,
+                         unsigned char *out5,
+                         unsigned char *out6,
+                         unsigned char *out7,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3,
+                         const unsigned char *in4,
+                         const unsigned char *in5,
+                         const unsigned char *in6,
+                         const unsigned char *in7, unsigned int inblocks,
+                         const uint8_t *state_seededx8, uint32_t addrx8[8*8]);
+
+/* The WOTS chains on the AVX-512, AVX2 or SSE2 kernel, or one at a time for
+   any other impl; see wots.c. */
+void wots_chains_impl(int impl,
+                      unsigned char *chains,
+                      const unsigned int *start,
+                      const unsigned int *steps,
+                      unsigned int nchains,
+                      unsigned int chains_per_key,
+                      const uint8_t *state_seededs,
+                      const uint32_t *addrs);
+
+#endif
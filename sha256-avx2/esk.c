@@ -0,0 +1 @@
+../ref/esk.c
\ No newline at end of file
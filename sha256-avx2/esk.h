@@ -0,0 +1 @@
+../ref/esk.h
\ No newline at end of file
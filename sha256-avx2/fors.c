@@ -3,13 +3,17 @@
 #include <string.h>
 
 #include "fors.h"
+#include "forsx8.h"
 #include "utils.h"
 #include "utilsx8.h"
 #include "hash.h"
 #include "hashx8.h"
 #include "thash.h"
 #include "thashx8.h"
+#include "thashx16.h"
 #include "address.h"
+#include "dispatch.h"
+#include "sha256.h"
 
 static void fors_gen_skx8(unsigned char *sk0,
                           unsigned char *sk1,
@@ -25,13 +29,6 @@ static void fors_gen_skx8(unsigned char *sk0,
                sk_seed, fors_leaf_addrx8);
 }
 
-static void fors_sk_to_leaf(unsigned char *leaf, const unsigned char *sk,
-                            const unsigned char *pub_seed,
-                            uint32_t fors_leaf_addr[8])
-{
-    thash(leaf, sk, 1, pub_seed, fors_leaf_addr);
-}
-
 static void fors_sk_to_leafx8(unsigned char *leaf0,
                               unsigned char *leaf1,
                               unsigned char *leaf2,
@@ -48,12 +45,12 @@ static void fors_sk_to_leafx8(unsigned char *leaf0,
                               const unsigned char *sk5,
                               const unsigned char *sk6,
                               const unsigned char *sk7,
-                              const unsigned char *pub_seed,
+                              const spx_ctx *ctx,
                               uint32_t fors_leaf_addrx8[8*8])
 {
     thashx8(leaf0, leaf1, leaf2, leaf3, leaf4, leaf5, leaf6, leaf7,
             sk0, sk1, sk2, sk3, sk4, sk5, sk6, sk7,
-            1, pub_seed, fors_leaf_addrx8);
+            1, ctx, fors_leaf_addrx8);
 }
 
 static void fors_gen_leafx8(unsigned char *leaf0,
@@ -65,7 +62,7 @@ static void fors_gen_leafx8(unsigned char *leaf0,
                             unsigned char *leaf6,
                             unsigned char *leaf7,
                             const unsigned char *sk_seed,
-                            const unsigned char *pub_seed,
+                            const spx_ctx *ctx,
                             uint32_t addr_idx0,
                             uint32_t addr_idx1,
                             uint32_t addr_idx2,
@@ -98,7 +95,7 @@ static void fors_gen_leafx8(unsigned char *leaf0,
                   sk_seed, fors_leaf_addrx8);
     fors_sk_to_leafx8(leaf0, leaf1, leaf2, leaf3, leaf4, leaf5, leaf6, leaf7,
                       leaf0, leaf1, leaf2, leaf3, leaf4, leaf5, leaf6, leaf7,
-                      pub_seed, fors_leaf_addrx8);
+                      ctx, fors_leaf_addrx8);
 }
 
 /**
@@ -123,72 +120,124 @@ static void message_to_indices(uint32_t *indices, const unsigned char *m)
 /**
  * Signs a message m, deriving the secret key from sk_seed and the FTS address.
  * Assumes m contains at least SPX_FORS_HEIGHT * SPX_FORS_TREES bits.
+ *
+ * The trees are built one at a time with all eight lanes on the same tree,
+ * so that no lane does dummy work, however many trees there are.
  */
 void fors_sign(unsigned char *sig, unsigned char *pk,
                const unsigned char *m,
-               const unsigned char *sk_seed, const unsigned char *pub_seed,
+               const unsigned char *sk_seed, const spx_ctx *ctx,
                const uint32_t fors_addr[8])
 {
-    /* Round up to multiple of 4 to prevent out-of-bounds for x4 parallelism */
-    uint32_t indices[(SPX_FORS_TREES + 7) & ~7] = {0};
-    unsigned char roots[((SPX_FORS_TREES + 7) & ~7) * SPX_N];
-    /* Sign to a buffer, since we may not have a nice multiple of 4 and would
-       otherwise overrun the signature. */
-    unsigned char sigbufx8[8 * SPX_N * (1 + SPX_FORS_HEIGHT)];
-    uint32_t fors_tree_addrx8[8*8] = {0};
+    uint32_t indices[SPX_FORS_TREES];
+    unsigned char roots[SPX_FORS_TREES * SPX_N];
+    uint32_t fors_tree_addr[8] = {0};
     uint32_t fors_pk_addr[8] = {0};
-    uint32_t idx_offset[8] = {0};
-    unsigned int i, j;
-
-    for (j = 0; j < 8; j++) {
-        copy_keypair_addr(fors_tree_addrx8 + j*8, fors_addr);
-        set_type(fors_tree_addrx8 + j*8, SPX_ADDR_TYPE_FORSTREE);
-    }
+    uint32_t idx_offset;
+    unsigned int i;
 
+    copy_keypair_addr(fors_tree_addr, fors_addr);
     copy_keypair_addr(fors_pk_addr, fors_addr);
+
+    set_type(fors_tree_addr, SPX_ADDR_TYPE_FORSTREE);
     set_type(fors_pk_addr, SPX_ADDR_TYPE_FORSPK);
 
     message_to_indices(indices, m);
 
-    for (i = 0; i < ((SPX_FORS_TREES + 7) & ~0x7); i += 8) {
-        for (j = 0; j < 8; j++) {
-            if (i + j < SPX_FORS_TREES) {
-                idx_offset[j] = (i + j) * (1 << SPX_FORS_HEIGHT);
+    for (i = 0; i < SPX_FORS_TREES; i++) {
+        idx_offset = i * (1 << SPX_FORS_HEIGHT);
 
-                set_tree_height(fors_tree_addrx8 + j*8, 0);
-                set_tree_index(fors_tree_addrx8 + j*8,
-                               indices[i + j] + idx_offset[j]);
-            }
-        }
+        set_tree_height(fors_tree_addr, 0);
+        set_tree_index(fors_tree_addr, indices[i] + idx_offset);
 
-        /* Include the secret key part that produces the selected leaf nodes. */
-        fors_gen_skx8(sigbufx8 + 0*SPX_N,
-                      sigbufx8 + 1*SPX_N,
-                      sigbufx8 + 2*SPX_N,
-                      sigbufx8 + 3*SPX_N,
-                      sigbufx8 + 4*SPX_N,
-                      sigbufx8 + 5*SPX_N,
-                      sigbufx8 + 6*SPX_N,
-                      sigbufx8 + 7*SPX_N,
-                      sk_seed, fors_tree_addrx8);
-
-        treehashx8(roots + i*SPX_N, sigbufx8 + 8*SPX_N, sk_seed, pub_seed,
-                   &indices[i], idx_offset, SPX_FORS_HEIGHT, fors_gen_leafx8,
-                   fors_tree_addrx8);
+        /* Include the secret key part that produces the selected leaf node. */
+        prf_addr(sig, sk_seed, fors_tree_addr);
+        sig += SPX_N;
 
-        for (j = 0; j < 8; j++) {
-            if (i + j < SPX_FORS_TREES) {
-                memcpy(sig, sigbufx8 + j*SPX_N, SPX_N);
-                memcpy(sig + SPX_N,
-                       sigbufx8 + 8*SPX_N + j*SPX_N*SPX_FORS_HEIGHT,
-                       SPX_N*SPX_FORS_HEIGHT);
-                sig += SPX_N * (1 + SPX_FORS_HEIGHT);
-            }
+        /* Compute the authentication path for this leaf node. With AVX2,
+           the leaves and the three levels above them come from the fused
+           kernel, which keeps them in the vector registers; with AVX-512,
+           the four levels above them. */
+#if SPX_FORS_HEIGHT >= 7
+        if (spx_dispatch.fors == SPX_IMPL_AVX512 &&
+            spx_dispatch.treehash == SPX_IMPL_AVX2) {
+            treehashx8_blocks(roots + i*SPX_N, sig, sk_seed, ctx, indices[i],
+                              idx_offset, SPX_FORS_HEIGHT, 4,
+                              fors_blockx16_avx512, fors_tree_addr);
         }
+        else
+#endif
+#if SPX_FORS_HEIGHT >= 6
+        if (spx_dispatch.fors == SPX_IMPL_AVX2 &&
+            spx_dispatch.treehash == SPX_IMPL_AVX2) {
+            treehashx8_blocks(roots + i*SPX_N, sig, sk_seed, ctx, indices[i],
+                              idx_offset, SPX_FORS_HEIGHT, 3,
+                              fors_blockx8_avx2, fors_tree_addr);
+        }
+        else
+#endif
+        {
+            treehashx8_levels(roots + i*SPX_N, sig, sk_seed, ctx, indices[i],
+                              idx_offset, SPX_FORS_HEIGHT, fors_gen_leafx8,
+                              fors_tree_addr);
+        }
+        sig += SPX_N * SPX_FORS_HEIGHT;
     }
 
     /* Hash horizontally across all tree roots to derive the public key. */
-    thash(pk, roots, SPX_FORS_TREES, pub_seed, fors_pk_addr);
+    thash(pk, roots, SPX_FORS_TREES, ctx, fors_pk_addr);
+}
+
+/**
+ * Derives the roots of the trees i..i+7 of a FORS signature, whose signatures
+ * start at sig, and writes them to rootsx8. A lane j beyond the last tree
+ * climbs from the secret key and authentication path of tree i, but at index
+ * 0 of tree i + j, as indices is padded with zeros; its root is never hashed.
+ * fors_tree_addrx8 must have the type and key pair set in every lane.
+ */
+static void fors_rootsx8(unsigned char *rootsx8, const unsigned char *sig,
+                         const uint32_t *indices, unsigned int i,
+                         const spx_ctx *ctx, const uint8_t *state_seededx8,
+                         uint32_t fors_tree_addrx8[8*8])
+{
+    unsigned char leafx8[8 * SPX_N];
+    const unsigned char *sk[8];
+    const unsigned char *auth_path[8];
+    uint32_t idx_offset[8] = {0};
+    unsigned int j;
+
+    for (j = 0; j < 8; j++) {
+        if (i + j < SPX_FORS_TREES) {
+            sk[j] = sig + j * SPX_N * (1 + SPX_FORS_HEIGHT);
+        }
+        else {
+            sk[j] = sig;
+        }
+        auth_path[j] = sk[j] + SPX_N;
+        idx_offset[j] = (i + j) * (1 << SPX_FORS_HEIGHT);
+
+        set_tree_height(fors_tree_addrx8 + j*8, 0);
+        set_tree_index(fors_tree_addrx8 + j*8,
+                       indices[i + j] + idx_offset[j]);
+    }
+
+    /* Derive the leaves from the included secret key parts. */
+    fors_sk_to_leafx8(leafx8 + 0*SPX_N,
+                      leafx8 + 1*SPX_N,
+                      leafx8 + 2*SPX_N,
+                      leafx8 + 3*SPX_N,
+                      leafx8 + 4*SPX_N,
+                      leafx8 + 5*SPX_N,
+                      leafx8 + 6*SPX_N,
+                      leafx8 + 7*SPX_N,
+                      sk[0], sk[1], sk[2], sk[3],
+                      sk[4], sk[5], sk[6], sk[7],
+                      ctx, fors_tree_addrx8);
+
+    /* Derive the corresponding root nodes of these trees. */
+    compute_rootx8(rootsx8, leafx8, &indices[i], idx_offset,
+                   auth_path, SPX_FORS_HEIGHT, state_seededx8,
+                   fors_tree_addrx8);
 }
 
 /**
@@ -200,41 +249,181 @@ void fors_sign(unsigned char *sig, unsigned char *pk,
  */
 void fors_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *m,
-                      const unsigned char *pub_seed,
+                      const spx_ctx *ctx,
                       const uint32_t fors_addr[8])
 {
-    uint32_t indices[SPX_FORS_TREES];
-    unsigned char roots[SPX_FORS_TREES * SPX_N];
-    unsigned char leaf[SPX_N];
-    uint32_t fors_tree_addr[8] = {0};
+    /* Round up to multiple of 8 to prevent out-of-bounds for x8 parallelism */
+    uint32_t indices[(SPX_FORS_TREES + 7) & ~7] = {0};
+    unsigned char rootsx8[8 * SPX_N];
+    uint8_t state_seededx8[8 * 40];
+    uint32_t fors_tree_addrx8[8*8] = {0};
     uint32_t fors_pk_addr[8] = {0};
-    uint32_t idx_offset;
-    unsigned int i;
+    spx_hash_stream s;
+    unsigned int i, j;
+
+    for (j = 0; j < 8; j++) {
+        copy_keypair_addr(fors_tree_addrx8 + j*8, fors_addr);
+        set_type(fors_tree_addrx8 + j*8, SPX_ADDR_TYPE_FORSTREE);
+
+        /* All trees belong to the same key pair, so every lane shares the
+           state seeded with pub_seed. */
+        memcpy(state_seededx8 + 40*j, ctx->state_seeded, 40);
+    }
 
-    copy_keypair_addr(fors_tree_addr, fors_addr);
     copy_keypair_addr(fors_pk_addr, fors_addr);
+    set_type(fors_pk_addr, SPX_ADDR_TYPE_FORSPK);
 
-    set_type(fors_tree_addr, SPX_ADDR_TYPE_FORSTREE);
+    message_to_indices(indices, m);
+
+    /* Hash horizontally across all tree roots to derive the public key,
+       absorbing the roots eight at a time as they are known. */
+    thash_init(&s, ctx, fors_pk_addr);
+
+    /* The trees all have the same height, so climb eight of them at once. */
+    for (i = 0; i < SPX_FORS_TREES; i += 8) {
+        fors_rootsx8(rootsx8, sig + i * SPX_N * (1 + SPX_FORS_HEIGHT), indices,
+                     i, ctx, state_seededx8, fors_tree_addrx8);
+        for (j = 0; j < 8 && i + j < SPX_FORS_TREES; j++) {
+            thash_absorb(&s, rootsx8 + j*SPX_N);
+        }
+    }
+    thash_final(pk, &s);
+}
+
+/**
+ * Like fors_pk_from_sig, but reads the signature eight trees at a time with
+ * read(arg, ...). Returns -1 if it cannot be read.
+ */
+int fors_pk_from_sig_read(unsigned char *pk,
+                          spx_read_fn read, void *arg, const unsigned char *m,
+                          const spx_ctx *ctx,
+                          const uint32_t fors_addr[8])
+{
+    uint32_t indices[(SPX_FORS_TREES + 7) & ~7] = {0};
+    unsigned char rootsx8[8 * SPX_N];
+    unsigned char sigbufx8[8 * SPX_N * (1 + SPX_FORS_HEIGHT)];
+    uint8_t state_seededx8[8 * 40];
+    uint32_t fors_tree_addrx8[8*8] = {0};
+    uint32_t fors_pk_addr[8] = {0};
+    spx_hash_stream s;
+    unsigned int ntrees;
+    unsigned int i, j;
+
+    for (j = 0; j < 8; j++) {
+        copy_keypair_addr(fors_tree_addrx8 + j*8, fors_addr);
+        set_type(fors_tree_addrx8 + j*8, SPX_ADDR_TYPE_FORSTREE);
+        memcpy(state_seededx8 + 40*j, ctx->state_seeded, 40);
+    }
+
+    copy_keypair_addr(fors_pk_addr, fors_addr);
     set_type(fors_pk_addr, SPX_ADDR_TYPE_FORSPK);
 
     message_to_indices(indices, m);
 
+    thash_init(&s, ctx, fors_pk_addr);
+
+    for (i = 0; i < SPX_FORS_TREES; i += 8) {
+        ntrees = SPX_FORS_TREES - i < 8 ? SPX_FORS_TREES - i : 8;
+        if (read(arg, sigbufx8, ntrees * SPX_N * (1 + SPX_FORS_HEIGHT))) {
+            return -1;
+        }
+        fors_rootsx8(rootsx8, sigbufx8, indices, i, ctx, state_seededx8,
+                     fors_tree_addrx8);
+        for (j = 0; j < ntrees; j++) {
+            thash_absorb(&s, rootsx8 + j*SPX_N);
+        }
+    }
+    thash_final(pk, &s);
+
+    return 0;
+}
+
+/**
+ * 8-way parallel version of fors_pk_from_sig, for eight unrelated FORS
+ * signatures that may belong to different key pairs. Lane j reads its
+ * signature from sigx8[j] and its message from mx8 + j*SPX_FORS_MSG_BYTES,
+ * and uses the seeded state at state_seededx8 + 40*j (see thashx8_seeded).
+ *
+ * Writes the derived public keys to pkx8, SPX_N bytes apart.
+ */
+void fors_pk_from_sigx8(unsigned char *pkx8,
+                        const unsigned char *const sigx8[8],
+                        const unsigned char *mx8,
+                        const uint8_t *state_seededx8,
+                        const uint32_t fors_addrx8[8*8])
+{
+    uint32_t indices[8][SPX_FORS_TREES];
+    unsigned char rootsx8[8 * SPX_FORS_TREES * SPX_N];
+    unsigned char leafx8[8 * SPX_N];
+    unsigned char rootx8[8 * SPX_N];
+    const unsigned char *sk[8];
+    const unsigned char *auth_path[8];
+    uint32_t fors_tree_addrx8[8*8] = {0};
+    uint32_t fors_pk_addrx8[8*8] = {0};
+    uint32_t leaf_idx[8];
+    uint32_t idx_offset[8];
+    unsigned int i, j;
+
+    for (j = 0; j < 8; j++) {
+        copy_keypair_addr(fors_tree_addrx8 + j*8, fors_addrx8 + j*8);
+        copy_keypair_addr(fors_pk_addrx8 + j*8, fors_addrx8 + j*8);
+
+        set_type(fors_tree_addrx8 + j*8, SPX_ADDR_TYPE_FORSTREE);
+        set_type(fors_pk_addrx8 + j*8, SPX_ADDR_TYPE_FORSPK);
+
+        message_to_indices(indices[j], mx8 + j*SPX_FORS_MSG_BYTES);
+    }
+
     for (i = 0; i < SPX_FORS_TREES; i++) {
-        idx_offset = i * (1 << SPX_FORS_HEIGHT);
+        for (j = 0; j < 8; j++) {
+            leaf_idx[j] = indices[j][i];
+            idx_offset[j] = i * (1 << SPX_FORS_HEIGHT);
 
-        set_tree_height(fors_tree_addr, 0);
-        set_tree_index(fors_tree_addr, indices[i] + idx_offset);
+            set_tree_height(fors_tree_addrx8 + j*8, 0);
+            set_tree_index(fors_tree_addrx8 + j*8, leaf_idx[j] + idx_offset[j]);
 
-        /* Derive the leaf from the included secret key part. */
-        fors_sk_to_leaf(leaf, sig, pub_seed, fors_tree_addr);
-        sig += SPX_N;
+            sk[j] = sigx8[j] + i * SPX_N * (1 + SPX_FORS_HEIGHT);
+            auth_path[j] = sk[j] + SPX_N;
+        }
 
-        /* Derive the corresponding root node of this tree. */
-        compute_root(roots + i*SPX_N, leaf, indices[i], idx_offset,
-                     sig, SPX_FORS_HEIGHT, pub_seed, fors_tree_addr);
-        sig += SPX_N * SPX_FORS_HEIGHT;
+        /* Derive the leaves from the included secret key parts. */
+        thashx8_seeded(leafx8 + 0*SPX_N,
+                       leafx8 + 1*SPX_N,
+                       leafx8 + 2*SPX_N,
+                       leafx8 + 3*SPX_N,
+                       leafx8 + 4*SPX_N,
+                       leafx8 + 5*SPX_N,
+                       leafx8 + 6*SPX_N,
+                       leafx8 + 7*SPX_N,
+                       sk[0], sk[1], sk[2], sk[3], sk[4], sk[5], sk[6], sk[7],
+                       1, state_seededx8, fors_tree_addrx8);
+
+        /* Derive the corresponding root nodes of these trees. */
+        compute_rootx8(rootx8, leafx8, leaf_idx, idx_offset, auth_path,
+                       SPX_FORS_HEIGHT, state_seededx8, fors_tree_addrx8);
+
+        for (j = 0; j < 8; j++) {
+            memcpy(rootsx8 + j*SPX_FORS_TREES*SPX_N + i*SPX_N,
+                   rootx8 + j*SPX_N, SPX_N);
+        }
     }
 
-    /* Hash horizontally across all tree roots to derive the public key. */
-    thash(pk, roots, SPX_FORS_TREES, pub_seed, fors_pk_addr);
+    /* Hash horizontally across all tree roots to derive the public keys. */
+    thashx8_seeded(pkx8 + 0*SPX_N,
+                   pkx8 + 1*SPX_N,
+                   pkx8 + 2*SPX_N,
+                   pkx8 + 3*SPX_N,
+                   pkx8 + 4*SPX_N,
+                   pkx8 + 5*SPX_N,
+                   pkx8 + 6*SPX_N,
+                   pkx8 + 7*SPX_N,
+                   rootsx8 + 0*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 1*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 2*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 3*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 4*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 5*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 6*SPX_FORS_TREES*SPX_N,
+                   rootsx8 + 7*SPX_FORS_TREES*SPX_N,
+                   SPX_FORS_TREES, state_seededx8, fors_pk_addrx8);
 }
@@ -0,0 +1,22 @@
+#ifndef SPX_FORSX8_H
+#define SPX_FORSX8_H
+
+#include <stdint.h>
+
+#include "params.h"
+
+/**
+ * 8-way parallel version of fors_pk_from_sig, for eight unrelated FORS
+ * signatures that may belong to different key pairs. Lane j reads its
+ * signature from sigx8[j] and its message from mx8 + j*SPX_FORS_MSG_BYTES,
+ * and uses the seeded state at state_seededx8 + 40*j (see thashx8_seeded).
+ *
+ * Writes the derived public keys to pkx8, SPX_N bytes apart.
+ */
+void fors_pk_from_sigx8(unsigned char *pkx8,
+                        const unsigned char *const sigx8[8],
+                        const unsigned char *mx8,
+                        const uint8_t *state_seededx8,
+                        const uint32_t fors_addrx8[8*8]);
+
+#endif
@@ -1,3 +1,6 @@
+/* Always built for AVX2; only called when cpuid reports it. */
+#pragma GCC target("avx2")
+
 #include <stdint.h>
 #include <string.h>
 
@@ -12,16 +15,16 @@
 /*
  * 8-way parallel version of prf_addr; takes 8x as much input and output
  */
-void prf_addrx8(unsigned char *out0,
-                unsigned char *out1,
-                unsigned char *out2,
-                unsigned char *out3,
-                unsigned char *out4,
-                unsigned char *out5,
-                unsigned char *out6,
-                unsigned char *out7,
-                const unsigned char *key,
-                const uint32_t addrx8[8*8])
+void prf_addrx8_avx2(unsigned char *out0,
+                     unsigned char *out1,
+                     unsigned char *out2,
+                     unsigned char *out3,
+                     unsigned char *out4,
+                     unsigned char *out5,
+                     unsigned char *out6,
+                     unsigned char *out7,
+                     const unsigned char *key,
+                     const uint32_t addrx8[8*8])
 {
     unsigned char bufx8[8 * (SPX_N + SPX_SHA256_ADDR_BYTES)];
     unsigned char outbufx8[8 * SPX_SHA256_OUTPUT_BYTES];
@@ -15,4 +15,16 @@ void prf_addrx8(unsigned char *out0,
                 const unsigned char *key,
                 const uint32_t addrx8[8*8]);
 
+/* The AVX2 kernel behind prf_addrx8, see dispatch.h */
+void prf_addrx8_avx2(unsigned char *out0,
+                     unsigned char *out1,
+                     unsigned char *out2,
+                     unsigned char *out3,
+                     unsigned char *out4,
+                     unsigned char *out5,
+                     unsigned char *out6,
+                     unsigned char *out7,
+                     const unsigned char *key,
+                     const uint32_t addrx8[8*8]);
+
 #endif
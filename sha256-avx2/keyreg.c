@@ -0,0 +1 @@
+../ref/keyreg.c
\ No newline at end of file
@@ -0,0 +1 @@
+../ref/keyreg.h
\ No newline at end of file
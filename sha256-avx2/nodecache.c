@@ -0,0 +1 @@
+../ref/nodecache.c
\ No newline at end of file
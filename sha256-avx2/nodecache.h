@@ -0,0 +1 @@
+../ref/nodecache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../ref/pool.c
\ No newline at end of file
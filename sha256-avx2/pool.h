@@ -0,0 +1 @@
+../ref/pool.h
\ No newline at end of file
@@ -1,3 +1,6 @@
+/* Always built for AVX2; only called when cpuid reports it. */
+#pragma GCC target("avx2")
+
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
@@ -39,7 +42,7 @@ static uint32_t load_bigendian_32(const uint8_t *x) {
            (((uint32_t)(x[1])) << 16) | (((uint32_t)(x[0])) << 24);
 }
 
-void sha256_init_frombytes_x8(sha256ctx *ctx, uint8_t *s, unsigned long long msglen) {
+void sha256_init_frombytes_x8(sha256ctx *ctx, const uint8_t *s, unsigned long long msglen) {
     uint32_t t;
 
     for (size_t i = 0; i < 8; i++) {
@@ -51,6 +54,22 @@ void sha256_init_frombytes_x8(sha256ctx *ctx, uint8_t *s, unsigned long long msg
     ctx->msglen = msglen;
 }
 
+/* Like sha256_init_frombytes_x8, but every lane starts from its own state;
+   lane i reads its 40-byte state from s + 40*i. */
+void sha256_init_frombytes_lanes_x8(sha256ctx *ctx, const uint8_t *s, unsigned long long msglen) {
+    uint32_t t[8];
+
+    for (size_t i = 0; i < 8; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            t[j] = load_bigendian_32(s + 40*j + 4*i);
+        }
+        ctx->s[i] = _mm256_set_epi32(t[7], t[6], t[5], t[4], t[3], t[2], t[1], t[0]);
+    }
+
+    ctx->datalen = 0;
+    ctx->msglen = msglen;
+}
+
 void sha256_init8x(sha256ctx *ctx) {
     ctx->s[0] = _mm256_set_epi32(0x6a09e667,0x6a09e667,0x6a09e667,0x6a09e667,0x6a09e667,0x6a09e667,0x6a09e667,0x6a09e667);
     ctx->s[1] = _mm256_set_epi32(0xbb67ae85,0xbb67ae85,0xbb67ae85,0xbb67ae85,0xbb67ae85,0xbb67ae85,0xbb67ae85,0xbb67ae85);
@@ -159,28 +178,19 @@ void sha256_final8x(sha256ctx *ctx,
     STORE(out7, BYTESWAP(ctx->s[7]));
 }
 
-void sha256_transform8x(sha256ctx *ctx, const unsigned char *data) {
-    u256 s[8], w[64], T0, T1;
-    int i;
-
-    // Load words and transform data correctly
-    for(i = 0; i < 8; i++) {
-        w[i] = BYTESWAP(LOAD(data + 64*i));
-        w[i + 8] = BYTESWAP(LOAD(data + 32 + 64*i));
-    }
-
-    transpose(w);
-    transpose(w + 8);
+// The compression function on message words w[0..15], already transposed
+static inline void sha256_rounds8x(u256 state[8], u256 w[64]) {
+    u256 s[8], T0, T1;
 
     // Initial State
-    s[0] = ctx->s[0];
-    s[1] = ctx->s[1];
-    s[2] = ctx->s[2];
-    s[3] = ctx->s[3];
-    s[4] = ctx->s[4];
-    s[5] = ctx->s[5];
-    s[6] = ctx->s[6];
-    s[7] = ctx->s[7];
+    s[0] = state[0];
+    s[1] = state[1];
+    s[2] = state[2];
+    s[3] = state[3];
+    s[4] = state[4];
+    s[5] = state[5];
+    s[6] = state[6];
+    s[7] = state[7];
 
     SHA256ROUND_AVX(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], 0, w[0]);    
     SHA256ROUND_AVX(s[7], s[0], s[1], s[2], s[3], s[4], s[5], s[6], 1, w[1]);
@@ -296,12 +306,38 @@ void sha256_transform8x(sha256ctx *ctx, const unsigned char *data) {
     SHA256ROUND_AVX(s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[0], 63, w[63]);
 
     // Feed Forward
-    ctx->s[0] = ADD32(s[0], ctx->s[0]);
-    ctx->s[1] = ADD32(s[1], ctx->s[1]);
-    ctx->s[2] = ADD32(s[2], ctx->s[2]);
-    ctx->s[3] = ADD32(s[3], ctx->s[3]);
-    ctx->s[4] = ADD32(s[4], ctx->s[4]);
-    ctx->s[5] = ADD32(s[5], ctx->s[5]);
-    ctx->s[6] = ADD32(s[6], ctx->s[6]);
-    ctx->s[7] = ADD32(s[7], ctx->s[7]);
+    state[0] = ADD32(s[0], state[0]);
+    state[1] = ADD32(s[1], state[1]);
+    state[2] = ADD32(s[2], state[2]);
+    state[3] = ADD32(s[3], state[3]);
+    state[4] = ADD32(s[4], state[4]);
+    state[5] = ADD32(s[5], state[5]);
+    state[6] = ADD32(s[6], state[6]);
+    state[7] = ADD32(s[7], state[7]);
+}
+
+void sha256_transform8x(sha256ctx *ctx, const unsigned char *data) {
+    u256 w[64];
+    int i;
+
+    // Load words and transform data correctly
+    for(i = 0; i < 8; i++) {
+        w[i] = BYTESWAP(LOAD(data + 64*i));
+        w[i + 8] = BYTESWAP(LOAD(data + 32 + 64*i));
+    }
+
+    transpose(w);
+    transpose(w + 8);
+
+    sha256_rounds8x(ctx->s, w);
+}
+
+void sha256_compress8x_words(u256 state[8], const u256 words[16]) {
+    u256 w[64];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = words[i];
+    }
+    sha256_rounds8x(state, w);
 }
@@ -72,7 +72,8 @@ typedef struct SHA256state {
 
 
 void transpose(u256 s[8]);
-void sha256_init_frombytes_x8(sha256ctx *ctx, uint8_t *s, unsigned long long msglen);
+void sha256_init_frombytes_x8(sha256ctx *ctx, const uint8_t *s, unsigned long long msglen);
+void sha256_init_frombytes_lanes_x8(sha256ctx *ctx, const uint8_t *s, unsigned long long msglen);
 void sha256_init8x(sha256ctx *ctx);
 void sha256_update8x(sha256ctx *ctx, 
                      const unsigned char *d0,
@@ -96,5 +97,11 @@ void sha256_final8x(sha256ctx *ctx,
 
 void sha256_transform8x(sha256ctx *ctx, const unsigned char *data);
 
+/**
+ * Compresses eight blocks that are given as message words, words[i] holding
+ * word i of every lane, into state, which holds the lanes the same way.
+ */
+void sha256_compress8x_words(u256 state[8], const u256 words[16]);
+
 
 #endif
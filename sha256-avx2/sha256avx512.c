@@ -0,0 +1,84 @@
+/* Always built for AVX-512; only called when cpuid reports it. */
+#pragma GCC target("avx512f")
+
+#include <stdint.h>
+
+#include "sha256avx.h"
+#include "sha256avx512.h"
+
+#define ADD32_16 _mm512_add_epi32
+#define ROTR32_16(x, y) _mm512_ror_epi32(x, y)
+#define SHIFTR32_16(x, y) _mm512_srli_epi32(x, y)
+
+/* One vpternlogd each, rather than the two to four AND/XOR of the AVX2
+   rounds. The immediates are the truth tables over (a, b, c). */
+#define XOR3_16(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0x96)
+#define CH_16(e, f, g) _mm512_ternarylogic_epi32(e, f, g, 0xca)
+#define MAJ_16(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0xe8)
+
+#define SIGMA1_16(x) XOR3_16(ROTR32_16(x, 6), ROTR32_16(x, 11), ROTR32_16(x, 25))
+#define SIGMA0_16(x) XOR3_16(ROTR32_16(x, 2), ROTR32_16(x, 13), ROTR32_16(x, 22))
+
+#define WSIGMA1_16(x) XOR3_16(ROTR32_16(x, 17), ROTR32_16(x, 19), SHIFTR32_16(x, 10))
+#define WSIGMA0_16(x) XOR3_16(ROTR32_16(x, 7), ROTR32_16(x, 18), SHIFTR32_16(x, 3))
+
+/* The message schedule, in place in a ring of sixteen words. */
+#define SCHEDULE_16(i) \
+    w[(i) & 15] = ADD32_16(ADD32_16(WSIGMA1_16(w[((i) - 2) & 15]), \
+                                    w[((i) - 7) & 15]), \
+                           ADD32_16(WSIGMA0_16(w[((i) - 15) & 15]), \
+                                    w[(i) & 15]));
+
+#define SHA256ROUND_16(a, b, c, d, e, f, g, h, i) \
+    T0 = ADD32_16(ADD32_16(ADD32_16(h, SIGMA1_16(e)), CH_16(e, f, g)), \
+                  ADD32_16(_mm512_set1_epi32((int)RC[i]), w[(i) & 15])); \
+    d = ADD32_16(d, T0); \
+    h = ADD32_16(T0, ADD32_16(SIGMA0_16(a), MAJ_16(a, b, c)));
+
+#define SHA256ROUNDS8_16(i) \
+    SHA256ROUND_16(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], (i) + 0); \
+    SHA256ROUND_16(s[7], s[0], s[1], s[2], s[3], s[4], s[5], s[6], (i) + 1); \
+    SHA256ROUND_16(s[6], s[7], s[0], s[1], s[2], s[3], s[4], s[5], (i) + 2); \
+    SHA256ROUND_16(s[5], s[6], s[7], s[0], s[1], s[2], s[3], s[4], (i) + 3); \
+    SHA256ROUND_16(s[4], s[5], s[6], s[7], s[0], s[1], s[2], s[3], (i) + 4); \
+    SHA256ROUND_16(s[3], s[4], s[5], s[6], s[7], s[0], s[1], s[2], (i) + 5); \
+    SHA256ROUND_16(s[2], s[3], s[4], s[5], s[6], s[7], s[0], s[1], (i) + 6); \
+    SHA256ROUND_16(s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[0], (i) + 7);
+
+#define SCHEDULE8_16(i) \
+    SCHEDULE_16((i) + 0) SCHEDULE_16((i) + 1) SCHEDULE_16((i) + 2) \
+    SCHEDULE_16((i) + 3) SCHEDULE_16((i) + 4) SCHEDULE_16((i) + 5) \
+    SCHEDULE_16((i) + 6) SCHEDULE_16((i) + 7)
+
+void sha256_compress16x_words(u512 state[8], const u512 words[16])
+{
+    u512 s[8], w[16], T0;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = words[i];
+    }
+    for (i = 0; i < 8; i++) {
+        s[i] = state[i];
+    }
+
+    SHA256ROUNDS8_16(0);
+    SHA256ROUNDS8_16(8);
+    SCHEDULE8_16(16);
+    SHA256ROUNDS8_16(16);
+    SCHEDULE8_16(24);
+    SHA256ROUNDS8_16(24);
+    SCHEDULE8_16(32);
+    SHA256ROUNDS8_16(32);
+    SCHEDULE8_16(40);
+    SHA256ROUNDS8_16(40);
+    SCHEDULE8_16(48);
+    SHA256ROUNDS8_16(48);
+    SCHEDULE8_16(56);
+    SHA256ROUNDS8_16(56);
+
+    // Feed Forward
+    for (i = 0; i < 8; i++) {
+        state[i] = ADD32_16(s[i], state[i]);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef SHA256AVX512_H
+#define SHA256AVX512_H
+#include "immintrin.h"
+#include <stdint.h>
+
+#define u512 __m512i
+
+/**
+ * Compresses sixteen blocks that are given as message words, words[i]
+ * holding word i of every lane, into state, which holds the lanes the same
+ * way; the 16-lane counterpart of sha256_compress8x_words.
+ */
+void sha256_compress16x_words(u512 state[8], const u512 words[16]);
+
+#endif
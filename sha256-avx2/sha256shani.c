@@ -0,0 +1 @@
+../ref/sha256shani.c
\ No newline at end of file
@@ -0,0 +1 @@
+../ref/sha256shani.h
\ No newline at end of file
@@ -0,0 +1,152 @@
+/* SHA-256 compression on four lanes in the SSE2 registers, for x86 CPUs that
+ * have neither AVX2 nor the SHA extensions. Only built where the compiler
+ * targets SSE2, which includes every x86-64 build. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256sse2.h"
+
+#ifdef SPX_WITH_SSE2
+
+static const uint32_t RC[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ADD32_4 _mm_add_epi32
+#define XOR_4 _mm_xor_si128
+#define AND_4 _mm_and_si128
+#define OR_4 _mm_or_si128
+#define SHIFTR32_4(x, y) _mm_srli_epi32(x, y)
+/* SSE2 has no rotate, so it takes two shifts and an OR. */
+#define ROTR32_4(x, y) OR_4(_mm_srli_epi32(x, y), _mm_slli_epi32(x, 32 - (y)))
+
+#define CH_4(e, f, g) XOR_4(AND_4(e, XOR_4(f, g)), g)
+#define MAJ_4(a, b, c) OR_4(AND_4(a, OR_4(b, c)), AND_4(b, c))
+
+#define SIGMA1_4(x) XOR_4(XOR_4(ROTR32_4(x, 6), ROTR32_4(x, 11)), ROTR32_4(x, 25))
+#define SIGMA0_4(x) XOR_4(XOR_4(ROTR32_4(x, 2), ROTR32_4(x, 13)), ROTR32_4(x, 22))
+
+#define WSIGMA1_4(x) XOR_4(XOR_4(ROTR32_4(x, 17), ROTR32_4(x, 19)), SHIFTR32_4(x, 10))
+#define WSIGMA0_4(x) XOR_4(XOR_4(ROTR32_4(x, 7), ROTR32_4(x, 18)), SHIFTR32_4(x, 3))
+
+/* The message schedule, in place in a ring of sixteen words. */
+#define SCHEDULE_4(i) \
+    w[(i) & 15] = ADD32_4(ADD32_4(WSIGMA1_4(w[((i) - 2) & 15]), \
+                                  w[((i) - 7) & 15]), \
+                          ADD32_4(WSIGMA0_4(w[((i) - 15) & 15]), \
+                                  w[(i) & 15]));
+
+#define SHA256ROUND_4(a, b, c, d, e, f, g, h, i) \
+    T0 = ADD32_4(ADD32_4(ADD32_4(h, SIGMA1_4(e)), CH_4(e, f, g)), \
+                 ADD32_4(_mm_set1_epi32((int)RC[i]), w[(i) & 15])); \
+    d = ADD32_4(d, T0); \
+    h = ADD32_4(T0, ADD32_4(SIGMA0_4(a), MAJ_4(a, b, c)));
+
+#define SHA256ROUNDS8_4(i) \
+    SHA256ROUND_4(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], (i) + 0); \
+    SHA256ROUND_4(s[7], s[0], s[1], s[2], s[3], s[4], s[5], s[6], (i) + 1); \
+    SHA256ROUND_4(s[6], s[7], s[0], s[1], s[2], s[3], s[4], s[5], (i) + 2); \
+    SHA256ROUND_4(s[5], s[6], s[7], s[0], s[1], s[2], s[3], s[4], (i) + 3); \
+    SHA256ROUND_4(s[4], s[5], s[6], s[7], s[0], s[1], s[2], s[3], (i) + 4); \
+    SHA256ROUND_4(s[3], s[4], s[5], s[6], s[7], s[0], s[1], s[2], (i) + 5); \
+    SHA256ROUND_4(s[2], s[3], s[4], s[5], s[6], s[7], s[0], s[1], (i) + 6); \
+    SHA256ROUND_4(s[1], s[2], s[3], s[4], s[5], s[6], s[7], s[0], (i) + 7);
+
+#define SCHEDULE8_4(i) \
+    SCHEDULE_4((i) + 0) SCHEDULE_4((i) + 1) SCHEDULE_4((i) + 2) \
+    SCHEDULE_4((i) + 3) SCHEDULE_4((i) + 4) SCHEDULE_4((i) + 5) \
+    SCHEDULE_4((i) + 6) SCHEDULE_4((i) + 7)
+
+void sha256_sse2_compress4x_words(__m128i state[8], const __m128i words[16])
+{
+    __m128i s[8], w[16], T0;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = words[i];
+    }
+    for (i = 0; i < 8; i++) {
+        s[i] = state[i];
+    }
+
+    SHA256ROUNDS8_4(0);
+    SHA256ROUNDS8_4(8);
+    SCHEDULE8_4(16);
+    SHA256ROUNDS8_4(16);
+    SCHEDULE8_4(24);
+    SHA256ROUNDS8_4(24);
+    SCHEDULE8_4(32);
+    SHA256ROUNDS8_4(32);
+    SCHEDULE8_4(40);
+    SHA256ROUNDS8_4(40);
+    SCHEDULE8_4(48);
+    SHA256ROUNDS8_4(48);
+    SCHEDULE8_4(56);
+    SHA256ROUNDS8_4(56);
+
+    for (i = 0; i < 8; i++) {
+        state[i] = ADD32_4(s[i], state[i]);
+    }
+}
+
+static inline uint32_t load_bigendian_32(const uint8_t *x)
+{
+    return ((uint32_t)x[0] << 24) | ((uint32_t)x[1] << 16)
+           | ((uint32_t)x[2] << 8) | (uint32_t)x[3];
+}
+
+void sha256_sse2_compressx4(uint32_t statex4[4*8],
+                            const uint8_t *in0, const uint8_t *in1,
+                            const uint8_t *in2, const uint8_t *in3,
+                            size_t inblocks)
+{
+    __m128i state[8];
+    __m128i w[16];
+    uint32_t lanes[4];
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        state[i] = _mm_setr_epi32((int)statex4[i], (int)statex4[8 + i],
+                                  (int)statex4[16 + i], (int)statex4[24 + i]);
+    }
+
+    while (inblocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = _mm_setr_epi32((int)load_bigendian_32(in0 + 4*i),
+                                  (int)load_bigendian_32(in1 + 4*i),
+                                  (int)load_bigendian_32(in2 + 4*i),
+                                  (int)load_bigendian_32(in3 + 4*i));
+        }
+        sha256_sse2_compress4x_words(state, w);
+        in0 += 64;
+        in1 += 64;
+        in2 += 64;
+        in3 += 64;
+    }
+
+    for (i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *)lanes, state[i]);
+        statex4[i] = lanes[0];
+        statex4[8 + i] = lanes[1];
+        statex4[16 + i] = lanes[2];
+        statex4[24 + i] = lanes[3];
+    }
+}
+
+#endif // #ifdef SPX_WITH_SSE2
@@ -0,0 +1,33 @@
+#ifndef SPX_SHA256SSE2_H
+#define SPX_SHA256SSE2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SSE2 is part of every x86-64 CPU, so the 4-lane kernels need neither
+   compiler flags nor a cpuid check there. */
+#ifdef __SSE2__
+#define SPX_WITH_SSE2
+#include <emmintrin.h>
+
+/**
+ * Applies the SHA-256 compression function to four blocks at once, one per
+ * 32-bit lane of the SSE2 registers. state[i] holds word i of the state of
+ * every lane, and words[i] message word i of every block, already loaded
+ * big-endian.
+ */
+void sha256_sse2_compress4x_words(__m128i state[8], const __m128i words[16]);
+
+/**
+ * 4-lane version of sha256_shani_compress, for CPUs without the SHA
+ * extensions: applies the compression function to inblocks consecutive
+ * 64-byte blocks of four independent messages of equal length. Lane j keeps
+ * its state as eight native words at statex4 + 8*j.
+ */
+void sha256_sse2_compressx4(uint32_t statex4[4*8],
+                            const uint8_t *in0, const uint8_t *in1,
+                            const uint8_t *in2, const uint8_t *in3,
+                            size_t inblocks);
+#endif
+
+#endif
@@ -1,5 +1,9 @@
+/* Always built for AVX2; only called when cpuid reports it. */
+#pragma GCC target("avx2")
+
 #include <string.h>
 
+#include "params.h"
 #include "sha256x8.h"
 #include "sha256avx.h"
 #include "utils.h"
@@ -109,3 +113,46 @@ void mgf1x8(unsigned char *outx8, unsigned long outlen,
                outlen - i*SPX_SHA256_OUTPUT_BYTES);
     }
 }
+
+/**
+ * 8-way parallel version of seed_state. Rather than initializing the state
+ * of an spx_ctx, writes the state seeded with pub_seedi to state_seededx8 +
+ * 40*i, for use with thashx8_seeded.
+ */
+void seed_statex8_avx2(uint8_t *state_seededx8,
+                       const unsigned char *pub_seed0,
+                       const unsigned char *pub_seed1,
+                       const unsigned char *pub_seed2,
+                       const unsigned char *pub_seed3,
+                       const unsigned char *pub_seed4,
+                       const unsigned char *pub_seed5,
+                       const unsigned char *pub_seed6,
+                       const unsigned char *pub_seed7)
+{
+    unsigned char blockx8[8*SPX_SHA256_BLOCK_BYTES] = {0};
+    unsigned char outbufx8[8*SPX_SHA256_OUTPUT_BYTES];
+    sha256ctx ctx;
+    unsigned int j;
+
+    memcpy(blockx8 + 0*SPX_SHA256_BLOCK_BYTES, pub_seed0, SPX_N);
+    memcpy(blockx8 + 1*SPX_SHA256_BLOCK_BYTES, pub_seed1, SPX_N);
+    memcpy(blockx8 + 2*SPX_SHA256_BLOCK_BYTES, pub_seed2, SPX_N);
+    memcpy(blockx8 + 3*SPX_SHA256_BLOCK_BYTES, pub_seed3, SPX_N);
+    memcpy(blockx8 + 4*SPX_SHA256_BLOCK_BYTES, pub_seed4, SPX_N);
+    memcpy(blockx8 + 5*SPX_SHA256_BLOCK_BYTES, pub_seed5, SPX_N);
+    memcpy(blockx8 + 6*SPX_SHA256_BLOCK_BYTES, pub_seed6, SPX_N);
+    memcpy(blockx8 + 7*SPX_SHA256_BLOCK_BYTES, pub_seed7, SPX_N);
+
+    /* Absorb a single block; the chaining values are the seeded states. */
+    sha256_init8x(&ctx);
+    sha256_transform8x(&ctx, blockx8);
+    transpose(ctx.s);
+
+    for (j = 0; j < 8; j++) {
+        STORE(outbufx8 + j*SPX_SHA256_OUTPUT_BYTES, BYTESWAP(ctx.s[j]));
+        memcpy(state_seededx8 + 40*j,
+               outbufx8 + j*SPX_SHA256_OUTPUT_BYTES, SPX_SHA256_OUTPUT_BYTES);
+        /* The byte counter is stored big-endian, as in sha256_inc_blocks. */
+        ull_to_bytes(state_seededx8 + 40*j + 32, 8, SPX_SHA256_BLOCK_BYTES);
+    }
+}
@@ -1,6 +1,8 @@
 #ifndef SPX_SHA256X8_H
 #define SPX_SHA256X8_H
 
+#include <stdint.h>
+
 #define SPX_SHA256_BLOCK_BYTES 64
 #define SPX_SHA256_OUTPUT_BYTES 32  /* This does not necessarily equal SPX_N */
 
@@ -41,4 +43,30 @@ void mgf1x8(unsigned char *outx8, unsigned long outlen,
             const unsigned char *in6,
             const unsigned char *in7,
             unsigned long inlen);
+
+/**
+ * 8-way parallel version of seed_state. Rather than initializing the state
+ * of an spx_ctx, writes the state seeded with pub_seedi to state_seededx8 +
+ * 40*i, for use with thashx8_seeded.
+ */
+void seed_statex8(uint8_t *state_seededx8,
+                  const unsigned char *pub_seed0,
+                  const unsigned char *pub_seed1,
+                  const unsigned char *pub_seed2,
+                  const unsigned char *pub_seed3,
+                  const unsigned char *pub_seed4,
+                  const unsigned char *pub_seed5,
+                  const unsigned char *pub_seed6,
+                  const unsigned char *pub_seed7);
+
+/* The AVX2 kernel behind seed_statex8, see dispatch.h */
+void seed_statex8_avx2(uint8_t *state_seededx8,
+                       const unsigned char *pub_seed0,
+                       const unsigned char *pub_seed1,
+                       const unsigned char *pub_seed2,
+                       const unsigned char *pub_seed3,
+                       const unsigned char *pub_seed4,
+                       const unsigned char *pub_seed5,
+                       const unsigned char *pub_seed6,
+                       const unsigned char *pub_seed7);
 #endif
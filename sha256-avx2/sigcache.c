@@ -0,0 +1 @@
+../ref/sigcache.c
\ No newline at end of file
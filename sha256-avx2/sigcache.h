@@ -0,0 +1 @@
+../ref/sigcache.h
\ No newline at end of file
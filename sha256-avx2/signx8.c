@@ -0,0 +1,251 @@
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "signx8.h"
+#include "params.h"
+#include "wotsx8.h"
+#include "forsx8.h"
+#include "hash.h"
+#include "thashx8.h"
+#include "address.h"
+#include "utilsx8.h"
+#include "sha256x8.h"
+#include "keyreg.h"
+
+/**
+ * Fills lane j of state_seededx8 with the state seeded with the pub_seed of
+ * pk[j]. Lanes whose key is in reg copy its state; the others are seeded here.
+ */
+static void seed_lanesx8(uint8_t *state_seededx8,
+                         const uint8_t *const pk[8], spx_keyreg *reg)
+{
+    uint8_t seededx8[8 * 40];
+    const spx_ctx *ctx;
+    unsigned int j;
+    int missing = 0;
+
+    if (!reg) {
+        seed_statex8(state_seededx8, pk[0], pk[1], pk[2], pk[3],
+                     pk[4], pk[5], pk[6], pk[7]);
+        return;
+    }
+
+    for (j = 0; j < 8; j++) {
+        ctx = spx_keyreg_get(reg, pk[j]);
+        if (ctx) {
+            memcpy(state_seededx8 + 40*j, ctx->state_seeded, 40);
+        }
+        else {
+            missing |= 1 << j;
+        }
+    }
+    if (missing) {
+        seed_statex8(seededx8, pk[0], pk[1], pk[2], pk[3],
+                     pk[4], pk[5], pk[6], pk[7]);
+        for (j = 0; j < 8; j++) {
+            if (missing & (1 << j)) {
+                memcpy(state_seededx8 + 40*j, seededx8 + 40*j, 40);
+            }
+        }
+    }
+}
+
+/**
+ * Verifies eight detached signatures in lockstep; lane j checks sig[j] over
+ * m[j] under pk[j]. Assumes all eight signatures are SPX_BYTES long.
+ */
+static void verify_lanesx8(int results[8],
+                           const uint8_t *const sig[8],
+                           const uint8_t *const m[8], const size_t mlen[8],
+                           const uint8_t *const pk[8], spx_keyreg *reg)
+{
+    uint8_t state_seededx8[8 * 40];
+    unsigned char mhashx8[8 * SPX_FORS_MSG_BYTES];
+    unsigned char wots_pkx8[8 * SPX_WOTS_BYTES];
+    unsigned char rootx8[8 * SPX_N];
+    unsigned char leafx8[8 * SPX_N];
+    const unsigned char *sigp[8];
+    unsigned int i, j;
+    uint64_t tree[8];
+    uint32_t idx_leaf[8];
+    uint32_t idx_offset[8] = {0};
+    uint32_t wots_addrx8[8*8] = {0};
+    uint32_t tree_addrx8[8*8] = {0};
+    uint32_t wots_pk_addrx8[8*8] = {0};
+
+    /* Every lane has its own seeded state, so the lanes can use other keys. */
+    seed_lanesx8(state_seededx8, pk, reg);
+
+    for (j = 0; j < 8; j++) {
+        set_type(wots_addrx8 + j*8, SPX_ADDR_TYPE_WOTS);
+        set_type(tree_addrx8 + j*8, SPX_ADDR_TYPE_HASHTREE);
+        set_type(wots_pk_addrx8 + j*8, SPX_ADDR_TYPE_WOTSPK);
+
+        /* Derive the message digest and leaf index from R || PK || M. */
+        hash_message(mhashx8 + j*SPX_FORS_MSG_BYTES, &tree[j], &idx_leaf[j],
+                     sig[j], pk[j], m[j], mlen[j]);
+        sigp[j] = sig[j] + SPX_N;
+
+        /* Layer correctly defaults to 0, so no need to set_layer_addr */
+        set_tree_addr(wots_addrx8 + j*8, tree[j]);
+        set_keypair_addr(wots_addrx8 + j*8, idx_leaf[j]);
+    }
+
+    fors_pk_from_sigx8(rootx8, sigp, mhashx8, state_seededx8, wots_addrx8);
+    for (j = 0; j < 8; j++) {
+        sigp[j] += SPX_FORS_BYTES;
+    }
+
+    /* For each subtree.. */
+    for (i = 0; i < SPX_D; i++) {
+        for (j = 0; j < 8; j++) {
+            set_layer_addr(tree_addrx8 + j*8, i);
+            set_tree_addr(tree_addrx8 + j*8, tree[j]);
+
+            copy_subtree_addr(wots_addrx8 + j*8, tree_addrx8 + j*8);
+            set_keypair_addr(wots_addrx8 + j*8, idx_leaf[j]);
+
+            copy_keypair_addr(wots_pk_addrx8 + j*8, wots_addrx8 + j*8);
+        }
+
+        /* The WOTS public keys are only correct if the signatures were. */
+        wots_pk_from_sigx8(wots_pkx8, sigp, rootx8,
+                           state_seededx8, wots_addrx8);
+        for (j = 0; j < 8; j++) {
+            sigp[j] += SPX_WOTS_BYTES;
+        }
+
+        /* Compute the leaf nodes using the WOTS public keys. */
+        thashx8_seeded(leafx8 + 0*SPX_N,
+                       leafx8 + 1*SPX_N,
+                       leafx8 + 2*SPX_N,
+                       leafx8 + 3*SPX_N,
+                       leafx8 + 4*SPX_N,
+                       leafx8 + 5*SPX_N,
+                       leafx8 + 6*SPX_N,
+                       leafx8 + 7*SPX_N,
+                       wots_pkx8 + 0*SPX_WOTS_BYTES,
+                       wots_pkx8 + 1*SPX_WOTS_BYTES,
+                       wots_pkx8 + 2*SPX_WOTS_BYTES,
+                       wots_pkx8 + 3*SPX_WOTS_BYTES,
+                       wots_pkx8 + 4*SPX_WOTS_BYTES,
+                       wots_pkx8 + 5*SPX_WOTS_BYTES,
+                       wots_pkx8 + 6*SPX_WOTS_BYTES,
+                       wots_pkx8 + 7*SPX_WOTS_BYTES,
+                       SPX_WOTS_LEN, state_seededx8, wots_pk_addrx8);
+
+        /* Compute the root nodes of these subtrees. */
+        compute_rootx8(rootx8, leafx8, idx_leaf, idx_offset, sigp,
+                       SPX_TREE_HEIGHT, state_seededx8, tree_addrx8);
+
+        for (j = 0; j < 8; j++) {
+            sigp[j] += SPX_TREE_HEIGHT * SPX_N;
+
+            /* Update the indices for the next layer. */
+            idx_leaf[j] = (tree[j] & ((1 << SPX_TREE_HEIGHT)-1));
+            tree[j] = tree[j] >> SPX_TREE_HEIGHT;
+        }
+    }
+
+    /* Check if the root nodes equal the root nodes in the public keys. */
+    for (j = 0; j < 8; j++) {
+        results[j] = memcmp(rootx8 + j*SPX_N, pk[j] + SPX_N, SPX_N) ? -1 : 0;
+    }
+}
+
+/**
+ * Verifies count detached signatures, each over its own message and under
+ * its own public key, eight at a time. Takes the seeded states from reg if
+ * it is not NULL.
+ */
+static int verify_batch(const uint8_t *const sigs[], const size_t siglens[],
+                        const uint8_t *const ms[], const size_t mlens[],
+                        const uint8_t *const pks[],
+                        int results[], size_t count, spx_keyreg *reg)
+{
+    const uint8_t *sig[8];
+    const uint8_t *m[8];
+    const uint8_t *pk[8];
+    size_t mlen[8];
+    size_t lane[8];
+    int lane_results[8];
+    size_t next = 0;
+    unsigned int j, used;
+    int ret = 0;
+
+    while (next < count) {
+        /* Gather the next (up to) eight well-formed signatures. */
+        used = 0;
+        while (used < 8 && next < count) {
+            if (siglens[next] != SPX_BYTES) {
+                results[next] = -1;
+                ret = -1;
+            }
+            else {
+                lane[used] = next;
+                sig[used] = sigs[next];
+                m[used] = ms[next];
+                mlen[used] = mlens[next];
+                pk[used] = pks[next];
+                used++;
+            }
+            next++;
+        }
+        if (used == 0) {
+            break;
+        }
+
+        /* Fill the remaining lanes with copies; their results are ignored. */
+        for (j = used; j < 8; j++) {
+            sig[j] = sig[0];
+            m[j] = m[0];
+            mlen[j] = mlen[0];
+            pk[j] = pk[0];
+        }
+
+        verify_lanesx8(lane_results, sig, m, mlen, pk, reg);
+
+        for (j = 0; j < used; j++) {
+            results[lane[j]] = lane_results[j];
+            if (lane_results[j]) {
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Verifies count detached signatures, each over its own message and under
+ * its own public key. The signatures are processed eight at a time, with
+ * every lane of the 8-way hash functions following a different signature, so
+ * a single batch may freely mix signatures from different key pairs.
+ *
+ * Sets results[i] to 0 if sigs[i] is a valid signature of ms[i] under pks[i],
+ * and to -1 otherwise. Returns 0 if all signatures are valid, -1 otherwise.
+ */
+int crypto_sign_verify_batch(const uint8_t *const sigs[],
+                             const size_t siglens[],
+                             const uint8_t *const ms[], const size_t mlens[],
+                             const uint8_t *const pks[],
+                             int results[], size_t count)
+{
+    return verify_batch(sigs, siglens, ms, mlens, pks, results, count, NULL);
+}
+
+/**
+ * Like crypto_sign_verify_batch, but takes the seeded state of every key
+ * from reg, registering the keys it does not hold yet.
+ */
+int crypto_sign_verify_batch_keyreg(const uint8_t *const sigs[],
+                                    const size_t siglens[],
+                                    const uint8_t *const ms[],
+                                    const size_t mlens[],
+                                    const uint8_t *const pks[],
+                                    int results[], size_t count,
+                                    spx_keyreg *reg)
+{
+    return verify_batch(sigs, siglens, ms, mlens, pks, results, count, reg);
+}
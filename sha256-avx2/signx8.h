@@ -0,0 +1,37 @@
+#ifndef SPX_SIGNX8_H
+#define SPX_SIGNX8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "params.h"
+#include "keyreg.h"
+
+/**
+ * Verifies count detached signatures, each over its own message and under
+ * its own public key. The signatures are processed eight at a time, with
+ * every lane of the 8-way hash functions following a different signature, so
+ * a single batch may freely mix signatures from different key pairs.
+ *
+ * Sets results[i] to 0 if sigs[i] is a valid signature of ms[i] under pks[i],
+ * and to -1 otherwise. Returns 0 if all signatures are valid, -1 otherwise.
+ */
+int crypto_sign_verify_batch(const uint8_t *const sigs[],
+                             const size_t siglens[],
+                             const uint8_t *const ms[], const size_t mlens[],
+                             const uint8_t *const pks[],
+                             int results[], size_t count);
+
+/**
+ * Like crypto_sign_verify_batch, but takes the seeded state of every key
+ * from reg, registering the keys it does not hold yet.
+ */
+int crypto_sign_verify_batch_keyreg(const uint8_t *const sigs[],
+                                    const size_t siglens[],
+                                    const uint8_t *const ms[],
+                                    const size_t mlens[],
+                                    const uint8_t *const pks[],
+                                    int results[], size_t count,
+                                    spx_keyreg *reg);
+
+#endif
@@ -0,0 +1 @@
+../ref/sigread.h
\ No newline at end of file
@@ -0,0 +1 @@
+../ref/stream.h
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "../api.h"
+#include "../signx8.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define SPX_MLEN 32
+#define SPX_KEYS 2
+/* One full group of eight lanes and a partially filled one. */
+#define SPX_SIGNATURES 9
+
+int main()
+{
+    int ret = 0;
+    int i;
+
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char pk[SPX_KEYS][SPX_PK_BYTES];
+    unsigned char sk[SPX_KEYS][SPX_SK_BYTES];
+    unsigned char *m = malloc(SPX_SIGNATURES * (SPX_MLEN + SPX_SIGNATURES));
+    unsigned char *sig = malloc(SPX_SIGNATURES * SPX_BYTES);
+    const uint8_t *sigs[SPX_SIGNATURES];
+    const uint8_t *ms[SPX_SIGNATURES];
+    const uint8_t *pks[SPX_SIGNATURES];
+    size_t siglens[SPX_SIGNATURES];
+    size_t mlens[SPX_SIGNATURES];
+    int results[SPX_SIGNATURES];
+    spx_keyreg_entry slots[2 * SPX_KEYS];
+    spx_keyreg reg;
+
+    randombytes(m, SPX_SIGNATURES * (SPX_MLEN + SPX_SIGNATURES));
+
+    printf("Generating %d keypairs.. ", SPX_KEYS);
+    for (i = 0; i < SPX_KEYS; i++) {
+        if (crypto_sign_keypair(pk[i], sk[i])) {
+            printf("failed!\n");
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Signing %d messages of varying length.. ", SPX_SIGNATURES);
+    for (i = 0; i < SPX_SIGNATURES; i++) {
+        ms[i] = m + i * (SPX_MLEN + SPX_SIGNATURES);
+        mlens[i] = SPX_MLEN + i;
+        sigs[i] = sig + i * SPX_BYTES;
+        pks[i] = pk[i % SPX_KEYS];
+        crypto_sign_signature(sig + i * SPX_BYTES, &siglens[i],
+                              ms[i], mlens[i], sk[i % SPX_KEYS]);
+    }
+    printf("done.\n");
+
+    printf("Testing batch verification with mixed keys.. ");
+    if (crypto_sign_verify_batch(sigs, siglens, ms, mlens, pks,
+                                 results, SPX_SIGNATURES)) {
+        printf("failed!\n");
+        ret = -1;
+    }
+    else {
+        printf("successful.\n");
+    }
+
+    printf("Testing that only the invalid signatures are rejected.. ");
+    /* Flip a bit in a WOTS signature, and truncate another signature. */
+    sig[3 * SPX_BYTES + SPX_N + SPX_FORS_BYTES] ^= 1;
+    siglens[8] = SPX_BYTES - 1;
+    if (!crypto_sign_verify_batch(sigs, siglens, ms, mlens, pks,
+                                  results, SPX_SIGNATURES)) {
+        printf("failed!\n");
+        ret = -1;
+    }
+    else {
+        for (i = 0; i < SPX_SIGNATURES; i++) {
+            if (results[i] != ((i == 3 || i == 8) ? -1 : 0)) {
+                printf("failed for signature %d!\n", i);
+                ret = -1;
+                break;
+            }
+        }
+        if (i == SPX_SIGNATURES) {
+            printf("successful.\n");
+        }
+    }
+
+    printf("Testing batch verification through a key registry.. ");
+    spx_keyreg_init(&reg, slots, 2 * SPX_KEYS);
+    if (!crypto_sign_verify_batch_keyreg(sigs, siglens, ms, mlens, pks,
+                                         results, SPX_SIGNATURES, &reg)) {
+        printf("failed!\n");
+        ret = -1;
+    }
+    else {
+        for (i = 0; i < SPX_SIGNATURES; i++) {
+            if (results[i] != ((i == 3 || i == 8) ? -1 : 0) ||
+                !spx_keyreg_find(&reg, pks[i])) {
+                printf("failed for signature %d!\n", i);
+                ret = -1;
+                break;
+            }
+        }
+        if (i == SPX_SIGNATURES) {
+            printf("successful.\n");
+        }
+    }
+
+    free(m);
+    free(sig);
+
+    return ret;
+}
@@ -0,0 +1 @@
+../../ref/test/ctx.c
\ No newline at end of file
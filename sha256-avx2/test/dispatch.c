@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../api.h"
+#include "../dispatch.h"
+#include "../thashx8.h"
+#include "../thash.h"
+#include "../wots.h"
+#include "../fors.h"
+#include "../hash.h"
+#include "../hashx8.h"
+#include "../sha256x8.h"
+#include "../sha256sse2.h"
+#include "../randombytes.h"
+#include "../params.h"
+
+#define IN_BLOCKS SPX_WOTS_LEN
+
+static const char *impl_name(int impl)
+{
+    switch (impl) {
+        case SPX_IMPL_SHANI: return "shani";
+        case SPX_IMPL_AVX2: return "avx2";
+        case SPX_IMPL_AVX512: return "avx512";
+        case SPX_IMPL_SSE2: return "sse2";
+        default: return "portable";
+    }
+}
+
+/* Runs every dispatched operation with the current choice of kernels. */
+static void run_all(unsigned char *out, const unsigned char *input,
+                    const unsigned char *seeds, uint32_t addr[8*8])
+{
+    uint8_t state_seededx8[8*40];
+    uint32_t tree_addr[8];
+    spx_ctx ctx;
+    unsigned char *o;
+    const unsigned char *in = input;
+    unsigned int j;
+
+    initialize_hash_function(&ctx, seeds, NULL);
+
+    o = out;
+    for (j = 0; j < 8; j++) {
+        thash(o + j*SPX_N, in + j*SPX_N, 1, &ctx, addr + j*8);
+    }
+    o += 8*SPX_N;
+
+    thashx8(o + 0*SPX_N, o + 1*SPX_N, o + 2*SPX_N, o + 3*SPX_N,
+            o + 4*SPX_N, o + 5*SPX_N, o + 6*SPX_N, o + 7*SPX_N,
+            in + 0*IN_BLOCKS*SPX_N, in + 1*IN_BLOCKS*SPX_N,
+            in + 2*IN_BLOCKS*SPX_N, in + 3*IN_BLOCKS*SPX_N,
+            in + 4*IN_BLOCKS*SPX_N, in + 5*IN_BLOCKS*SPX_N,
+            in + 6*IN_BLOCKS*SPX_N, in + 7*IN_BLOCKS*SPX_N,
+            IN_BLOCKS, &ctx, addr);
+    o += 8*SPX_N;
+
+    /* Eight different public seeds, as in batch verification. */
+    seed_statex8(state_seededx8,
+                 seeds + 0*SPX_N, seeds + 1*SPX_N, seeds + 2*SPX_N,
+                 seeds + 3*SPX_N, seeds + 4*SPX_N, seeds + 5*SPX_N,
+                 seeds + 6*SPX_N, seeds + 7*SPX_N);
+    thashx8_seeded(o + 0*SPX_N, o + 1*SPX_N, o + 2*SPX_N, o + 3*SPX_N,
+                   o + 4*SPX_N, o + 5*SPX_N, o + 6*SPX_N, o + 7*SPX_N,
+                   in + 0*2*SPX_N, in + 1*2*SPX_N,
+                   in + 2*2*SPX_N, in + 3*2*SPX_N,
+                   in + 4*2*SPX_N, in + 5*2*SPX_N,
+                   in + 6*2*SPX_N, in + 7*2*SPX_N,
+                   2, state_seededx8, addr);
+    o += 8*SPX_N;
+
+    prf_addrx8(o + 0*SPX_N, o + 1*SPX_N, o + 2*SPX_N, o + 3*SPX_N,
+               o + 4*SPX_N, o + 5*SPX_N, o + 6*SPX_N, o + 7*SPX_N,
+               input, addr);
+    o += 8*SPX_N;
+
+    /* A whole subtree, with its nodes on the treehash kernel. */
+    memcpy(tree_addr, addr, sizeof tree_addr);
+    wots_treehash(o, o + SPX_N, seeds, &ctx, 5, tree_addr);
+    o += (1 + SPX_TREE_HEIGHT)*SPX_N;
+
+    /* A FORS signature, whose trees may take the fused leaf kernel. */
+    fors_sign(o, o + SPX_FORS_BYTES, input, seeds, &ctx, addr);
+    o += SPX_FORS_BYTES + SPX_N;
+
+    /* A WOTS signature, whose chains all have different lengths. */
+    wots_sign(o, input, seeds, &ctx, addr);
+}
+
+/* Returns the processor time of the fastest of three signatures. */
+static clock_t time_sign(const unsigned char *sk)
+{
+    static unsigned char sig[SPX_BYTES];
+    const unsigned char m[SPX_N] = {0};
+    size_t siglen;
+    clock_t t, best = 0;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        t = clock();
+        crypto_sign_signature(sig, &siglen, m, sizeof m, sk);
+        t = clock() - t;
+        if (i == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    static unsigned char input[8*IN_BLOCKS*SPX_N];
+    unsigned char seeds[8*SPX_N];
+    static unsigned char expected[4*8*SPX_N + (1 + SPX_TREE_HEIGHT)*SPX_N
+                                  + SPX_FORS_BYTES + SPX_N + SPX_WOTS_BYTES];
+    static unsigned char output[4*8*SPX_N + (1 + SPX_TREE_HEIGHT)*SPX_N
+                                + SPX_FORS_BYTES + SPX_N + SPX_WOTS_BYTES];
+    uint32_t addr[8*8];
+    unsigned char pk[SPX_PK_BYTES];
+    unsigned char sk[SPX_SK_BYTES];
+    clock_t static_time, benchmarked_time;
+    unsigned int features = spx_cpu_features();
+    struct spx_dispatch saved = spx_dispatch;
+    int impls[5];
+    int n = 0;
+    int i;
+    int ret = 0;
+
+    randombytes(seeds, sizeof seeds);
+    randombytes(input, sizeof input);
+    randombytes((unsigned char *)addr, sizeof addr);
+
+    printf("CPU features:%s%s%s\n",
+           (features & SPX_CPU_AVX2) ? " avx2" : "",
+           (features & SPX_CPU_SHANI) ? " shani" : "",
+           (features & SPX_CPU_AVX512F) ? " avx512f" : "");
+    printf("Static choice: thash %s, thashx8 %s, treehash %s, chains %s, "
+           "fors %s\n",
+           impl_name(spx_dispatch.thash), impl_name(spx_dispatch.thashx8),
+           impl_name(spx_dispatch.treehash), impl_name(spx_dispatch.chains),
+           impl_name(spx_dispatch.fors));
+
+    impls[n++] = SPX_IMPL_PORTABLE;
+#ifdef SPX_WITH_SSE2
+    impls[n++] = SPX_IMPL_SSE2;
+#endif
+    if (features & SPX_CPU_SHANI) {
+        impls[n++] = SPX_IMPL_SHANI;
+    }
+    if (features & SPX_CPU_AVX2) {
+        impls[n++] = SPX_IMPL_AVX2;
+    }
+    if ((features & SPX_CPU_AVX2) && (features & SPX_CPU_AVX512F)) {
+        impls[n++] = SPX_IMPL_AVX512;
+    }
+
+    for (i = 0; i < n; i++) {
+        printf("Testing if the %s kernels match the portable code.. ",
+               impl_name(impls[i]));
+        /* The scalar thash only has a portable and a SHA-NI kernel, and
+           the AVX-512 kernels only cover the chains and the FORS leaves. */
+        spx_dispatch.thash = impls[i] == SPX_IMPL_SHANI ? SPX_IMPL_SHANI
+                                                        : SPX_IMPL_PORTABLE;
+        spx_dispatch.thashx8 =
+            impls[i] == SPX_IMPL_AVX512 ? SPX_IMPL_AVX2 : impls[i];
+        spx_dispatch.treehash = spx_dispatch.thashx8;
+        spx_dispatch.chains = impls[i];
+        spx_dispatch.fors = impls[i] == SPX_IMPL_AVX2 ||
+                            impls[i] == SPX_IMPL_AVX512 ? impls[i]
+                                                        : SPX_IMPL_PORTABLE;
+
+        run_all(i == 0 ? expected : output, input, seeds, addr);
+        if (i > 0 && memcmp(expected, output, sizeof output)) {
+            printf("failed!\n");
+            ret = -1;
+        }
+        else {
+            printf("successful.\n");
+        }
+    }
+
+    spx_dispatch = saved;
+    crypto_sign_keypair(pk, sk);
+    static_time = time_sign(sk);
+
+    spx_dispatch_benchmark();
+    printf("Benchmarked choice: thash %s, thashx8 %s, treehash %s, "
+           "chains %s, fors %s\n",
+           impl_name(spx_dispatch.thash), impl_name(spx_dispatch.thashx8),
+           impl_name(spx_dispatch.treehash), impl_name(spx_dispatch.chains),
+           impl_name(spx_dispatch.fors));
+
+    printf("Testing if the benchmarked kernels match the portable code.. ");
+    run_all(output, input, seeds, addr);
+    if (memcmp(expected, output, sizeof output)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    /* Only reported: a loaded machine makes either of them slow. */
+    benchmarked_time = time_sign(sk);
+    printf("Signing takes %.1f ms with the static choice and %.1f ms with "
+           "the benchmarked one.\n",
+           static_time * 1000.0 / CLOCKS_PER_SEC,
+           benchmarked_time * 1000.0 / CLOCKS_PER_SEC);
+
+    return ret;
+}
@@ -0,0 +1 @@
+../../ref/test/esk.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../ref/test/keyreg.c
\ No newline at end of file
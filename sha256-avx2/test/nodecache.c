@@ -0,0 +1 @@
+../../ref/test/nodecache.c
\ No newline at end of file
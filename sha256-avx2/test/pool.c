@@ -0,0 +1 @@
+../../ref/test/pool.c
\ No newline at end of file
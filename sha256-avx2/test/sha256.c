@@ -0,0 +1 @@
+../../ref/test/sha256.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../ref/test/sigcache.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../ref/test/sigread.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../ref/test/stream.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../ref/test/thash.c
\ No newline at end of file
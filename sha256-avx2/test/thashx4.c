@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../thashx4.h"
+#include "../thash.h"
+#include "../hash.h"
+#include "../randombytes.h"
+#include "../params.h"
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char input[4*2*SPX_N];
+    unsigned char seed[SPX_N];
+    spx_ctx ctx;
+    unsigned char output[4*SPX_N];
+    unsigned char out4[4*SPX_N];
+    uint32_t addr[4*8] = {0};
+    unsigned int inblocks, j;
+
+    randombytes(seed, SPX_N);
+    randombytes(input, 4*2*SPX_N);
+    randombytes((unsigned char *)addr, 4 * 8 * sizeof(uint32_t));
+
+    /* thash reads the state seeded with pub_seed from ctx, so set it up first. */
+    initialize_hash_function(&ctx, seed, NULL);
+
+    printf("Testing if thash matches thashx2 and thashx4.. ");
+
+    /* One and two blocks cover the F and H tweakable hashes. */
+    for (inblocks = 1; inblocks <= 2; inblocks++) {
+        for (j = 0; j < 4; j++) {
+            thash(out4 + j * SPX_N, input + j * 2*SPX_N, inblocks,
+                  &ctx, addr + j*8);
+        }
+
+        thashx2(output + 0*SPX_N,
+                output + 1*SPX_N,
+                input + 0*2*SPX_N,
+                input + 1*2*SPX_N,
+                inblocks, &ctx, addr);
+
+        if (memcmp(out4, output, 2 * SPX_N)) {
+            printf("failed for thashx2!\n");
+            return -1;
+        }
+
+        thashx4(output + 0*SPX_N,
+                output + 1*SPX_N,
+                output + 2*SPX_N,
+                output + 3*SPX_N,
+                input + 0*2*SPX_N,
+                input + 1*2*SPX_N,
+                input + 2*2*SPX_N,
+                input + 3*2*SPX_N,
+                inblocks, &ctx, addr);
+
+        if (memcmp(out4, output, 4 * SPX_N)) {
+            printf("failed for thashx4!\n");
+            return -1;
+        }
+    }
+    printf("successful.\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../wots.h"
+#include "../wotsx8.h"
+#include "../utils.h"
+#include "../utilsx8.h"
+#include "../hash.h"
+#include "../address.h"
+#include "../randombytes.h"
+#include "../params.h"
+
+int main()
+{
+    /* Make stdout buffer more responsive. */
+    setbuf(stdout, NULL);
+
+    unsigned char seed[SPX_N];
+    unsigned char sk_seed[SPX_N];
+    spx_ctx ctx;
+    unsigned char leaves[8*SPX_N];
+    unsigned char leaves8[8*SPX_N];
+    unsigned char root[SPX_N];
+    unsigned char root8[SPX_N];
+    unsigned char auth_path[SPX_TREE_HEIGHT*SPX_N];
+    unsigned char auth_path8[SPX_TREE_HEIGHT*SPX_N];
+    uint32_t tree_addr[8] = {0};
+    /* The first and the last leaf, and some in between */
+    const uint32_t leaf_idx[] = {0, 5, 86 & ((1 << SPX_TREE_HEIGHT) - 1),
+                                (1 << SPX_TREE_HEIGHT) - 1};
+    unsigned int j;
+
+    randombytes(seed, SPX_N);
+    randombytes(sk_seed, SPX_N);
+    initialize_hash_function(&ctx, seed, NULL);
+
+    set_type(tree_addr, SPX_ADDR_TYPE_HASHTREE);
+    set_layer_addr(tree_addr, 1);
+    set_tree_addr(tree_addr, 3);
+
+    printf("Testing if wots_gen_leaf matches wots_gen_leafx8.. ");
+
+    for (j = 0; j < 8; j++) {
+        wots_gen_leaf(leaves + j*SPX_N, sk_seed, &ctx, 3*j + 1, tree_addr);
+    }
+    wots_gen_leafx8(leaves8 + 0*SPX_N,
+                    leaves8 + 1*SPX_N,
+                    leaves8 + 2*SPX_N,
+                    leaves8 + 3*SPX_N,
+                    leaves8 + 4*SPX_N,
+                    leaves8 + 5*SPX_N,
+                    leaves8 + 6*SPX_N,
+                    leaves8 + 7*SPX_N,
+                    sk_seed, &ctx, 1, 4, 7, 10, 13, 16, 19, 22, tree_addr);
+
+    if (memcmp(leaves, leaves8, 8*SPX_N)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing if treehash matches wots_treehash.. ");
+
+    for (j = 0; j < sizeof leaf_idx / sizeof leaf_idx[0]; j++) {
+        treehash(root, auth_path, sk_seed, &ctx, leaf_idx[j], 0,
+                 SPX_TREE_HEIGHT, wots_gen_leaf, tree_addr);
+        wots_treehash(root8, auth_path8, sk_seed, &ctx, leaf_idx[j],
+                      tree_addr);
+        if (memcmp(root, root8, SPX_N) ||
+            memcmp(auth_path, auth_path8, SPX_TREE_HEIGHT*SPX_N)) {
+            printf("failed for leaf %u!\n", leaf_idx[j]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing if treehash matches treehashx8_levels with an offset.. ");
+
+    for (j = 0; j < sizeof leaf_idx / sizeof leaf_idx[0]; j++) {
+        treehash(root, auth_path, sk_seed, &ctx, leaf_idx[j],
+                 1 << SPX_TREE_HEIGHT, SPX_TREE_HEIGHT, wots_gen_leaf,
+                 tree_addr);
+        treehashx8_levels(root8, auth_path8, sk_seed, &ctx, leaf_idx[j],
+                          1 << SPX_TREE_HEIGHT, SPX_TREE_HEIGHT,
+                          wots_gen_leafx8, tree_addr);
+        if (memcmp(root, root8, SPX_N) ||
+            memcmp(auth_path, auth_path8, SPX_TREE_HEIGHT*SPX_N)) {
+            printf("failed for leaf %u!\n", leaf_idx[j]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    return 0;
+}
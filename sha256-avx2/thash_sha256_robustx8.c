@@ -28,19 +28,17 @@ void thashx8(unsigned char *out0,
              const unsigned char *in5,
              const unsigned char *in6,
              const unsigned char *in7, unsigned int inblocks,
-             const unsigned char *pub_seed, uint32_t addrx8[8*8])
+             const spx_ctx *ctx, uint32_t addrx8[8*8])
 {
     unsigned char bufx8[8*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N)];
     unsigned char outbufx8[8*SPX_SHA256_OUTPUT_BYTES];
     unsigned char bitmaskx8[8*(inblocks * SPX_N)];
     unsigned int i;
-    sha256ctx ctx;
-
-    (void)pub_seed; /* Suppress an 'unused parameter' warning. */
+    sha256ctx sha2ctx;
 
     for (i = 0; i < 8; i++) {
         memcpy(bufx8 + i*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
-               pub_seed, SPX_N);
+               ctx->pub_seed, SPX_N);
         compress_address(bufx8 + SPX_N +
                          i*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                          addrx8 + i*8);
@@ -57,7 +55,7 @@ void thashx8(unsigned char *out0,
            bufx8 + 7*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
            SPX_N + SPX_SHA256_ADDR_BYTES);
 
-    sha256_init_frombytes_x8(&ctx, state_seeded, 512);
+    sha256_init_frombytes_x8(&sha2ctx, ctx->state_seeded, 512);
 
     for (i = 0; i < inblocks * SPX_N; i++) {
         bufx8[SPX_N + SPX_SHA256_ADDR_BYTES + i +
@@ -86,7 +84,7 @@ void thashx8(unsigned char *out0,
             in7[i] ^ bitmaskx8[i + 7*(inblocks * SPX_N)];
     }
 
-    sha256_update8x(&ctx,
+    sha256_update8x(&sha2ctx,
                     bufx8 + SPX_N + 0*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     bufx8 + SPX_N + 1*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     bufx8 + SPX_N + 2*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
@@ -97,7 +95,7 @@ void thashx8(unsigned char *out0,
                     bufx8 + SPX_N + 7*(SPX_N + SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
 
-    sha256_final8x(&ctx,
+    sha256_final8x(&sha2ctx,
                    outbufx8 + 0*SPX_SHA256_OUTPUT_BYTES,
                    outbufx8 + 1*SPX_SHA256_OUTPUT_BYTES,
                    outbufx8 + 2*SPX_SHA256_OUTPUT_BYTES,
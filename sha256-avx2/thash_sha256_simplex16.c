@@ -0,0 +1,256 @@
+/* Always built for AVX-512; only called when cpuid reports it. */
+#pragma GCC target("avx512f")
+
+#include <stdint.h>
+#include <string.h>
+
+#include "address.h"
+#include "params.h"
+#include "thashx16.h"
+#include "sha256.h"
+#include "sha256avx512.h"
+
+#define LOAD16(src) _mm512_loadu_si512((const void *)(src))
+#define STORE16(dest, src) _mm512_storeu_si512((void *)(dest), src)
+#define OR16 _mm512_or_si512
+#define SHIFTL32_16(x, y) _mm512_slli_epi32(x, y)
+#define SHIFTR32_16(x, y) _mm512_srli_epi32(x, y)
+
+static inline uint32_t load_bigendian_32(const unsigned char *x)
+{
+    return ((uint32_t)x[0] << 24) | ((uint32_t)x[1] << 16)
+           | ((uint32_t)x[2] << 8) | (uint32_t)x[3];
+}
+
+/* Writes lane j of the node in v to out, in bytes. */
+static void store_lane(unsigned char *out, const u512 *v, unsigned int j)
+{
+    uint32_t lane[16];
+    unsigned int i;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE16(lane, v[i]);
+        out[4*i + 0] = (unsigned char)(lane[j] >> 24);
+        out[4*i + 1] = (unsigned char)(lane[j] >> 16);
+        out[4*i + 2] = (unsigned char)(lane[j] >> 8);
+        out[4*i + 3] = (unsigned char)lane[j];
+    }
+}
+
+/* thashx8_chain_steps_avx2 on sixteen lanes. */
+void thashx16_chain_steps_avx512(uint32_t *valuew, const uint32_t *seededw,
+                                 const uint32_t *addrw, unsigned int steps)
+{
+    u512 value[SPX_N / 4];
+    u512 seeded[8];
+    u512 hash;
+    u512 state[8];
+    u512 w[16];
+    unsigned int i, k;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        value[i] = LOAD16(valuew + 16*i);
+    }
+    for (i = 0; i < 8; i++) {
+        seeded[i] = LOAD16(seededw + 16*i);
+    }
+    for (i = 0; i < 5; i++) {
+        w[i] = LOAD16(addrw + 16*i);
+    }
+    hash = LOAD16(addrw + 16*5);
+    for (i = 6 + SPX_N / 4; i < 15; i++) {
+        w[i] = _mm512_setzero_si512();
+    }
+    w[15] = _mm512_set1_epi32(
+        (SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES + SPX_N) << 3);
+
+    for (k = 0; k < steps; k++) {
+        w[5] = OR16(hash, SHIFTR32_16(value[0], 16));
+        for (i = 1; i < SPX_N / 4; i++) {
+            w[5 + i] = OR16(SHIFTL32_16(value[i - 1], 16),
+                            SHIFTR32_16(value[i], 16));
+        }
+        w[5 + i] = OR16(SHIFTL32_16(value[i - 1], 16),
+                        _mm512_set1_epi32(0x8000));
+
+        for (i = 0; i < 8; i++) {
+            state[i] = seeded[i];
+        }
+        sha256_compress16x_words(state, w);
+        for (i = 0; i < SPX_N / 4; i++) {
+            value[i] = state[i];
+        }
+        hash = _mm512_add_epi32(hash, _mm512_set1_epi32(1 << 16));
+    }
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE16(valuew + 16*i, value[i]);
+    }
+}
+
+/* thash_wordsx8 on sixteen lanes. */
+static inline void thash_wordsx16(u512 *out, const u512 *in,
+                                  unsigned int inblocks,
+                                  const u512 seeded[8], const u512 addrw[6])
+{
+    const unsigned int inlen = SPX_SHA256_ADDR_BYTES + inblocks*SPX_N;
+    const unsigned int nblocks = (inlen + 9 + SPX_SHA256_BLOCK_BYTES - 1)
+                                 / SPX_SHA256_BLOCK_BYTES;
+    u512 state[8];
+    u512 w[2*16];
+    unsigned int i;
+
+    for (i = 0; i < 16*nblocks; i++) {
+        w[i] = _mm512_setzero_si512();
+    }
+    for (i = 0; i < 5; i++) {
+        w[i] = addrw[i];
+    }
+    w[5] = OR16(addrw[5], SHIFTR32_16(in[0], 16));
+    for (i = 1; i < inblocks*SPX_N / 4; i++) {
+        w[5 + i] = OR16(SHIFTL32_16(in[i - 1], 16), SHIFTR32_16(in[i], 16));
+    }
+    w[5 + i] = OR16(SHIFTL32_16(in[i - 1], 16), _mm512_set1_epi32(0x8000));
+    w[16*nblocks - 1] = _mm512_set1_epi32(
+        (int)((SPX_SHA256_BLOCK_BYTES + inlen) << 3));
+
+    for (i = 0; i < 8; i++) {
+        state[i] = seeded[i];
+    }
+    for (i = 0; i < nblocks; i++) {
+        sha256_compress16x_words(state, w + 16*i);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        out[i] = state[i];
+    }
+}
+
+/* addr_wordsx8 on sixteen lanes: tree index index + j in lane j. */
+static inline void addr_wordsx16(u512 addrw[6], const uint32_t addr[8],
+                                 uint32_t height, uint32_t index)
+{
+    const u512 idx = _mm512_add_epi32(_mm512_set1_epi32((int)index),
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                          8, 9, 10, 11, 12, 13, 14, 15));
+
+    addrw[0] = _mm512_set1_epi32((int)((addr[0] << 24) | (addr[2] >> 8)));
+    addrw[1] = _mm512_set1_epi32((int)((addr[2] << 24) | (addr[3] >> 8)));
+    addrw[2] = _mm512_set1_epi32((int)((addr[3] << 24)
+                                       | ((addr[4] & 0xff) << 16)
+                                       | (addr[5] >> 16)));
+    addrw[3] = _mm512_set1_epi32((int)((addr[5] << 16) | (height >> 16)));
+    addrw[4] = OR16(_mm512_set1_epi32((int)(height << 16)),
+                    SHIFTR32_16(idx, 16));
+    addrw[5] = SHIFTL32_16(idx, 16);
+}
+
+/**
+ * fors_blockx8_avx2 on sixteen lanes, for block height 4: derives the
+ * secret keys of the 128 leaves from idx on, hashes them to leaves and
+ * those four levels up, and writes the eight nodes of level 4 to nodew,
+ * transposed on eight lanes as for thashx8_h_words_avx2. The last level
+ * only fills half of the lanes.
+ */
+void fors_blockx16_avx512(uint32_t *nodew, unsigned char *auth_path,
+                          const unsigned char *sk_seed, const spx_ctx *ctx,
+                          uint32_t leaf_idx, uint32_t idx,
+                          uint32_t idx_offset, const uint32_t tree_addr[8])
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    const u512 evens = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14,
+                                         16, 18, 20, 22, 24, 26, 28, 30);
+    const u512 odds = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15,
+                                        17, 19, 21, 23, 25, 27, 29, 31);
+    u512 seeded[8];
+    u512 key[SPX_N / 4];
+    u512 addrw[6];
+    u512 state[8];
+    u512 w[16];
+    u512 pending[3][SPX_N / 4];
+    u512 pair[2*SPX_N / 4];
+    u512 node[SPX_N / 4];
+    unsigned int have[3] = {0};
+    uint32_t made[4] = {0};
+    uint32_t first, n;
+    unsigned int g, h, i;
+
+    for (i = 0; i < 8; i++) {
+        seeded[i] = _mm512_set1_epi32((int)ctx->seeded_words[i]);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        key[i] = _mm512_set1_epi32((int)load_bigendian_32(sk_seed + 4*i));
+    }
+
+    for (g = 0; g < 8; g++) {
+        first = idx + 16*g;
+        addr_wordsx16(addrw, tree_addr, 0, first + idx_offset);
+
+        /* The secret keys, as prf_addr makes them. */
+        for (i = 0; i < SPX_N / 4; i++) {
+            w[i] = key[i];
+        }
+        for (i = 0; i < 5; i++) {
+            w[SPX_N / 4 + i] = addrw[i];
+        }
+        w[SPX_N / 4 + 5] = OR16(addrw[5], _mm512_set1_epi32(0x8000));
+        for (i = SPX_N / 4 + 6; i < 15; i++) {
+            w[i] = _mm512_setzero_si512();
+        }
+        w[15] = _mm512_set1_epi32((SPX_N + SPX_SHA256_ADDR_BYTES) << 3);
+        for (i = 0; i < 8; i++) {
+            state[i] = _mm512_set1_epi32((int)iv[i]);
+        }
+        sha256_compress16x_words(state, w);
+
+        /* The leaves, under the same addresses. */
+        thash_wordsx16(node, state, 1, seeded, addrw);
+        if ((leaf_idx ^ 1) - first < 16) {
+            store_lane(auth_path, node, (leaf_idx ^ 1) - first);
+        }
+
+        /* Every two blocks of sixteen nodes make one on the next level. */
+        for (h = 0; h < 3 && have[h]; h++) {
+            for (i = 0; i < SPX_N / 4; i++) {
+                pair[i] = _mm512_permutex2var_epi32(pending[h][i], evens,
+                                                    node[i]);
+                pair[SPX_N / 4 + i] = _mm512_permutex2var_epi32(
+                    pending[h][i], odds, node[i]);
+            }
+            have[h] = 0;
+
+            first = (idx >> (h + 1)) + 16*made[h + 1];
+            made[h + 1]++;
+            addr_wordsx16(addrw, tree_addr, h + 1,
+                          first + (idx_offset >> (h + 1)));
+            thash_wordsx16(node, pair, 2, seeded, addrw);
+
+            n = ((leaf_idx >> (h + 1)) ^ 1) - first;
+            if (n < 16) {
+                store_lane(auth_path + (h + 1)*SPX_N, node, n);
+            }
+        }
+        if (h < 3) {
+            for (i = 0; i < SPX_N / 4; i++) {
+                pending[h][i] = node[i];
+            }
+            have[h] = 1;
+        }
+    }
+
+    /* Level 4 from the sixteen nodes of level 3, on the first eight lanes. */
+    for (i = 0; i < SPX_N / 4; i++) {
+        pair[i] = _mm512_permutexvar_epi32(evens, node[i]);
+        pair[SPX_N / 4 + i] = _mm512_permutexvar_epi32(odds, node[i]);
+    }
+    first = idx >> 4;
+    addr_wordsx16(addrw, tree_addr, 4, first + (idx_offset >> 4));
+    thash_wordsx16(node, pair, 2, seeded, addrw);
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        _mm256_storeu_si256((__m256i *)(nodew + 8*i),
+                            _mm512_castsi512_si256(node[i]));
+    }
+}
@@ -0,0 +1,355 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "thashx4.h"
+#include "thash.h"
+#include "address.h"
+#include "utils.h"
+#include "params.h"
+#include "sha256.h"
+#include "sha256sse2.h"
+#include "dispatch.h"
+
+#if defined(SPX_WITH_SSE2) && \
+    !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+/* If the lanes may run side by side in SSE2; the kernel starts from the
+   seeded states of djb's code. */
+#define SPX_WITH_X4_KERNEL
+#endif
+
+/**
+ * The kernel to run the lanes on when none is asked for: SHA-NI as fixed at
+ * compile time or reported by cpuid, otherwise SSE2, which every x86-64 CPU
+ * has, and one lane after the other elsewhere. With SHA-NI the lanes also
+ * run one after the other, through the scalar kernel: interleaving them
+ * gains nothing over it.
+ */
+static int x4_impl(void)
+{
+#if !defined(SPX_WITH_X4_KERNEL)
+    return SPX_IMPL_PORTABLE;
+#elif defined(USE_SHANI_SHA256)
+    return SPX_IMPL_SHANI;
+#else
+    if (spx_cpu_features() & SPX_CPU_SHANI) {
+        return SPX_IMPL_SHANI;
+    }
+#ifdef SPX_WITH_SSE2
+    return SPX_IMPL_SSE2;
+#else
+    return SPX_IMPL_PORTABLE;
+#endif
+#endif
+}
+
+#ifdef SPX_WITH_X4_KERNEL
+/**
+ * Pads the address and input of one lane into whole blocks following the
+ * block holding pub_seed, which state has absorbed.
+ * Returns the number of blocks written to buf.
+ */
+static size_t thash_pad_lane(unsigned char *buf, const unsigned char *in,
+                             unsigned int inblocks, const uint32_t addr[8],
+                             const uint8_t *state)
+{
+    const size_t inlen = SPX_SHA256_ADDR_BYTES + inblocks*SPX_N;
+    const size_t nblocks = (inlen + 9 + SPX_SHA256_BLOCK_BYTES - 1)
+                           / SPX_SHA256_BLOCK_BYTES;
+    const size_t padlen = nblocks * SPX_SHA256_BLOCK_BYTES;
+    unsigned long long bytes = bytes_to_ull(state + 32, 8) + inlen;
+
+    compress_address(buf, addr);
+    memcpy(buf + SPX_SHA256_ADDR_BYTES, in, inblocks * SPX_N);
+    buf[inlen] = 0x80;
+    memset(buf + inlen + 1, 0, padlen - 8 - inlen - 1);
+    ull_to_bytes(buf + padlen - 8, 8, bytes << 3);
+
+    return nblocks;
+}
+
+/* Loads the chaining value of a 40-byte state as native words. */
+static void thash_load_lane(uint32_t words[8], const uint8_t *state)
+{
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        words[i] = (uint32_t)bytes_to_ull(state + 4*i, 4);
+    }
+}
+
+static void thash_store_lane(unsigned char *out, const uint32_t words[8])
+{
+    unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        outbuf[4*i + 0] = (unsigned char)(words[i] >> 24);
+        outbuf[4*i + 1] = (unsigned char)(words[i] >> 16);
+        outbuf[4*i + 2] = (unsigned char)(words[i] >> 8);
+        outbuf[4*i + 3] = (unsigned char)words[i];
+    }
+    memcpy(out, outbuf, SPX_N);
+}
+
+/**
+ * Runs 2 or 4 lanes through the SSE2 kernel. Lane j starts from the seeded
+ * state[j] and uses the address at addrxn + 8*j.
+ */
+static void thashxn_kernel(unsigned char *const *out,
+                           const unsigned char *const *in,
+                           unsigned int inblocks, const uint8_t *const *state,
+                           const uint32_t *addrxn, unsigned int lanes)
+{
+    const size_t buflen = SPX_SHA256_ADDR_BYTES + inblocks*SPX_N
+                          + SPX_SHA256_BLOCK_BYTES + 8;
+    unsigned char bufxn[4 * buflen];
+    uint32_t statexn[4*8];
+    size_t nblocks = 0;
+    unsigned int j;
+
+    for (j = 0; j < lanes; j++) {
+        thash_load_lane(statexn + 8*j, state[j]);
+        nblocks = thash_pad_lane(bufxn + j*buflen, in[j], inblocks,
+                                 addrxn + 8*j, state[j]);
+    }
+    /* With two lanes, the other two redo them. */
+    for (; j < 4; j++) {
+        memcpy(statexn + 8*j, statexn + 8*(j - lanes), 8*sizeof(uint32_t));
+    }
+    sha256_sse2_compressx4(statexn, bufxn, bufxn + buflen,
+                           bufxn + (lanes - 2)*buflen,
+                           bufxn + (lanes - 1)*buflen, nblocks);
+    for (j = 0; j < lanes; j++) {
+        thash_store_lane(out[j], statexn + 8*j);
+    }
+}
+#endif // #ifdef SPX_WITH_X4_KERNEL
+
+/**
+ * 2-way parallel version of thash; takes 2x as much input and output.
+ * The lanes run side by side in SSE2 where that is the kernel, otherwise
+ * this simply calls thash for each lane.
+ */
+void thashx2(unsigned char *out0,
+             unsigned char *out1,
+             const unsigned char *in0,
+             const unsigned char *in1, unsigned int inblocks,
+             const spx_ctx *ctx, uint32_t addrx2[2*8])
+{
+#ifdef SPX_WITH_X4_KERNEL
+    if (x4_impl() == SPX_IMPL_SSE2) {
+        unsigned char *out[2] = {out0, out1};
+        const unsigned char *in[2] = {in0, in1};
+        const uint8_t *state[2] = {ctx->state_seeded, ctx->state_seeded};
+
+        thashxn_kernel(out, in, inblocks, state, addrx2, 2);
+        return;
+    }
+#endif // #ifdef SPX_WITH_X4_KERNEL
+    thash(out0, in0, inblocks, ctx, addrx2);
+    thash(out1, in1, inblocks, ctx, addrx2 + 8);
+}
+
+/* thashx4 on the kernel impl, one of the SPX_IMPL_* values. */
+static void thashx4_lanes(int impl,
+                          unsigned char *out0,
+                          unsigned char *out1,
+                          unsigned char *out2,
+                          unsigned char *out3,
+                          const unsigned char *in0,
+                          const unsigned char *in1,
+                          const unsigned char *in2,
+                          const unsigned char *in3, unsigned int inblocks,
+                          const spx_ctx *ctx, uint32_t addrx4[4*8])
+{
+#ifdef SPX_WITH_X4_KERNEL
+    if (impl == SPX_IMPL_SSE2) {
+        unsigned char *out[4] = {out0, out1, out2, out3};
+        const unsigned char *in[4] = {in0, in1, in2, in3};
+        const uint8_t *state[4] = {ctx->state_seeded, ctx->state_seeded,
+                                   ctx->state_seeded, ctx->state_seeded};
+
+        thashxn_kernel(out, in, inblocks, state, addrx4, 4);
+        return;
+    }
+#else
+    (void)impl;
+#endif // #ifdef SPX_WITH_X4_KERNEL
+    thash(out0, in0, inblocks, ctx, addrx4);
+    thash(out1, in1, inblocks, ctx, addrx4 + 8);
+    thash(out2, in2, inblocks, ctx, addrx4 + 16);
+    thash(out3, in3, inblocks, ctx, addrx4 + 24);
+}
+
+/**
+ * 4-way parallel version of thash; takes 4x as much input and output.
+ * The lanes run side by side in SSE2 where that is the kernel, otherwise
+ * this simply calls thash for each lane.
+ */
+void thashx4(unsigned char *out0,
+             unsigned char *out1,
+             unsigned char *out2,
+             unsigned char *out3,
+             const unsigned char *in0,
+             const unsigned char *in1,
+             const unsigned char *in2,
+             const unsigned char *in3, unsigned int inblocks,
+             const spx_ctx *ctx, uint32_t addrx4[4*8])
+{
+    thashx4_lanes(x4_impl(), out0, out1, out2, out3, in0, in1, in2, in3,
+                  inblocks, ctx, addrx4);
+}
+
+void thashx4_impl(int impl,
+                  unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx4[4*8])
+{
+    thashx4_lanes(impl, out0, out1, out2, out3, in0, in1, in2, in3,
+                  inblocks, ctx, addrx4);
+}
+
+#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256) // If using a SHA256 implementation from crypto_hash/sha512/ref/
+/* thash of a single lane, starting from the given seeded state. */
+static void thash_seeded_lane(unsigned char *out, const unsigned char *in,
+                              unsigned int inblocks, const uint8_t *state,
+                              const uint32_t addr[8])
+{
+    unsigned char buf[SPX_SHA256_ADDR_BYTES + inblocks*SPX_N];
+    unsigned char outbuf[SPX_SHA256_OUTPUT_BYTES];
+    uint8_t sha2_state[40];
+
+    memcpy(sha2_state, state, 40 * sizeof(uint8_t));
+    compress_address(buf, addr);
+    memcpy(buf + SPX_SHA256_ADDR_BYTES, in, inblocks * SPX_N);
+    sha256_inc_finalize(outbuf, sha2_state, buf,
+                        SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
+    memcpy(out, outbuf, SPX_N);
+}
+
+/* thashx4_seeded on the kernel impl, one of the SPX_IMPL_* values. */
+static void thashx4_seeded_lanes(int impl,
+                                 unsigned char *out0,
+                                 unsigned char *out1,
+                                 unsigned char *out2,
+                                 unsigned char *out3,
+                                 const unsigned char *in0,
+                                 const unsigned char *in1,
+                                 const unsigned char *in2,
+                                 const unsigned char *in3,
+                                 unsigned int inblocks,
+                                 const uint8_t *state_seededx4,
+                                 uint32_t addrx4[4*8])
+{
+#ifdef SPX_WITH_X4_KERNEL
+    if (impl == SPX_IMPL_SSE2) {
+        unsigned char *out[4] = {out0, out1, out2, out3};
+        const unsigned char *in[4] = {in0, in1, in2, in3};
+        const uint8_t *state[4] = {state_seededx4, state_seededx4 + 40,
+                                   state_seededx4 + 80, state_seededx4 + 120};
+
+        thashxn_kernel(out, in, inblocks, state, addrx4, 4);
+        return;
+    }
+#else
+    (void)impl;
+#endif // #ifdef SPX_WITH_X4_KERNEL
+    thash_seeded_lane(out0, in0, inblocks, state_seededx4, addrx4);
+    thash_seeded_lane(out1, in1, inblocks, state_seededx4 + 40, addrx4 + 8);
+    thash_seeded_lane(out2, in2, inblocks, state_seededx4 + 80, addrx4 + 16);
+    thash_seeded_lane(out3, in3, inblocks, state_seededx4 + 120, addrx4 + 24);
+}
+
+/**
+ * Variant of thashx4 in which every lane has its own public seed. Lane i
+ * uses the seeded state at state_seededx4 + 40*i.
+ */
+void thashx4_seeded(unsigned char *out0,
+                    unsigned char *out1,
+                    unsigned char *out2,
+                    unsigned char *out3,
+                    const unsigned char *in0,
+                    const unsigned char *in1,
+                    const unsigned char *in2,
+                    const unsigned char *in3, unsigned int inblocks,
+                    const uint8_t *state_seededx4, uint32_t addrx4[4*8])
+{
+    thashx4_seeded_lanes(x4_impl(), out0, out1, out2, out3,
+                         in0, in1, in2, in3, inblocks, state_seededx4, addrx4);
+}
+
+void thashx4_seeded_impl(int impl,
+                         unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3, unsigned int inblocks,
+                         const uint8_t *state_seededx4, uint32_t addrx4[4*8])
+{
+    thashx4_seeded_lanes(impl, out0, out1, out2, out3,
+                         in0, in1, in2, in3, inblocks, state_seededx4, addrx4);
+}
+#endif //#if !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+
+#if defined(SPX_WITH_SSE2) && \
+    !defined(USE_OPENSSL_SHA256) && !defined(USE_OPENSSL_API_SHA256)
+/* thashx8_chain_steps_avx2 on four lanes. */
+void thashx4_chain_steps_sse2(uint32_t *valuew, const uint32_t *seededw,
+                              const uint32_t *addrw, unsigned int steps)
+{
+    __m128i value[SPX_N / 4];
+    __m128i seeded[8];
+    __m128i hash;
+    __m128i state[8];
+    __m128i w[16];
+    unsigned int i, k;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        value[i] = _mm_loadu_si128((const __m128i *)(valuew + 4*i));
+    }
+    for (i = 0; i < 8; i++) {
+        seeded[i] = _mm_loadu_si128((const __m128i *)(seededw + 4*i));
+    }
+    for (i = 0; i < 5; i++) {
+        w[i] = _mm_loadu_si128((const __m128i *)(addrw + 4*i));
+    }
+    hash = _mm_loadu_si128((const __m128i *)(addrw + 4*5));
+    for (i = 6 + SPX_N / 4; i < 15; i++) {
+        w[i] = _mm_setzero_si128();
+    }
+    w[15] = _mm_set1_epi32(
+        (SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES + SPX_N) << 3);
+
+    for (k = 0; k < steps; k++) {
+        w[5] = _mm_or_si128(hash, _mm_srli_epi32(value[0], 16));
+        for (i = 1; i < SPX_N / 4; i++) {
+            w[5 + i] = _mm_or_si128(_mm_slli_epi32(value[i - 1], 16),
+                                    _mm_srli_epi32(value[i], 16));
+        }
+        w[5 + i] = _mm_or_si128(_mm_slli_epi32(value[i - 1], 16),
+                                _mm_set1_epi32(0x8000));
+
+        for (i = 0; i < 8; i++) {
+            state[i] = seeded[i];
+        }
+        sha256_sse2_compress4x_words(state, w);
+        for (i = 0; i < SPX_N / 4; i++) {
+            value[i] = state[i];
+        }
+        hash = _mm_add_epi32(hash, _mm_set1_epi32(1 << 16));
+    }
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        _mm_storeu_si128((__m128i *)(valuew + 4*i), value[i]);
+    }
+}
+#endif
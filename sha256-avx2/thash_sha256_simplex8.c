@@ -1,3 +1,6 @@
+/* Always built for AVX2; only called when cpuid reports it. */
+#pragma GCC target("avx2")
+
 #include <stdint.h>
 #include <string.h>
 
@@ -10,34 +13,31 @@
 #include "sha256avx.h"
 
 /**
- * 8-way parallel version of thash; takes 8x as much input and output
+ * Hashes the eight (address, input) pairs into a context that already holds
+ * the seeded state, and writes the eight outputs.
  */
-void thashx8(unsigned char *out0,
-             unsigned char *out1,
-             unsigned char *out2,
-             unsigned char *out3,
-             unsigned char *out4,
-             unsigned char *out5,
-             unsigned char *out6,
-             unsigned char *out7,
-             const unsigned char *in0,
-             const unsigned char *in1,
-             const unsigned char *in2,
-             const unsigned char *in3,
-             const unsigned char *in4,
-             const unsigned char *in5,
-             const unsigned char *in6,
-             const unsigned char *in7, unsigned int inblocks,
-             const unsigned char *pub_seed, uint32_t addrx8[8*8])
+static void thashx8_from_ctx(sha256ctx *ctx,
+                             unsigned char *out0,
+                             unsigned char *out1,
+                             unsigned char *out2,
+                             unsigned char *out3,
+                             unsigned char *out4,
+                             unsigned char *out5,
+                             unsigned char *out6,
+                             unsigned char *out7,
+                             const unsigned char *in0,
+                             const unsigned char *in1,
+                             const unsigned char *in2,
+                             const unsigned char *in3,
+                             const unsigned char *in4,
+                             const unsigned char *in5,
+                             const unsigned char *in6,
+                             const unsigned char *in7, unsigned int inblocks,
+                             uint32_t addrx8[8*8])
 {
     unsigned char bufx8[8*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N)];
     unsigned char outbufx8[8*SPX_SHA256_OUTPUT_BYTES];
     unsigned int i;
-    sha256ctx ctx;
-
-    (void)pub_seed; /* Suppress an 'unused parameter' warning. */
-
-    sha256_init_frombytes_x8(&ctx, state_seeded, 512);
 
     for (i = 0; i < 8; i++) {
         compress_address(bufx8 + i*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
@@ -61,7 +61,7 @@ void thashx8(unsigned char *out0,
     memcpy(bufx8 + SPX_SHA256_ADDR_BYTES +
         7*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N), in7, inblocks * SPX_N);
 
-    sha256_update8x(&ctx,
+    sha256_update8x(ctx,
                     bufx8 + 0*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     bufx8 + 1*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     bufx8 + 2*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
@@ -72,7 +72,7 @@ void thashx8(unsigned char *out0,
                     bufx8 + 7*(SPX_SHA256_ADDR_BYTES + inblocks*SPX_N),
                     SPX_SHA256_ADDR_BYTES + inblocks*SPX_N);
 
-    sha256_final8x(&ctx,
+    sha256_final8x(ctx,
                    outbufx8 + 0*SPX_SHA256_OUTPUT_BYTES,
                    outbufx8 + 1*SPX_SHA256_OUTPUT_BYTES,
                    outbufx8 + 2*SPX_SHA256_OUTPUT_BYTES,
@@ -91,3 +91,353 @@ void thashx8(unsigned char *out0,
     memcpy(out6, outbufx8 + 6*SPX_SHA256_OUTPUT_BYTES, SPX_N);
     memcpy(out7, outbufx8 + 7*SPX_SHA256_OUTPUT_BYTES, SPX_N);
 }
+
+/**
+ * 8-way parallel version of thash; takes 8x as much input and output
+ */
+void thashx8_avx2(unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  unsigned char *out4,
+                  unsigned char *out5,
+                  unsigned char *out6,
+                  unsigned char *out7,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3,
+                  const unsigned char *in4,
+                  const unsigned char *in5,
+                  const unsigned char *in6,
+                  const unsigned char *in7, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx8[8*8])
+{
+    sha256ctx sha2ctx;
+
+    sha256_init_frombytes_x8(&sha2ctx, ctx->state_seeded, 512);
+
+    thashx8_from_ctx(&sha2ctx, out0, out1, out2, out3, out4, out5, out6, out7,
+                     in0, in1, in2, in3, in4, in5, in6, in7, inblocks, addrx8);
+}
+
+/**
+ * Variant of thashx8 in which every lane has its own public seed, so that the
+ * eight lanes may belong to different key pairs. Lane i uses the seeded state
+ * at state_seededx8 + 40*i, as computed by seed_statex8.
+ */
+void thashx8_seeded_avx2(unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         unsigned char *out4,
+                         unsigned char *out5,
+                         unsigned char *out6,
+                         unsigned char *out7,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3,
+                         const unsigned char *in4,
+                         const unsigned char *in5,
+                         const unsigned char *in6,
+                         const unsigned char *in7, unsigned int inblocks,
+                         const uint8_t *state_seededx8, uint32_t addrx8[8*8])
+{
+    sha256ctx ctx;
+
+    sha256_init_frombytes_lanes_x8(&ctx, state_seededx8, 512);
+
+    thashx8_from_ctx(&ctx, out0, out1, out2, out3, out4, out5, out6, out7,
+                     in0, in1, in2, in3, in4, in5, in6, in7, inblocks, addrx8);
+}
+
+/**
+ * The AVX2 step kernel of wots_chains_impl. The lanes keep their chain values
+ * as message words in the vector registers across all steps: value[i] holds
+ * word i of every lane, and from one step to the next only the hash address
+ * changes.
+ */
+void thashx8_chain_steps_avx2(uint32_t *valuew, const uint32_t *seededw,
+                              const uint32_t *addrw, unsigned int steps)
+{
+    u256 value[SPX_N / 4];
+    u256 seeded[8];
+    u256 hash;
+    u256 state[8];
+    u256 w[16];
+    unsigned int i, k;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        value[i] = LOAD(valuew + 8*i);
+    }
+    for (i = 0; i < 8; i++) {
+        seeded[i] = LOAD(seededw + 8*i);
+    }
+    for (i = 0; i < 5; i++) {
+        w[i] = LOAD(addrw + 8*i);
+    }
+    hash = LOAD(addrw + 8*5);
+    for (i = 6 + SPX_N / 4; i < 15; i++) {
+        w[i] = _mm256_setzero_si256();
+    }
+    w[15] = _mm256_set1_epi32(
+        (SPX_SHA256_BLOCK_BYTES + SPX_SHA256_ADDR_BYTES + SPX_N) << 3);
+
+    for (k = 0; k < steps; k++) {
+        w[5] = OR(hash, SHIFTR32(value[0], 16));
+        for (i = 1; i < SPX_N / 4; i++) {
+            w[5 + i] = OR(SHIFTL32(value[i - 1], 16), SHIFTR32(value[i], 16));
+        }
+        w[5 + i] = OR(SHIFTL32(value[i - 1], 16), _mm256_set1_epi32(0x8000));
+
+        for (i = 0; i < 8; i++) {
+            state[i] = seeded[i];
+        }
+        sha256_compress8x_words(state, w);
+        for (i = 0; i < SPX_N / 4; i++) {
+            value[i] = state[i];
+        }
+        hash = ADD32(hash, _mm256_set1_epi32(1 << 16));
+    }
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE(valuew + 8*i, value[i]);
+    }
+}
+
+/**
+ * thash on eight lanes whose input blocks are already message words: in[i]
+ * holds word i of the input of every lane, and addrw the words of their
+ * compressed addresses as made by addr_wordsx8. Writes the words of the
+ * outputs to out, as in thash_fixed.
+ */
+static inline void thash_wordsx8(u256 *out, const u256 *in,
+                                 unsigned int inblocks,
+                                 const u256 seeded[8], const u256 addrw[6])
+{
+    const unsigned int inlen = SPX_SHA256_ADDR_BYTES + inblocks*SPX_N;
+    const unsigned int nblocks = (inlen + 9 + SPX_SHA256_BLOCK_BYTES - 1)
+                                 / SPX_SHA256_BLOCK_BYTES;
+    u256 state[8];
+    u256 w[2*16];
+    unsigned int i;
+
+    for (i = 0; i < 16*nblocks; i++) {
+        w[i] = _mm256_setzero_si256();
+    }
+    for (i = 0; i < 5; i++) {
+        w[i] = addrw[i];
+    }
+    w[5] = OR(addrw[5], SHIFTR32(in[0], 16));
+    for (i = 1; i < inblocks*SPX_N / 4; i++) {
+        w[5 + i] = OR(SHIFTL32(in[i - 1], 16), SHIFTR32(in[i], 16));
+    }
+    w[5 + i] = OR(SHIFTL32(in[i - 1], 16), _mm256_set1_epi32(0x8000));
+    w[16*nblocks - 1] = _mm256_set1_epi32(
+        (int)((SPX_SHA256_BLOCK_BYTES + inlen) << 3));
+
+    for (i = 0; i < 8; i++) {
+        state[i] = seeded[i];
+    }
+    for (i = 0; i < nblocks; i++) {
+        sha256_compress8x_words(state, w + 16*i);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        out[i] = state[i];
+    }
+}
+
+/**
+ * thashx8 with two input blocks, on nodes that are kept transposed: word i
+ * of the node in lane j is at node[8*i + j], and seeded holds the seeded
+ * state of every lane the same way. Lane j hashes leftw and rightw under the
+ * address addrx8 + 8*j into outw, which may equal leftw or rightw. As the
+ * children are already message words, a node costs its compressions and no
+ * byte swaps, transposes or copies.
+ */
+void thashx8_h_words_avx2(uint32_t *outw,
+                          const uint32_t *leftw,
+                          const uint32_t *rightw,
+                          const uint32_t *seeded,
+                          const uint32_t addrx8[8*8])
+{
+    uint32_t aw[6*8];
+    u256 addrw[6];
+    u256 state[8];
+    u256 in[2*SPX_N / 4];
+    u256 out[SPX_N / 4];
+    const uint32_t *addr;
+    unsigned int i, j;
+
+    /* The 22-byte compressed address, as in thash_fixed; the last two bytes
+       end up in the top half of word 5. */
+    for (j = 0; j < 8; j++) {
+        addr = addrx8 + 8*j;
+        aw[0*8 + j] = (addr[0] << 24) | (addr[2] >> 8);
+        aw[1*8 + j] = (addr[2] << 24) | (addr[3] >> 8);
+        aw[2*8 + j] = (addr[3] << 24) | ((addr[4] & 0xff) << 16)
+                      | (addr[5] >> 16);
+        aw[3*8 + j] = (addr[5] << 16) | (addr[6] >> 16);
+        aw[4*8 + j] = (addr[6] << 16) | (addr[7] >> 16);
+        aw[5*8 + j] = addr[7] << 16;
+    }
+    for (i = 0; i < 6; i++) {
+        addrw[i] = LOAD(aw + 8*i);
+    }
+    for (i = 0; i < 8; i++) {
+        state[i] = LOAD(seeded + 8*i);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        in[i] = LOAD(leftw + 8*i);
+        in[SPX_N / 4 + i] = LOAD(rightw + 8*i);
+    }
+
+    thash_wordsx8(out, in, 2, state, addrw);
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE(outw + 8*i, out[i]);
+    }
+}
+
+/**
+ * The words of the compressed address addr with tree height height and tree
+ * index index + j in lane j, as thash_wordsx8 takes them.
+ */
+static inline void addr_wordsx8(u256 addrw[6], const uint32_t addr[8],
+                                uint32_t height, uint32_t index)
+{
+    const u256 idx = ADD32(_mm256_set1_epi32((int)index),
+                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    addrw[0] = _mm256_set1_epi32((int)((addr[0] << 24) | (addr[2] >> 8)));
+    addrw[1] = _mm256_set1_epi32((int)((addr[2] << 24) | (addr[3] >> 8)));
+    addrw[2] = _mm256_set1_epi32((int)((addr[3] << 24)
+                                       | ((addr[4] & 0xff) << 16)
+                                       | (addr[5] >> 16)));
+    addrw[3] = _mm256_set1_epi32((int)((addr[5] << 16) | (height >> 16)));
+    addrw[4] = OR(_mm256_set1_epi32((int)(height << 16)), SHIFTR32(idx, 16));
+    addrw[5] = SHIFTL32(idx, 16);
+}
+
+/* Writes lane j of the node in v to out, in bytes. */
+static void store_lane(unsigned char *out, const u256 *v, unsigned int j)
+{
+    uint32_t lane[8];
+    unsigned int i;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE(lane, v[i]);
+        out[4*i + 0] = (unsigned char)(lane[j] >> 24);
+        out[4*i + 1] = (unsigned char)(lane[j] >> 16);
+        out[4*i + 2] = (unsigned char)(lane[j] >> 8);
+        out[4*i + 3] = (unsigned char)lane[j];
+    }
+}
+
+/**
+ * The AVX2 kernel for the bottom of a FORS tree, with the arguments of the
+ * gen_blockx8 of treehashx8_blocks: derives the secret keys of the 64 leaves
+ * from idx on, hashes them to leaves and those three levels up, and writes
+ * the eight nodes of level 3 to nodew, transposed. The leaves and nodes in
+ * between never leave the vector registers, other than those on the auth
+ * path of leaf_idx, which are written to auth_path. tree_addr is the FORS
+ * tree address of fors_sign.
+ */
+void fors_blockx8_avx2(uint32_t *nodew, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx, uint32_t idx_offset,
+                       const uint32_t tree_addr[8])
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    u256 seeded[8];
+    u256 key[SPX_N / 4];
+    u256 addrw[6];
+    u256 state[8];
+    u256 w[16];
+    u256 pending[3][SPX_N / 4];
+    u256 pair[2*SPX_N / 4];
+    u256 node[SPX_N / 4];
+    unsigned int have[3] = {0};
+    uint32_t made[4] = {0};
+    uint32_t first, n;
+    unsigned int g, h, i;
+
+    for (i = 0; i < 8; i++) {
+        seeded[i] = _mm256_set1_epi32((int)ctx->seeded_words[i]);
+    }
+    for (i = 0; i < SPX_N / 4; i++) {
+        key[i] = _mm256_set1_epi32((int)(
+            ((uint32_t)sk_seed[4*i] << 24) | ((uint32_t)sk_seed[4*i + 1] << 16)
+            | ((uint32_t)sk_seed[4*i + 2] << 8) | (uint32_t)sk_seed[4*i + 3]));
+    }
+
+    for (g = 0; g < 8; g++) {
+        first = idx + 8*g;
+        addr_wordsx8(addrw, tree_addr, 0, first + idx_offset);
+
+        /* The secret keys, as prf_addr makes them: the key followed by the
+           compressed address, in a single block. */
+        for (i = 0; i < SPX_N / 4; i++) {
+            w[i] = key[i];
+        }
+        for (i = 0; i < 5; i++) {
+            w[SPX_N / 4 + i] = addrw[i];
+        }
+        w[SPX_N / 4 + 5] = OR(addrw[5], _mm256_set1_epi32(0x8000));
+        for (i = SPX_N / 4 + 6; i < 15; i++) {
+            w[i] = _mm256_setzero_si256();
+        }
+        w[15] = _mm256_set1_epi32((SPX_N + SPX_SHA256_ADDR_BYTES) << 3);
+        for (i = 0; i < 8; i++) {
+            state[i] = _mm256_set1_epi32((int)iv[i]);
+        }
+        sha256_compress8x_words(state, w);
+
+        /* The leaves, under the same addresses. */
+        thash_wordsx8(node, state, 1, seeded, addrw);
+        if ((leaf_idx ^ 1) - first < 8) {
+            store_lane(auth_path, node, (leaf_idx ^ 1) - first);
+        }
+
+        /* Every two blocks of eight nodes make one on the next level. */
+        for (h = 0; h < 3 && have[h]; h++) {
+            for (i = 0; i < SPX_N / 4; i++) {
+                pair[i] = _mm256_permute4x64_epi64(_mm256_castps_si256(
+                    _mm256_shuffle_ps(_mm256_castsi256_ps(pending[h][i]),
+                                      _mm256_castsi256_ps(node[i]), 0x88)),
+                    0xd8);
+                pair[SPX_N / 4 + i] = _mm256_permute4x64_epi64(
+                    _mm256_castps_si256(
+                    _mm256_shuffle_ps(_mm256_castsi256_ps(pending[h][i]),
+                                      _mm256_castsi256_ps(node[i]), 0xdd)),
+                    0xd8);
+            }
+            have[h] = 0;
+
+            first = (idx >> (h + 1)) + 8*made[h + 1];
+            made[h + 1]++;
+            addr_wordsx8(addrw, tree_addr, h + 1,
+                         first + (idx_offset >> (h + 1)));
+            thash_wordsx8(node, pair, 2, seeded, addrw);
+
+            n = ((leaf_idx >> (h + 1)) ^ 1) - first;
+            if (h + 1 < 3 && n < 8) {
+                store_lane(auth_path + (h + 1)*SPX_N, node, n);
+            }
+        }
+        if (h < 3) {
+            for (i = 0; i < SPX_N / 4; i++) {
+                pending[h][i] = node[i];
+            }
+            have[h] = 1;
+        }
+    }
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        STORE(nodew + 8*i, node[i]);
+    }
+}
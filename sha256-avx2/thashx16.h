@@ -0,0 +1,26 @@
+#ifndef SPX_THASHX16_H
+#define SPX_THASHX16_H
+
+#include <stdint.h>
+
+#include "context.h"
+
+/* The AVX-512 kernels, see dispatch.h; they work on sixteen lanes but take
+   the arguments of their AVX2 counterparts in thashx8.h. */
+
+/**
+ * thashx8_chain_steps_avx2 on sixteen lanes.
+ */
+void thashx16_chain_steps_avx512(uint32_t *valuew, const uint32_t *seededw,
+                                 const uint32_t *addrw, unsigned int steps);
+
+/**
+ * The fused AVX-512 kernel for the bottom four levels of a FORS tree, in the
+ * form of the gen_blockx8 argument of treehashx8_blocks; see fors.c.
+ */
+void fors_blockx16_avx512(uint32_t *nodew, unsigned char *auth_path,
+                          const unsigned char *sk_seed, const spx_ctx *ctx,
+                          uint32_t leaf_idx, uint32_t idx,
+                          uint32_t idx_offset, const uint32_t tree_addr[8]);
+
+#endif
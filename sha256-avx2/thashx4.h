@@ -0,0 +1,50 @@
+#ifndef SPX_THASHX4_H
+#define SPX_THASHX4_H
+
+#include <stdint.h>
+
+#include "context.h"
+
+/**
+ * Computes thash for 2 and 4 independent inputs of inblocks n-byte blocks.
+ * Lane j uses the address at addrxn + 8*j.
+ */
+void thashx2(unsigned char *out0,
+             unsigned char *out1,
+             const unsigned char *in0,
+             const unsigned char *in1, unsigned int inblocks,
+             const spx_ctx *ctx, uint32_t addrx2[2*8]);
+
+void thashx4(unsigned char *out0,
+             unsigned char *out1,
+             unsigned char *out2,
+             unsigned char *out3,
+             const unsigned char *in0,
+             const unsigned char *in1,
+             const unsigned char *in2,
+             const unsigned char *in3, unsigned int inblocks,
+             const spx_ctx *ctx, uint32_t addrx4[4*8]);
+
+/**
+ * Variant of thashx4 in which lane i starts from the seeded state at
+ * state_seededx4 + 40*i, so the lanes may belong to different key pairs.
+ * Only available with djb's SHA256 implementation.
+ */
+void thashx4_seeded(unsigned char *out0,
+                    unsigned char *out1,
+                    unsigned char *out2,
+                    unsigned char *out3,
+                    const unsigned char *in0,
+                    const unsigned char *in1,
+                    const unsigned char *in2,
+                    const unsigned char *in3, unsigned int inblocks,
+                    const uint8_t *state_seededx4, uint32_t addrx4[4*8]);
+
+/**
+ * thashx8_chain_steps_avx2 on four lanes in the SSE2 registers, for CPUs
+ * without AVX2. Only available with SSE2 and djb's SHA256 implementation.
+ */
+void thashx4_chain_steps_sse2(uint32_t *valuew, const uint32_t *seededw,
+                              const uint32_t *addrw, unsigned int steps);
+
+#endif
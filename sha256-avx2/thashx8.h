@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "context.h"
+
 void thashx8(unsigned char *out0,
              unsigned char *out1,
              unsigned char *out2,
@@ -19,6 +21,88 @@ void thashx8(unsigned char *out0,
              const unsigned char *in5,
              const unsigned char *in6,
              const unsigned char *in7, unsigned int inblocks,
-             const unsigned char *pub_seed, uint32_t addrx8[8*8]);
+             const spx_ctx *ctx, uint32_t addrx8[8*8]);
+
+void thashx8_seeded(unsigned char *out0,
+                    unsigned char *out1,
+                    unsigned char *out2,
+                    unsigned char *out3,
+                    unsigned char *out4,
+                    unsigned char *out5,
+                    unsigned char *out6,
+                    unsigned char *out7,
+                    const unsigned char *in0,
+                    const unsigned char *in1,
+                    const unsigned char *in2,
+                    const unsigned char *in3,
+                    const unsigned char *in4,
+                    const unsigned char *in5,
+                    const unsigned char *in6,
+                    const unsigned char *in7, unsigned int inblocks,
+                    const uint8_t *state_seededx8, uint32_t addrx8[8*8]);
+
+/* The AVX2 kernels behind thashx8 and thashx8_seeded, see dispatch.h */
+void thashx8_avx2(unsigned char *out0,
+                  unsigned char *out1,
+                  unsigned char *out2,
+                  unsigned char *out3,
+                  unsigned char *out4,
+                  unsigned char *out5,
+                  unsigned char *out6,
+                  unsigned char *out7,
+                  const unsigned char *in0,
+                  const unsigned char *in1,
+                  const unsigned char *in2,
+                  const unsigned char *in3,
+                  const unsigned char *in4,
+                  const unsigned char *in5,
+                  const unsigned char *in6,
+                  const unsigned char *in7, unsigned int inblocks,
+                  const spx_ctx *ctx, uint32_t addrx8[8*8]);
+
+void thashx8_seeded_avx2(unsigned char *out0,
+                         unsigned char *out1,
+                         unsigned char *out2,
+                         unsigned char *out3,
+                         unsigned char *out4,
+                         unsigned char *out5,
+                         unsigned char *out6,
+                         unsigned char *out7,
+                         const unsigned char *in0,
+                         const unsigned char *in1,
+                         const unsigned char *in2,
+                         const unsigned char *in3,
+                         const unsigned char *in4,
+                         const unsigned char *in5,
+                         const unsigned char *in6,
+                         const unsigned char *in7, unsigned int inblocks,
+                         const uint8_t *state_seededx8, uint32_t addrx8[8*8]);
+
+/**
+ * Advances the chains in the eight lanes by steps calls to the hash function
+ * each; see wots_chains_impl in wots.c for the layout of the arguments.
+ */
+void thashx8_chain_steps_avx2(uint32_t *valuew, const uint32_t *seededw,
+                              const uint32_t *addrw, unsigned int steps);
+
+/**
+ * The AVX2 kernel for the tree nodes of treehashx8 and compute_rootx8, which
+ * keep their nodes transposed: word i of the node in lane j is at
+ * node[8*i + j], and the seeded states are held the same way.
+ */
+void thashx8_h_words_avx2(uint32_t *outw,
+                          const uint32_t *leftw,
+                          const uint32_t *rightw,
+                          const uint32_t *seeded,
+                          const uint32_t addrx8[8*8]);
+
+/**
+ * The fused AVX2 kernel for the bottom three levels of a FORS tree, in the
+ * form of the gen_blockx8 argument of treehashx8_blocks; see fors.c.
+ */
+void fors_blockx8_avx2(uint32_t *nodew, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx, uint32_t idx_offset,
+                       const uint32_t tree_addr[8]);
 
 #endif
@@ -1,10 +1,323 @@
 #include <string.h>
 
 #include "utils.h"
+#include "utilsx8.h"
 #include "params.h"
+#include "thash.h"
 #include "thashx8.h"
+#include "dispatch.h"
 #include "address.h"
 
+/* Words of a transposed node, see thashx8_h_words_avx2 */
+#define SPX_NODEW (8 * SPX_N / 4)
+
+/* Writes the n bytes at in, as big-endian words, to lane j of w. */
+static void lane_from_bytes(uint32_t *w, unsigned int j,
+                            const unsigned char *in, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n / 4; i++) {
+        w[8*i + j] = ((uint32_t)in[4*i] << 24) | ((uint32_t)in[4*i + 1] << 16)
+                     | ((uint32_t)in[4*i + 2] << 8) | (uint32_t)in[4*i + 3];
+    }
+}
+
+/* Writes the eight words of a chaining value to lane j of w. */
+static void lane_from_words(uint32_t *w, unsigned int j, const uint32_t *in)
+{
+    unsigned int i;
+
+    for (i = 0; i < 8; i++) {
+        w[8*i + j] = in[i];
+    }
+}
+
+/* Writes the SPX_N-byte node in lane j of w to out. */
+static void lane_to_bytes(unsigned char *out, const uint32_t *w,
+                          unsigned int j)
+{
+    unsigned int i;
+
+    for (i = 0; i < SPX_N / 4; i++) {
+        out[4*i + 0] = (unsigned char)(w[8*i + j] >> 24);
+        out[4*i + 1] = (unsigned char)(w[8*i + j] >> 16);
+        out[4*i + 2] = (unsigned char)(w[8*i + j] >> 8);
+        out[4*i + 3] = (unsigned char)w[8*i + j];
+    }
+}
+
+/**
+ * compute_rootx8 with the AVX2 node kernel. The left and right children of
+ * every lane stay transposed from one level to the next; the auth path
+ * nodes are read into their lanes as they are needed, and only the roots are
+ * turned back into bytes.
+ */
+static void compute_rootx8_words(unsigned char *rootx8,
+                                 const unsigned char *leafx8,
+                                 const uint32_t leaf_idx[8],
+                                 const uint32_t idx_offset[8],
+                                 const unsigned char *const auth_pathx8[8],
+                                 uint32_t tree_height,
+                                 const uint8_t *state_seededx8,
+                                 uint32_t addrx8[8*8])
+{
+    uint32_t seeded[8*8];
+    uint32_t leftw[SPX_NODEW];
+    uint32_t rightw[SPX_NODEW];
+    uint32_t nodew[SPX_NODEW];
+    const unsigned char *auth_path[8];
+    uint32_t idx[8];
+    uint32_t offset[8];
+    uint32_t i;
+    unsigned int j, k;
+
+    for (j = 0; j < 8; j++) {
+        lane_from_bytes(seeded, j, state_seededx8 + 40*j, 32);
+        idx[j] = leaf_idx[j];
+        offset[j] = idx_offset[j];
+        auth_path[j] = auth_pathx8[j];
+        lane_from_bytes(nodew, j, leafx8 + j*SPX_N, SPX_N);
+    }
+
+    for (i = 0; i < tree_height; i++) {
+        /* The node of every lane goes left or right, depending on its
+           parity, and the auth path node to the other side. */
+        for (j = 0; j < 8; j++) {
+            if (idx[j] & 1) {
+                lane_from_bytes(leftw, j, auth_path[j], SPX_N);
+                for (k = 0; k < SPX_N / 4; k++) {
+                    rightw[8*k + j] = nodew[8*k + j];
+                }
+            }
+            else {
+                lane_from_bytes(rightw, j, auth_path[j], SPX_N);
+                for (k = 0; k < SPX_N / 4; k++) {
+                    leftw[8*k + j] = nodew[8*k + j];
+                }
+            }
+            auth_path[j] += SPX_N;
+
+            idx[j] >>= 1;
+            offset[j] >>= 1;
+            set_tree_height(addrx8 + j*8, i + 1);
+            set_tree_index(addrx8 + j*8, idx[j] + offset[j]);
+        }
+        thashx8_h_words_avx2(nodew, leftw, rightw, seeded, addrx8);
+    }
+
+    for (j = 0; j < 8; j++) {
+        lane_to_bytes(rootx8 + j*SPX_N, nodew, j);
+    }
+}
+
+/**
+ * 8-way parallel version of compute_root; climbs eight independent auth
+ * paths at once. Lane j starts from the leaf at leafx8 + j*SPX_N and reads
+ * its auth path from auth_pathx8[j]. Every lane uses its own seeded state, as
+ * in thashx8_seeded, so the lanes may belong to different key pairs.
+ * Expects the addresses to be complete other than the tree_height and
+ * tree_index.
+ */
+void compute_rootx8(unsigned char *rootx8, const unsigned char *leafx8,
+                    const uint32_t leaf_idx[8], const uint32_t idx_offset[8],
+                    const unsigned char *const auth_pathx8[8],
+                    uint32_t tree_height,
+                    const uint8_t *state_seededx8, uint32_t addrx8[8*8])
+{
+    unsigned char bufferx8[8 * 2 * SPX_N];
+    unsigned char *outx8[8];
+    const unsigned char *auth_path[8];
+    uint32_t idx[8];
+    uint32_t offset[8];
+    uint32_t i;
+    unsigned int j;
+
+    if (spx_dispatch.treehash == SPX_IMPL_AVX2) {
+        compute_rootx8_words(rootx8, leafx8, leaf_idx, idx_offset, auth_pathx8,
+                             tree_height, state_seededx8, addrx8);
+        return;
+    }
+
+    /* If leaf_idx is odd (last bit = 1), current path element is a right child
+       and auth_path has to go left. Otherwise it is the other way around. */
+    for (j = 0; j < 8; j++) {
+        idx[j] = leaf_idx[j];
+        offset[j] = idx_offset[j];
+        auth_path[j] = auth_pathx8[j];
+
+        if (idx[j] & 1) {
+            memcpy(bufferx8 + j*2*SPX_N + SPX_N, leafx8 + j*SPX_N, SPX_N);
+            memcpy(bufferx8 + j*2*SPX_N, auth_path[j], SPX_N);
+        }
+        else {
+            memcpy(bufferx8 + j*2*SPX_N, leafx8 + j*SPX_N, SPX_N);
+            memcpy(bufferx8 + j*2*SPX_N + SPX_N, auth_path[j], SPX_N);
+        }
+        auth_path[j] += SPX_N;
+    }
+
+    for (i = 0; i < tree_height - 1; i++) {
+        for (j = 0; j < 8; j++) {
+            idx[j] >>= 1;
+            offset[j] >>= 1;
+            /* Set the address of the node we're creating. */
+            set_tree_height(addrx8 + j*8, i + 1);
+            set_tree_index(addrx8 + j*8, idx[j] + offset[j]);
+
+            /* The new node replaces the half that is not the auth path. */
+            outx8[j] = bufferx8 + j*2*SPX_N + ((idx[j] & 1) ? SPX_N : 0);
+        }
+
+        thashx8_seeded_impl(spx_dispatch.treehash,
+                            outx8[0], outx8[1], outx8[2], outx8[3],
+                            outx8[4], outx8[5], outx8[6], outx8[7],
+                            bufferx8 + 0*2*SPX_N,
+                            bufferx8 + 1*2*SPX_N,
+                            bufferx8 + 2*2*SPX_N,
+                            bufferx8 + 3*2*SPX_N,
+                            bufferx8 + 4*2*SPX_N,
+                            bufferx8 + 5*2*SPX_N,
+                            bufferx8 + 6*2*SPX_N,
+                            bufferx8 + 7*2*SPX_N, 2, state_seededx8, addrx8);
+
+        /* Pick the right or left neighbor, depending on parity of the node. */
+        for (j = 0; j < 8; j++) {
+            memcpy(bufferx8 + j*2*SPX_N + ((idx[j] & 1) ? 0 : SPX_N),
+                   auth_path[j], SPX_N);
+            auth_path[j] += SPX_N;
+        }
+    }
+
+    /* The last iteration is exceptional; we do not copy an auth_path node. */
+    for (j = 0; j < 8; j++) {
+        idx[j] >>= 1;
+        offset[j] >>= 1;
+        set_tree_height(addrx8 + j*8, tree_height);
+        set_tree_index(addrx8 + j*8, idx[j] + offset[j]);
+    }
+    thashx8_seeded_impl(spx_dispatch.treehash,
+                        rootx8 + 0*SPX_N,
+                        rootx8 + 1*SPX_N,
+                        rootx8 + 2*SPX_N,
+                        rootx8 + 3*SPX_N,
+                        rootx8 + 4*SPX_N,
+                        rootx8 + 5*SPX_N,
+                        rootx8 + 6*SPX_N,
+                        rootx8 + 7*SPX_N,
+                        bufferx8 + 0*2*SPX_N,
+                        bufferx8 + 1*2*SPX_N,
+                        bufferx8 + 2*2*SPX_N,
+                        bufferx8 + 3*2*SPX_N,
+                        bufferx8 + 4*2*SPX_N,
+                        bufferx8 + 5*2*SPX_N,
+                        bufferx8 + 6*2*SPX_N,
+                        bufferx8 + 7*2*SPX_N, 2, state_seededx8, addrx8);
+}
+
+/**
+ * treehashx8 with the AVX2 node kernel. The stack holds transposed nodes:
+ * the leaves are turned into words once, as they are pushed, and from then
+ * on the nodes stay words; only the auth path nodes and the roots are turned
+ * back into bytes.
+ */
+static void treehashx8_words(unsigned char *rootx8, unsigned char *auth_pathx8,
+                             const unsigned char *sk_seed, const spx_ctx *ctx,
+                             uint32_t leaf_idx[8], uint32_t idx_offset[8],
+                             uint32_t tree_height,
+                             void (*gen_leafx8)(
+                                unsigned char* /* leaf0 */,
+                                unsigned char* /* leaf1 */,
+                                unsigned char* /* leaf2 */,
+                                unsigned char* /* leaf3 */,
+                                unsigned char* /* leaf4 */,
+                                unsigned char* /* leaf5 */,
+                                unsigned char* /* leaf6 */,
+                                unsigned char* /* leaf7 */,
+                                const unsigned char* /* sk_seed */,
+                                const spx_ctx* /* ctx */,
+                                uint32_t /* addr_idx0 */,
+                                uint32_t /* addr_idx1 */,
+                                uint32_t /* addr_idx2 */,
+                                uint32_t /* addr_idx3 */,
+                                uint32_t /* addr_idx4 */,
+                                uint32_t /* addr_idx5 */,
+                                uint32_t /* addr_idx6 */,
+                                uint32_t /* addr_idx7 */,
+                                const uint32_t[8] /* tree_addr */),
+                             uint32_t tree_addrx8[8*8])
+{
+    uint32_t stackw[(tree_height + 1)*SPX_NODEW];
+    unsigned int heights[tree_height + 1];
+    unsigned char leafx8[8*SPX_N];
+    uint32_t seeded[8*8];
+    unsigned int offset = 0;
+    uint32_t idx;
+    uint32_t tree_idx;
+    unsigned int j;
+
+    for (j = 0; j < 8; j++) {
+        lane_from_words(seeded, j, ctx->seeded_words);
+    }
+
+    for (idx = 0; idx < (uint32_t)(1 << tree_height); idx++) {
+        gen_leafx8(leafx8 + 0*SPX_N, leafx8 + 1*SPX_N,
+                   leafx8 + 2*SPX_N, leafx8 + 3*SPX_N,
+                   leafx8 + 4*SPX_N, leafx8 + 5*SPX_N,
+                   leafx8 + 6*SPX_N, leafx8 + 7*SPX_N,
+                   sk_seed, ctx,
+                   idx + idx_offset[0],
+                   idx + idx_offset[1],
+                   idx + idx_offset[2],
+                   idx + idx_offset[3],
+                   idx + idx_offset[4],
+                   idx + idx_offset[5],
+                   idx + idx_offset[6],
+                   idx + idx_offset[7],
+                   tree_addrx8);
+        /* Push the leaves, and keep those of the auth path as they are. */
+        for (j = 0; j < 8; j++) {
+            lane_from_bytes(stackw + offset*SPX_NODEW, j,
+                            leafx8 + j*SPX_N, SPX_N);
+            if ((leaf_idx[j] ^ 0x1) == idx) {
+                memcpy(auth_pathx8 + j*tree_height*SPX_N,
+                       leafx8 + j*SPX_N, SPX_N);
+            }
+        }
+        offset++;
+        heights[offset - 1] = 0;
+
+        /* While the top-most nodes are of equal height.. */
+        while (offset >= 2 && heights[offset - 1] == heights[offset - 2]) {
+            tree_idx = (idx >> (heights[offset - 1] + 1));
+
+            for (j = 0; j < 8; j++) {
+                set_tree_height(tree_addrx8 + j*8, heights[offset - 1] + 1);
+                set_tree_index(tree_addrx8 + j*8,
+                               tree_idx + (idx_offset[j] >> (heights[offset-1] + 1)));
+            }
+            thashx8_h_words_avx2(stackw + (offset - 2)*SPX_NODEW,
+                                 stackw + (offset - 2)*SPX_NODEW,
+                                 stackw + (offset - 1)*SPX_NODEW,
+                                 seeded, tree_addrx8);
+            offset--;
+            heights[offset - 1]++;
+
+            for (j = 0; j < 8; j++) {
+                if (((leaf_idx[j] >> heights[offset - 1]) ^ 0x1) == tree_idx) {
+                    lane_to_bytes(auth_pathx8 + j*tree_height*SPX_N
+                                  + heights[offset - 1]*SPX_N,
+                                  stackw + (offset - 1)*SPX_NODEW, j);
+                }
+            }
+        }
+    }
+
+    for (j = 0; j < 8; j++) {
+        lane_to_bytes(rootx8 + j*SPX_N, stackw, j);
+    }
+}
+
 /**
  * For a given leaf index, computes the authentication path and the resulting
  * root node using Merkle's TreeHash algorithm.
@@ -14,7 +327,7 @@
  * it is possible to continue counting indices across trees.
  */
 void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
-                const unsigned char *sk_seed, const unsigned char *pub_seed,
+                const unsigned char *sk_seed, const spx_ctx *ctx,
                 uint32_t leaf_idx[8], uint32_t idx_offset[8],
                 uint32_t tree_height,
                 void (*gen_leafx8)(
@@ -27,7 +340,7 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
                    unsigned char* /* leaf6 */,
                    unsigned char* /* leaf7 */,
                    const unsigned char* /* sk_seed */,
-                   const unsigned char* /* pub_seed */,
+                   const spx_ctx* /* ctx */,
                    uint32_t /* addr_idx0 */,
                    uint32_t /* addr_idx1 */,
                    uint32_t /* addr_idx2 */,
@@ -46,6 +359,12 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
     uint32_t tree_idx;
     unsigned int j;
 
+    if (spx_dispatch.treehash == SPX_IMPL_AVX2) {
+        treehashx8_words(rootx8, auth_pathx8, sk_seed, ctx, leaf_idx,
+                         idx_offset, tree_height, gen_leafx8, tree_addrx8);
+        return;
+    }
+
     for (idx = 0; idx < (uint32_t)(1 << tree_height); idx++) {
         /* Add the next leaf node to the stack. */
         gen_leafx8(stackx8 + 0*(tree_height + 1)*SPX_N + offset*SPX_N,
@@ -56,7 +375,7 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
                    stackx8 + 5*(tree_height + 1)*SPX_N + offset*SPX_N,
                    stackx8 + 6*(tree_height + 1)*SPX_N + offset*SPX_N,
                    stackx8 + 7*(tree_height + 1)*SPX_N + offset*SPX_N,
-                   sk_seed, pub_seed,
+                   sk_seed, ctx,
                    idx + idx_offset[0],
                    idx + idx_offset[1],
                    idx + idx_offset[2],
@@ -89,22 +408,23 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
                                tree_idx + (idx_offset[j] >> (heights[offset-1] + 1)));
             }
             /* Hash the top-most nodes from the stack together. */
-            thashx8(stackx8 + 0*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 1*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 2*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 3*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 4*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 5*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 6*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 7*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 0*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 1*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 2*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 3*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 4*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 5*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 6*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
-                    stackx8 + 7*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N, 2, pub_seed, tree_addrx8);
+            thashx8_impl(spx_dispatch.treehash,
+                         stackx8 + 0*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 1*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 2*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 3*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 4*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 5*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 6*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 7*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 0*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 1*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 2*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 3*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 4*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 5*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 6*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N,
+                         stackx8 + 7*(tree_height + 1)*SPX_N + (offset - 2)*SPX_N, 2, ctx, tree_addrx8);
             offset--;
             /* Note that the top-most node is now one layer higher. */
             heights[offset - 1]++;
@@ -123,3 +443,306 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
         memcpy(rootx8 + j*SPX_N, stackx8 + j*(tree_height + 1)*SPX_N, SPX_N);
     }
 }
+
+/**
+ * The top three levels of treehashx8_levels, which hold too few nodes for
+ * eight lanes: takes the eight nodes of level tree_height - 3 in order and
+ * hashes them one at a time, halving the nodes in place.
+ */
+static void treehash_top(unsigned char *root, unsigned char *auth_path,
+                         unsigned char *nodes, const spx_ctx *ctx,
+                         uint32_t leaf_idx, uint32_t idx_offset,
+                         uint32_t tree_height, uint32_t tree_addr[8])
+{
+    uint32_t h;
+    uint32_t idx;
+
+    for (h = tree_height - 3; h < tree_height; h++) {
+        memcpy(auth_path + h*SPX_N, nodes + ((leaf_idx >> h) ^ 1)*SPX_N,
+               SPX_N);
+        set_tree_height(tree_addr, h + 1);
+        for (idx = 0; idx < (1U << (tree_height - h - 1)); idx++) {
+            set_tree_index(tree_addr, idx + (idx_offset >> (h + 1)));
+            thash(nodes + idx*SPX_N, nodes + 2*idx*SPX_N, 2, ctx, tree_addr);
+        }
+    }
+    memcpy(root, nodes, SPX_N);
+}
+
+/**
+ * treehashx8_levels and treehashx8_blocks with the AVX2 node kernel, on
+ * levels that are kept transposed: nodes 0..7 of a level are the lanes of
+ * its first block, nodes 8..15 those of its second. The blocks of level
+ * block_height come from gen_blockx8 or, if that is NULL, from the leaves
+ * of gen_leafx8, with block_height 0.
+ */
+static void treehashx8_levels_words(unsigned char *root,
+                                    unsigned char *auth_path,
+                                    const unsigned char *sk_seed,
+                                    const spx_ctx *ctx,
+                                    uint32_t leaf_idx, uint32_t idx_offset,
+                                    uint32_t tree_height,
+                                    uint32_t block_height,
+                                    void (*gen_leafx8)(
+                                       unsigned char* /* leaf0 */,
+                                       unsigned char* /* leaf1 */,
+                                       unsigned char* /* leaf2 */,
+                                       unsigned char* /* leaf3 */,
+                                       unsigned char* /* leaf4 */,
+                                       unsigned char* /* leaf5 */,
+                                       unsigned char* /* leaf6 */,
+                                       unsigned char* /* leaf7 */,
+                                       const unsigned char* /* sk_seed */,
+                                       const spx_ctx* /* ctx */,
+                                       uint32_t /* addr_idx0 */,
+                                       uint32_t /* addr_idx1 */,
+                                       uint32_t /* addr_idx2 */,
+                                       uint32_t /* addr_idx3 */,
+                                       uint32_t /* addr_idx4 */,
+                                       uint32_t /* addr_idx5 */,
+                                       uint32_t /* addr_idx6 */,
+                                       uint32_t /* addr_idx7 */,
+                                       const uint32_t[8] /* tree_addr */),
+                                    void (*gen_blockx8)(
+                                       uint32_t* /* nodew */,
+                                       unsigned char* /* auth_path */,
+                                       const unsigned char* /* sk_seed */,
+                                       const spx_ctx* /* ctx */,
+                                       uint32_t /* leaf_idx */,
+                                       uint32_t /* idx */,
+                                       uint32_t /* idx_offset */,
+                                       const uint32_t[8] /* tree_addr */),
+                                    uint32_t tree_addr[8])
+{
+    /* Level block_height + l is kept in levelsw[l]. */
+    uint32_t levelsw[tree_height - block_height - 2][2*SPX_NODEW];
+    unsigned int count[tree_height - block_height - 2];
+    uint32_t made[tree_height - block_height - 2];
+    unsigned char leafx8[8*SPX_N];
+    uint32_t leftw[SPX_NODEW];
+    uint32_t rightw[SPX_NODEW];
+    uint32_t seeded[8*8];
+    uint32_t addrx8[8*8];
+    const uint32_t *in;
+    uint32_t *out;
+    uint32_t idx;
+    uint32_t h, l;
+    unsigned int j, k, n;
+
+    for (j = 0; j < 8; j++) {
+        lane_from_words(seeded, j, ctx->seeded_words);
+        memcpy(addrx8 + j*8, tree_addr, 8 * sizeof(uint32_t));
+    }
+    for (l = 0; l < tree_height - block_height - 2; l++) {
+        count[l] = 0;
+        made[l] = 0;
+    }
+
+    for (idx = 0; idx < (uint32_t)(1 << tree_height);
+         idx += 8 << block_height) {
+        out = levelsw[0] + (count[0] / 8)*SPX_NODEW;
+        if (gen_blockx8 != NULL) {
+            gen_blockx8(out, auth_path, sk_seed, ctx, leaf_idx, idx,
+                        idx_offset, tree_addr);
+        }
+        else {
+            gen_leafx8(leafx8 + 0*SPX_N, leafx8 + 1*SPX_N,
+                       leafx8 + 2*SPX_N, leafx8 + 3*SPX_N,
+                       leafx8 + 4*SPX_N, leafx8 + 5*SPX_N,
+                       leafx8 + 6*SPX_N, leafx8 + 7*SPX_N,
+                       sk_seed, ctx,
+                       idx + idx_offset + 0, idx + idx_offset + 1,
+                       idx + idx_offset + 2, idx + idx_offset + 3,
+                       idx + idx_offset + 4, idx + idx_offset + 5,
+                       idx + idx_offset + 6, idx + idx_offset + 7,
+                       tree_addr);
+            for (j = 0; j < 8; j++) {
+                lane_from_bytes(out, j, leafx8 + j*SPX_N, SPX_N);
+            }
+        }
+        n = ((leaf_idx >> block_height) ^ 1) - (idx >> block_height);
+        if (n < 8) {
+            lane_to_bytes(auth_path + block_height*SPX_N, out, n);
+        }
+        count[0] += 8;
+        made[0] += 8;
+
+        /* Every full level is hashed into eight nodes of the next one. */
+        for (l = 0; block_height + l + 3 < tree_height && count[l] == 16;
+             l++) {
+            h = block_height + l;
+            for (k = 0; k < SPX_N / 4; k++) {
+                for (j = 0; j < 8; j++) {
+                    n = 2*j;
+                    leftw[8*k + j] = levelsw[l][(n / 8)*SPX_NODEW + 8*k + n % 8];
+                    n = 2*j + 1;
+                    rightw[8*k + j] = levelsw[l][(n / 8)*SPX_NODEW + 8*k + n % 8];
+                }
+            }
+            for (j = 0; j < 8; j++) {
+                set_tree_height(addrx8 + j*8, h + 1);
+                set_tree_index(addrx8 + j*8,
+                               made[l + 1] + j + (idx_offset >> (h + 1)));
+            }
+            out = levelsw[l + 1] + (count[l + 1] / 8)*SPX_NODEW;
+            thashx8_h_words_avx2(out, leftw, rightw, seeded, addrx8);
+
+            n = ((leaf_idx >> (h + 1)) ^ 1) - made[l + 1];
+            if (n < 8) {
+                lane_to_bytes(auth_path + (h + 1)*SPX_N, out, n);
+            }
+            count[l] = 0;
+            count[l + 1] += 8;
+            made[l + 1] += 8;
+        }
+    }
+
+    /* Level tree_height - 3 now holds its eight nodes. */
+    in = levelsw[tree_height - block_height - 3];
+    for (j = 0; j < 8; j++) {
+        lane_to_bytes(leafx8 + j*SPX_N, in, j);
+    }
+    treehash_top(root, auth_path, leafx8, ctx, leaf_idx, idx_offset,
+                 tree_height, tree_addr);
+}
+
+/**
+ * treehashx8_levels for trees whose bottom block_height levels have a fused
+ * kernel: gen_blockx8 makes the eight nodes of level block_height above the
+ * 8 << block_height leaves from idx on, transposed as for
+ * thashx8_h_words_avx2, and writes those of the auth path of leaf_idx below
+ * block_height itself. Only available with the AVX2 tree kernel. Expects
+ * tree_height to be at least block_height + 3.
+ */
+void treehashx8_blocks(unsigned char *root, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx_offset,
+                       uint32_t tree_height, uint32_t block_height,
+                       void (*gen_blockx8)(
+                          uint32_t* /* nodew */,
+                          unsigned char* /* auth_path */,
+                          const unsigned char* /* sk_seed */,
+                          const spx_ctx* /* ctx */,
+                          uint32_t /* leaf_idx */,
+                          uint32_t /* idx */,
+                          uint32_t /* idx_offset */,
+                          const uint32_t[8] /* tree_addr */),
+                       uint32_t tree_addr[8])
+{
+    treehashx8_levels_words(root, auth_path, sk_seed, ctx, leaf_idx,
+                            idx_offset, tree_height, block_height, NULL,
+                            gen_blockx8, tree_addr);
+}
+
+/**
+ * Computes the root and the auth path of leaf leaf_idx of a single tree,
+ * as treehash does, but level by level: the leaves are made eight at a time
+ * by gen_leafx8, and every sixteen nodes of a level are hashed into eight
+ * nodes of the next with one thashx8, so that all lanes work on the same
+ * tree. Only the top three levels are hashed one node at a time. At most
+ * sixteen nodes per level are kept, so that the memory is linear in
+ * tree_height, as in treehash. Expects tree_height to be at least 3, and the
+ * addresses as treehash does.
+ */
+void treehashx8_levels(unsigned char *root, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx_offset,
+                       uint32_t tree_height,
+                       void (*gen_leafx8)(
+                          unsigned char* /* leaf0 */,
+                          unsigned char* /* leaf1 */,
+                          unsigned char* /* leaf2 */,
+                          unsigned char* /* leaf3 */,
+                          unsigned char* /* leaf4 */,
+                          unsigned char* /* leaf5 */,
+                          unsigned char* /* leaf6 */,
+                          unsigned char* /* leaf7 */,
+                          const unsigned char* /* sk_seed */,
+                          const spx_ctx* /* ctx */,
+                          uint32_t /* addr_idx0 */,
+                          uint32_t /* addr_idx1 */,
+                          uint32_t /* addr_idx2 */,
+                          uint32_t /* addr_idx3 */,
+                          uint32_t /* addr_idx4 */,
+                          uint32_t /* addr_idx5 */,
+                          uint32_t /* addr_idx6 */,
+                          uint32_t /* addr_idx7 */,
+                          const uint32_t[8] /* tree_addr */),
+                       uint32_t tree_addr[8])
+{
+    unsigned char levels[tree_height - 2][16*SPX_N];
+    unsigned int count[tree_height - 2];
+    uint32_t made[tree_height - 2];
+    uint32_t addrx8[8*8];
+    unsigned char *in;
+    unsigned char *out;
+    uint32_t idx;
+    uint32_t h;
+    unsigned int j;
+
+    if (spx_dispatch.treehash == SPX_IMPL_AVX2) {
+        treehashx8_levels_words(root, auth_path, sk_seed, ctx, leaf_idx,
+                                idx_offset, tree_height, 0, gen_leafx8, NULL,
+                                tree_addr);
+        return;
+    }
+
+    for (j = 0; j < 8; j++) {
+        memcpy(addrx8 + j*8, tree_addr, 8 * sizeof(uint32_t));
+    }
+    for (h = 0; h < tree_height - 2; h++) {
+        count[h] = 0;
+        made[h] = 0;
+    }
+
+    for (idx = 0; idx < (uint32_t)(1 << tree_height); idx += 8) {
+        out = levels[0] + count[0]*SPX_N;
+        gen_leafx8(out + 0*SPX_N, out + 1*SPX_N,
+                   out + 2*SPX_N, out + 3*SPX_N,
+                   out + 4*SPX_N, out + 5*SPX_N,
+                   out + 6*SPX_N, out + 7*SPX_N,
+                   sk_seed, ctx,
+                   idx + idx_offset + 0, idx + idx_offset + 1,
+                   idx + idx_offset + 2, idx + idx_offset + 3,
+                   idx + idx_offset + 4, idx + idx_offset + 5,
+                   idx + idx_offset + 6, idx + idx_offset + 7,
+                   tree_addr);
+        if ((leaf_idx ^ 1) - idx < 8) {
+            memcpy(auth_path, out + ((leaf_idx ^ 1) - idx)*SPX_N, SPX_N);
+        }
+        count[0] += 8;
+        made[0] += 8;
+
+        /* Every full level is hashed into eight nodes of the next one. */
+        for (h = 0; h + 3 < tree_height && count[h] == 16; h++) {
+            for (j = 0; j < 8; j++) {
+                set_tree_height(addrx8 + j*8, h + 1);
+                set_tree_index(addrx8 + j*8,
+                               made[h + 1] + j + (idx_offset >> (h + 1)));
+            }
+            in = levels[h];
+            out = levels[h + 1] + count[h + 1]*SPX_N;
+            thashx8_impl(spx_dispatch.treehash,
+                         out + 0*SPX_N, out + 1*SPX_N,
+                         out + 2*SPX_N, out + 3*SPX_N,
+                         out + 4*SPX_N, out + 5*SPX_N,
+                         out + 6*SPX_N, out + 7*SPX_N,
+                         in + 0*SPX_N, in + 2*SPX_N,
+                         in + 4*SPX_N, in + 6*SPX_N,
+                         in + 8*SPX_N, in + 10*SPX_N,
+                         in + 12*SPX_N, in + 14*SPX_N, 2, ctx, addrx8);
+
+            if (((leaf_idx >> (h + 1)) ^ 1) - made[h + 1] < 8) {
+                memcpy(auth_path + (h + 1)*SPX_N,
+                       out + (((leaf_idx >> (h + 1)) ^ 1) - made[h + 1])*SPX_N,
+                       SPX_N);
+            }
+            count[h] = 0;
+            count[h + 1] += 8;
+            made[h + 1] += 8;
+        }
+    }
+
+    treehash_top(root, auth_path, levels[tree_height - 3], ctx, leaf_idx,
+                 idx_offset, tree_height, tree_addr);
+}
@@ -3,6 +3,21 @@
 
 #include <stdint.h>
 #include "params.h"
+#include "context.h"
+
+/**
+ * 8-way parallel version of compute_root; climbs eight independent auth
+ * paths at once. Lane j starts from the leaf at leafx8 + j*SPX_N and reads
+ * its auth path from auth_pathx8[j]. Every lane uses its own seeded state, as
+ * in thashx8_seeded, so the lanes may belong to different key pairs.
+ * Expects the addresses to be complete other than the tree_height and
+ * tree_index.
+ */
+void compute_rootx8(unsigned char *rootx8, const unsigned char *leafx8,
+                    const uint32_t leaf_idx[8], const uint32_t idx_offset[8],
+                    const unsigned char *const auth_pathx8[8],
+                    uint32_t tree_height,
+                    const uint8_t *state_seededx8, uint32_t addrx8[8*8]);
 
 /**
  * For a given leaf index, computes the authentication path and the resulting
@@ -13,7 +28,7 @@
  * it is possible to continue counting indices across trees.
  */
 void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
-                const unsigned char *sk_seed, const unsigned char *pub_seed,
+                const unsigned char *sk_seed, const spx_ctx *ctx,
                 uint32_t leaf_idx[8], uint32_t idx_offset[8],
                 uint32_t tree_height,
                 void (*gen_leafx8)(
@@ -26,7 +41,7 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
                    unsigned char* /* leaf6 */,
                    unsigned char* /* leaf7 */,
                    const unsigned char* /* sk_seed */,
-                   const unsigned char* /* pub_seed */,
+                   const spx_ctx* /* ctx */,
                    uint32_t /* addr_idx0 */,
                    uint32_t /* addr_idx1 */,
                    uint32_t /* addr_idx2 */,
@@ -38,4 +53,61 @@ void treehashx8(unsigned char *rootx8, unsigned char *auth_pathx8,
                    const uint32_t[8] /* tree_addr */),
                 uint32_t tree_addrx8[8*8]);
 
+/**
+ * Computes the root and the auth path of leaf leaf_idx of a single tree,
+ * as treehash does, but level by level: the leaves are made eight at a time
+ * by gen_leafx8, and every sixteen nodes of a level are hashed into eight
+ * nodes of the next with one thashx8, so that all lanes work on the same
+ * tree. Expects tree_height to be at least 3, and the addresses as treehash
+ * does.
+ */
+void treehashx8_levels(unsigned char *root, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx_offset,
+                       uint32_t tree_height,
+                       void (*gen_leafx8)(
+                          unsigned char* /* leaf0 */,
+                          unsigned char* /* leaf1 */,
+                          unsigned char* /* leaf2 */,
+                          unsigned char* /* leaf3 */,
+                          unsigned char* /* leaf4 */,
+                          unsigned char* /* leaf5 */,
+                          unsigned char* /* leaf6 */,
+                          unsigned char* /* leaf7 */,
+                          const unsigned char* /* sk_seed */,
+                          const spx_ctx* /* ctx */,
+                          uint32_t /* addr_idx0 */,
+                          uint32_t /* addr_idx1 */,
+                          uint32_t /* addr_idx2 */,
+                          uint32_t /* addr_idx3 */,
+                          uint32_t /* addr_idx4 */,
+                          uint32_t /* addr_idx5 */,
+                          uint32_t /* addr_idx6 */,
+                          uint32_t /* addr_idx7 */,
+                          const uint32_t[8] /* tree_addr */),
+                       uint32_t tree_addr[8]);
+
+/**
+ * treehashx8_levels for trees whose bottom block_height levels have a fused
+ * kernel: gen_blockx8 makes the eight nodes of level block_height above the
+ * 8 << block_height leaves from idx on, transposed as for
+ * thashx8_h_words_avx2, and writes those of the auth path of leaf_idx below
+ * block_height itself. Only available with the AVX2 tree kernel. Expects
+ * tree_height to be at least block_height + 3.
+ */
+void treehashx8_blocks(unsigned char *root, unsigned char *auth_path,
+                       const unsigned char *sk_seed, const spx_ctx *ctx,
+                       uint32_t leaf_idx, uint32_t idx_offset,
+                       uint32_t tree_height, uint32_t block_height,
+                       void (*gen_blockx8)(
+                          uint32_t* /* nodew */,
+                          unsigned char* /* auth_path */,
+                          const unsigned char* /* sk_seed */,
+                          const spx_ctx* /* ctx */,
+                          uint32_t /* leaf_idx */,
+                          uint32_t /* idx */,
+                          uint32_t /* idx_offset */,
+                          const uint32_t[8] /* tree_addr */),
+                       uint32_t tree_addr[8]);
+
 #endif
@@ -2,32 +2,25 @@
 #include <string.h>
 
 #include "utils.h"
+#include "utilsx8.h"
 #include "hash.h"
 #include "hashx8.h"
 #include "thash.h"
+#include "thashx4.h"
 #include "thashx8.h"
+#include "thashx16.h"
+#include "dispatch.h"
 #include "wots.h"
+#include "wotsx8.h"
 #include "address.h"
 #include "params.h"
+#include "sha256.h"
+#include "sha256sse2.h"
 
 // TODO clarify address expectations, and make them more uniform.
 // TODO i.e. do we expect types to be set already?
 // TODO and do we expect modifications or copies?
 
-/**
- * Computes the starting value for a chain, i.e. the secret key.
- * Expects the address to be complete up to the chain address.
- */
-static void wots_gen_sk(unsigned char *sk, const unsigned char *sk_seed,
-                        uint32_t wots_addr[8])
-{
-    /* Make sure that the hash address is actually zeroed. */
-    set_hash_addr(wots_addr, 0);
-
-    /* Generate sk element. */
-    prf_addr(sk, sk_seed, wots_addr);
-}
-
 /**
  * 8-way parallel version of wots_gen_sk; expects 8x as much space in sk
  */
@@ -53,36 +46,13 @@ static void wots_gen_skx8(unsigned char *skx8, const unsigned char *sk_seed,
                sk_seed, wots_addrx8);
 }
 
-/**
- * Computes the chaining function.
- * out and in have to be n-byte arrays.
- *
- * Interprets in as start-th value of the chain.
- * addr has to contain the address of the chain.
- */
-static void gen_chain(unsigned char *out, const unsigned char *in,
-                      unsigned int start, unsigned int steps,
-                      const unsigned char *pub_seed, uint32_t addr[8])
-{
-    uint32_t i;
-
-    /* Initialize out with the value at position 'start'. */
-    memcpy(out, in, SPX_N);
-
-    /* Iterate 'steps' calls to the hash function. */
-    for (i = start; i < (start+steps) && i < SPX_WOTS_W; i++) {
-        set_hash_addr(addr, i);
-        thash(out, out, 1, pub_seed, addr);
-    }
-}
-
 /**
  * 8-way parallel version of gen_chain; expects 8x as much space in out, and
  * 8x as much space in inx8. Assumes start and step identical across chains.
  */
 static void gen_chainx8(unsigned char *outx8, const unsigned char *inx8,
                         unsigned int start, unsigned int steps,
-                        const unsigned char *pub_seed, uint32_t addrx8[8*8])
+                        const spx_ctx *ctx, uint32_t addrx8[8*8])
 {
     uint32_t i;
     unsigned int j;
@@ -110,8 +80,154 @@ static void gen_chainx8(unsigned char *outx8, const unsigned char *inx8,
                 outx8 + 4*SPX_N,
                 outx8 + 5*SPX_N,
                 outx8 + 6*SPX_N,
-                outx8 + 7*SPX_N, 1, pub_seed, addrx8);
+                outx8 + 7*SPX_N, 1, ctx, addrx8);
+    }
+}
+
+/* The most lanes of any chain step kernel. */
+#define SPX_CHAIN_LANES 16
+
+/**
+ * Computes the chaining function for nchains chains that may each have a
+ * different start and number of steps, on the chain kernel impl. The AVX2
+ * kernel keeps 8 lanes busy, the AVX-512 kernel 16 and the SSE2 kernel 4:
+ * as soon as a chain reaches its target length, its lane is refilled with
+ * the next pending chain, rather than idling until the longest chain is done.
+ * For any other impl, the chains run one after the other with
+ * thash_chain_seeded.
+ *
+ * Chain c is read from and written to chains + c*SPX_N, interpreted as the
+ * start[c]-th value of its chain, and advanced by steps[c] calls to the hash
+ * function. The chains are grouped into WOTS key pairs of chains_per_key
+ * chains each; chain c uses chain address c % chains_per_key within the key
+ * pair address addrs + 8*(c / chains_per_key), and the seeded state
+ * state_seededs + 40*(c / chains_per_key).
+ *
+ * The lanes are kept transposed as message words, which is all the step
+ * kernels see: word i of lane j is at valuew[lanes*i + j] for the chain
+ * value, at seededw[lanes*i + j] for the seeded state, and at
+ * addrw[lanes*i + j] for the first six words of the block. Those are the
+ * compressed address with the chain address, as in thash_chain_seeded, and
+ * the hash address shifted into the top half of word 5. All lanes run until
+ * the first of them ends; idle lanes hash whatever they hold.
+ */
+void wots_chains_impl(int impl,
+                      unsigned char *chains,
+                      const unsigned int *start,
+                      const unsigned int *steps,
+                      unsigned int nchains,
+                      unsigned int chains_per_key,
+                      const uint8_t *state_seededs,
+                      const uint32_t *addrs)
+{
+    void (*chain_steps)(uint32_t *, const uint32_t *, const uint32_t *,
+                        unsigned int) = NULL;
+    uint32_t valuew[SPX_CHAIN_LANES * SPX_N / 4] = {0};
+    uint32_t seededw[SPX_CHAIN_LANES * 8] = {0};
+    uint32_t addrw[SPX_CHAIN_LANES * 6] = {0};
+    unsigned char *out[SPX_CHAIN_LANES] = {NULL};
+    unsigned int left[SPX_CHAIN_LANES] = {0};
+    unsigned int lanes = 0;
+    unsigned int next = 0;
+    unsigned int run, chain, key;
+    const uint32_t *addr;
+    const uint8_t *seed;
+    uint32_t chain_addr[8];
+    unsigned int i, j;
+
+    if (impl == SPX_IMPL_AVX512) {
+        chain_steps = thashx16_chain_steps_avx512;
+        lanes = 16;
+    }
+    if (impl == SPX_IMPL_AVX2) {
+        chain_steps = thashx8_chain_steps_avx2;
+        lanes = 8;
+    }
+#ifdef SPX_WITH_SSE2
+    if (impl == SPX_IMPL_SSE2) {
+        chain_steps = thashx4_chain_steps_sse2;
+        lanes = 4;
     }
+#endif
+    if (chain_steps == NULL) {
+        for (next = 0; next < nchains; next++) {
+            key = next / chains_per_key;
+            memcpy(chain_addr, addrs + 8*key, 8 * sizeof(uint32_t));
+            set_chain_addr(chain_addr, next % chains_per_key);
+            thash_chain_seeded(chains + next*SPX_N, chains + next*SPX_N,
+                               start[next], steps[next],
+                               state_seededs + 40*key, chain_addr);
+        }
+        return;
+    }
+
+    for (;;) {
+        run = 0;
+        for (j = 0; j < lanes; j++) {
+            if (out[j] != NULL && left[j] == 0) {
+                for (i = 0; i < SPX_N / 4; i++) {
+                    ull_to_bytes(out[j] + 4*i, 4, valuew[lanes*i + j]);
+                }
+                out[j] = NULL;
+            }
+            while (out[j] == NULL && next < nchains && steps[next] == 0) {
+                next++;
+            }
+            if (out[j] == NULL && next < nchains) {
+                chain = next % chains_per_key;
+                key = next / chains_per_key;
+                addr = addrs + 8*key;
+                seed = state_seededs + 40*key;
+
+                out[j] = chains + next*SPX_N;
+                for (i = 0; i < SPX_N / 4; i++) {
+                    valuew[lanes*i + j] =
+                        (uint32_t)bytes_to_ull(out[j] + 4*i, 4);
+                }
+                for (i = 0; i < 8; i++) {
+                    seededw[lanes*i + j] =
+                        (uint32_t)bytes_to_ull(seed + 4*i, 4);
+                }
+                addrw[lanes*0 + j] = (addr[0] << 24) | (addr[2] >> 8);
+                addrw[lanes*1 + j] = (addr[2] << 24) | (addr[3] >> 8);
+                addrw[lanes*2 + j] = (addr[3] << 24)
+                                     | ((addr[4] & 0xff) << 16)
+                                     | (addr[5] >> 16);
+                addrw[lanes*3 + j] = (addr[5] << 16) | (chain >> 16);
+                addrw[lanes*4 + j] = chain << 16;
+                addrw[lanes*5 + j] = start[next] << 16;
+                left[j] = steps[next];
+                next++;
+            }
+            if (out[j] != NULL && (run == 0 || left[j] < run)) {
+                run = left[j];
+            }
+        }
+        if (run == 0) {
+            break;
+        }
+
+        chain_steps(valuew, seededw, addrw, run);
+        for (j = 0; j < lanes; j++) {
+            if (out[j] != NULL) {
+                addrw[lanes*5 + j] += run << 16;
+                left[j] -= run;
+            }
+        }
+    }
+}
+
+/* wots_chains_impl on the chain kernel picked at startup. */
+static void gen_chains_refillx8(unsigned char *chains,
+                                const unsigned int *start,
+                                const unsigned int *steps,
+                                unsigned int nchains,
+                                unsigned int chains_per_key,
+                                const uint8_t *state_seededs,
+                                const uint32_t *addrs)
+{
+    wots_chains_impl(spx_dispatch.chains, chains, start, steps, nchains,
+                     chains_per_key, state_seededs, addrs);
 }
 
 /**
@@ -168,13 +284,13 @@ static void chain_lengths(int *lengths, const unsigned char *msg)
 /**
  * WOTS key generation. Takes a 32 byte sk_seed, expands it to WOTS private key
  * elements and computes the corresponding public key.
- * It requires the seed pub_seed (used to generate bitmasks and hash keys)
- * and the address of this WOTS key pair.
+ * It requires the context ctx (holding pub_seed, used to generate bitmasks
+ * and hash keys) and the address of this WOTS key pair.
  *
  * Writes the computed public key to 'pk'.
  */
 void wots_gen_pk(unsigned char *pk, const unsigned char *sk_seed,
-                 const unsigned char *pub_seed, uint32_t addr[8])
+                 const spx_ctx *ctx, uint32_t addr[8])
 {
     uint32_t i;
     unsigned int j;
@@ -194,7 +310,7 @@ void wots_gen_pk(unsigned char *pk, const unsigned char *sk_seed,
             set_chain_addr(addrx8 + j*8, i + j);
         }
         wots_gen_skx8(pkbuf, sk_seed, addrx8);
-        gen_chainx8(pkbuf, pkbuf, 0, SPX_WOTS_W - 1, pub_seed, addrx8);
+        gen_chainx8(pkbuf, pkbuf, 0, SPX_WOTS_W - 1, ctx, addrx8);
         for (j = 0; j < 8; j++) {
             if (i + j < SPX_WOTS_LEN) {
                 memcpy(pk + (i + j)*SPX_N, pkbuf + j*SPX_N, SPX_N);
@@ -207,19 +323,181 @@ void wots_gen_pk(unsigned char *pk, const unsigned char *sk_seed,
  * Takes a n-byte message and the 32-byte sk_see to compute a signature 'sig'.
  */
 void wots_sign(unsigned char *sig, const unsigned char *msg,
-               const unsigned char *sk_seed, const unsigned char *pub_seed,
+               const unsigned char *sk_seed, const spx_ctx *ctx,
                uint32_t addr[8])
 {
     int lengths[SPX_WOTS_LEN];
+    unsigned int start[SPX_WOTS_LEN] = {0};
+    unsigned int steps[SPX_WOTS_LEN];
+    uint32_t addrx8[8 * 8];
+    unsigned char skbuf[8 * SPX_N];
     uint32_t i;
+    unsigned int j;
 
     chain_lengths(lengths, msg);
 
+    for (j = 0; j < 8; j++) {
+        memcpy(addrx8 + j*8, addr, sizeof(uint32_t) * 8);
+    }
+
+    /* Expand the secret key elements, eight at a time. */
+    for (i = 0; i < ((SPX_WOTS_LEN + 7) & ~0x7); i += 8) {
+        for (j = 0; j < 8; j++) {
+            set_chain_addr(addrx8 + j*8, i + j);
+        }
+        wots_gen_skx8(skbuf, sk_seed, addrx8);
+        for (j = 0; j < 8; j++) {
+            if (i + j < SPX_WOTS_LEN) {
+                memcpy(sig + (i + j)*SPX_N, skbuf + j*SPX_N, SPX_N);
+            }
+        }
+    }
+
+    for (i = 0; i < SPX_WOTS_LEN; i++) {
+        steps[i] = lengths[i];
+    }
+    gen_chains_refillx8(sig, start, steps, SPX_WOTS_LEN, SPX_WOTS_LEN,
+                        ctx->state_seeded, addr);
+}
+
+/**
+ * Computes the leaf at a given address. First generates the WOTS key pair,
+ * then computes leaf by hashing horizontally.
+ */
+void wots_gen_leaf(unsigned char *leaf, const unsigned char *sk_seed,
+                   const spx_ctx *ctx,
+                   uint32_t addr_idx, const uint32_t tree_addr[8])
+{
+    unsigned char pk[SPX_WOTS_BYTES];
+    uint32_t wots_addr[8] = {0};
+    uint32_t wots_pk_addr[8] = {0};
+
+    set_type(wots_addr, SPX_ADDR_TYPE_WOTS);
+    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
+
+    copy_subtree_addr(wots_addr, tree_addr);
+    set_keypair_addr(wots_addr, addr_idx);
+    wots_gen_pk(pk, sk_seed, ctx, wots_addr);
+
+    copy_keypair_addr(wots_pk_addr, wots_addr);
+    thash(leaf, pk, SPX_WOTS_LEN, ctx, wots_pk_addr);
+}
+
+int wots_leaf_from_sig_read(unsigned char *leaf,
+                            spx_read_fn read, void *arg,
+                            const unsigned char *msg,
+                            const spx_ctx *ctx, uint32_t addr[8])
+{
+    unsigned char sig[SPX_WOTS_BYTES];
+
+    if (read(arg, sig, SPX_WOTS_BYTES)) {
+        return -1;
+    }
+    wots_leaf_from_sig(leaf, sig, msg, ctx, addr);
+    return 0;
+}
+
+/**
+ * 8-way parallel version of wots_gen_leaf; generates the leaves of eight key
+ * pairs in the subtree at tree_addr. With a chain kernel, all 8*SPX_WOTS_LEN
+ * chains go through gen_chains_refillx8 at once, so that the chain values
+ * stay in its lanes for all SPX_WOTS_W - 1 steps; otherwise lane j computes
+ * chain i of key pair j with thashx8, one step at a time.
+ */
+void wots_gen_leafx8(unsigned char *leaf0,
+                     unsigned char *leaf1,
+                     unsigned char *leaf2,
+                     unsigned char *leaf3,
+                     unsigned char *leaf4,
+                     unsigned char *leaf5,
+                     unsigned char *leaf6,
+                     unsigned char *leaf7,
+                     const unsigned char *sk_seed,
+                     const spx_ctx *ctx,
+                     uint32_t addr_idx0,
+                     uint32_t addr_idx1,
+                     uint32_t addr_idx2,
+                     uint32_t addr_idx3,
+                     uint32_t addr_idx4,
+                     uint32_t addr_idx5,
+                     uint32_t addr_idx6,
+                     uint32_t addr_idx7,
+                     const uint32_t tree_addr[8])
+{
+    const uint32_t addr_idx[8] = {addr_idx0, addr_idx1, addr_idx2, addr_idx3,
+                                  addr_idx4, addr_idx5, addr_idx6, addr_idx7};
+    unsigned char pkx8[8 * SPX_WOTS_BYTES];
+    unsigned char bufx8[8 * SPX_N];
+    uint32_t wots_addrx8[8*8] = {0};
+    uint32_t wots_pk_addrx8[8*8] = {0};
+    unsigned int start[8 * SPX_WOTS_LEN] = {0};
+    unsigned int steps[8 * SPX_WOTS_LEN];
+    uint8_t state_seededx8[8 * 40];
+    int refill = spx_dispatch.chains == SPX_IMPL_AVX2 ||
+                 spx_dispatch.chains == SPX_IMPL_AVX512 ||
+                 spx_dispatch.chains == SPX_IMPL_SSE2;
+    uint32_t i;
+    unsigned int j;
+
+    for (j = 0; j < 8; j++) {
+        set_type(wots_addrx8 + j*8, SPX_ADDR_TYPE_WOTS);
+        set_type(wots_pk_addrx8 + j*8, SPX_ADDR_TYPE_WOTSPK);
+        copy_subtree_addr(wots_addrx8 + j*8, tree_addr);
+        set_keypair_addr(wots_addrx8 + j*8, addr_idx[j]);
+        copy_keypair_addr(wots_pk_addrx8 + j*8, wots_addrx8 + j*8);
+    }
+
+    /* Lane j computes chain i of key pair j. */
     for (i = 0; i < SPX_WOTS_LEN; i++) {
-        set_chain_addr(addr, i);
-        wots_gen_sk(sig + i*SPX_N, sk_seed, addr);
-        gen_chain(sig + i*SPX_N, sig + i*SPX_N, 0, lengths[i], pub_seed, addr);
+        for (j = 0; j < 8; j++) {
+            set_chain_addr(wots_addrx8 + j*8, i);
+        }
+        wots_gen_skx8(bufx8, sk_seed, wots_addrx8);
+        if (!refill) {
+            gen_chainx8(bufx8, bufx8, 0, SPX_WOTS_W - 1, ctx, wots_addrx8);
+        }
+        for (j = 0; j < 8; j++) {
+            memcpy(pkx8 + j*SPX_WOTS_BYTES + i*SPX_N, bufx8 + j*SPX_N, SPX_N);
+        }
     }
+
+    if (refill) {
+        for (j = 0; j < 8; j++) {
+            memcpy(state_seededx8 + 40*j, ctx->state_seeded, 40);
+        }
+        for (i = 0; i < 8 * SPX_WOTS_LEN; i++) {
+            steps[i] = SPX_WOTS_W - 1;
+        }
+        gen_chains_refillx8(pkx8, start, steps, 8 * SPX_WOTS_LEN,
+                            SPX_WOTS_LEN, state_seededx8, wots_addrx8);
+    }
+
+    thashx8(leaf0, leaf1, leaf2, leaf3, leaf4, leaf5, leaf6, leaf7,
+            pkx8 + 0*SPX_WOTS_BYTES,
+            pkx8 + 1*SPX_WOTS_BYTES,
+            pkx8 + 2*SPX_WOTS_BYTES,
+            pkx8 + 3*SPX_WOTS_BYTES,
+            pkx8 + 4*SPX_WOTS_BYTES,
+            pkx8 + 5*SPX_WOTS_BYTES,
+            pkx8 + 6*SPX_WOTS_BYTES,
+            pkx8 + 7*SPX_WOTS_BYTES, SPX_WOTS_LEN, ctx, wots_pk_addrx8);
+}
+
+/*
+ * All eight lanes work on the subtree at once, level by level; see
+ * treehashx8_levels.
+ */
+void wots_treehash(unsigned char *root, unsigned char *auth_path,
+                   const unsigned char *sk_seed, const spx_ctx *ctx,
+                   uint32_t leaf_idx, uint32_t tree_addr[8])
+{
+#if SPX_TREE_HEIGHT < 3
+    treehash(root, auth_path, sk_seed, ctx, leaf_idx, 0, SPX_TREE_HEIGHT,
+             wots_gen_leaf, tree_addr);
+#else
+    treehashx8_levels(root, auth_path, sk_seed, ctx, leaf_idx, 0,
+                      SPX_TREE_HEIGHT, wots_gen_leafx8, tree_addr);
+#endif
 }
 
 /**
@@ -229,16 +507,73 @@ void wots_sign(unsigned char *sig, const unsigned char *msg,
  */
 void wots_pk_from_sig(unsigned char *pk,
                       const unsigned char *sig, const unsigned char *msg,
-                      const unsigned char *pub_seed, uint32_t addr[8])
+                      const spx_ctx *ctx, uint32_t addr[8])
 {
     int lengths[SPX_WOTS_LEN];
+    unsigned int start[SPX_WOTS_LEN];
+    unsigned int steps[SPX_WOTS_LEN];
     uint32_t i;
 
     chain_lengths(lengths, msg);
 
     for (i = 0; i < SPX_WOTS_LEN; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(pk + i*SPX_N, sig + i*SPX_N,
-                  lengths[i], SPX_WOTS_W - 1 - lengths[i], pub_seed, addr);
+        start[i] = lengths[i];
+        steps[i] = SPX_WOTS_W - 1 - lengths[i];
+    }
+
+    memmove(pk, sig, SPX_WOTS_BYTES);
+    gen_chains_refillx8(pk, start, steps, SPX_WOTS_LEN, SPX_WOTS_LEN,
+                        ctx->state_seeded, addr);
+}
+
+/**
+ * Takes a WOTS signature and an n-byte message, computes the leaf of the WOTS
+ * public key. Unlike in ref, the whole public key is derived first, so that
+ * gen_chains_refillx8 can keep its eight lanes busy across all chains.
+ */
+void wots_leaf_from_sig(unsigned char *leaf,
+                        const unsigned char *sig, const unsigned char *msg,
+                        const spx_ctx *ctx, uint32_t addr[8])
+{
+    unsigned char pk[SPX_WOTS_BYTES];
+    uint32_t wots_pk_addr[8] = {0};
+
+    wots_pk_from_sig(pk, sig, msg, ctx, addr);
+
+    set_type(wots_pk_addr, SPX_ADDR_TYPE_WOTSPK);
+    copy_keypair_addr(wots_pk_addr, addr);
+    thash(leaf, pk, SPX_WOTS_LEN, ctx, wots_pk_addr);
+}
+
+/**
+ * 8-way parallel version of wots_pk_from_sig, for eight unrelated WOTS
+ * signatures that may belong to different key pairs. Lane j reads its
+ * signature from sigx8[j] and its n-byte message from msgx8 + j*SPX_N, and
+ * uses the seeded state at state_seededx8 + 40*j (see thashx8_seeded).
+ *
+ * Writes the computed public keys to pkx8, SPX_WOTS_BYTES apart.
+ */
+void wots_pk_from_sigx8(unsigned char *pkx8,
+                        const unsigned char *const sigx8[8],
+                        const unsigned char *msgx8,
+                        const uint8_t *state_seededx8, uint32_t addrx8[8*8])
+{
+    int lengths[SPX_WOTS_LEN];
+    unsigned int start[8 * SPX_WOTS_LEN];
+    unsigned int steps[8 * SPX_WOTS_LEN];
+    uint32_t i;
+    unsigned int j;
+
+    for (j = 0; j < 8; j++) {
+        chain_lengths(lengths, msgx8 + j*SPX_N);
+        for (i = 0; i < SPX_WOTS_LEN; i++) {
+            start[j*SPX_WOTS_LEN + i] = lengths[i];
+            steps[j*SPX_WOTS_LEN + i] = SPX_WOTS_W - 1 - lengths[i];
+        }
+        memcpy(pkx8 + j*SPX_WOTS_BYTES, sigx8[j], SPX_WOTS_BYTES);
     }
+
+    /* All 8*SPX_WOTS_LEN chains share the lanes, regardless of their key. */
+    gen_chains_refillx8(pkx8, start, steps, 8 * SPX_WOTS_LEN, SPX_WOTS_LEN,
+                        state_seededx8, addrx8);
 }
@@ -0,0 +1,45 @@
+#ifndef SPX_WOTSX8_H
+#define SPX_WOTSX8_H
+
+#include <stdint.h>
+#include "params.h"
+#include "context.h"
+
+/**
+ * 8-way parallel version of wots_pk_from_sig, for eight unrelated WOTS
+ * signatures that may belong to different key pairs. Lane j reads its
+ * signature from sigx8[j] and its n-byte message from msgx8 + j*SPX_N, and
+ * uses the seeded state at state_seededx8 + 40*j (see thashx8_seeded).
+ *
+ * Writes the computed public keys to pkx8, SPX_WOTS_BYTES apart.
+ */
+void wots_pk_from_sigx8(unsigned char *pkx8,
+                        const unsigned char *const sigx8[8],
+                        const unsigned char *msgx8,
+                        const uint8_t *state_seededx8, uint32_t addrx8[8*8]);
+
+/**
+ * 8-way parallel version of wots_gen_leaf, for the key pairs addr_idx0..7 of
+ * the subtree at tree_addr; fits the gen_leafx8 argument of treehashx8.
+ */
+void wots_gen_leafx8(unsigned char *leaf0,
+                     unsigned char *leaf1,
+                     unsigned char *leaf2,
+                     unsigned char *leaf3,
+                     unsigned char *leaf4,
+                     unsigned char *leaf5,
+                     unsigned char *leaf6,
+                     unsigned char *leaf7,
+                     const unsigned char *sk_seed,
+                     const spx_ctx *ctx,
+                     uint32_t addr_idx0,
+                     uint32_t addr_idx1,
+                     uint32_t addr_idx2,
+                     uint32_t addr_idx3,
+                     uint32_t addr_idx4,
+                     uint32_t addr_idx5,
+                     uint32_t addr_idx6,
+                     uint32_t addr_idx7,
+                     const uint32_t tree_addr[8]);
+
+#endif